@@ -0,0 +1,504 @@
+// Throughput benchmark: times every filter and the full pipelines at
+// several resolutions and writes median/p99 time, Mpix/s and GB/s as JSON.
+// Built once per arithmetic variant (float, USE_FIXED_POINT) by `make bench`.
+
+#include "pipeline.h"
+#include "smoothing_filter.h"
+#include "edge_filter.h"
+#include "convolution.h"
+#include "static_kernel.h"
+#include "box_filter.h"
+#include "recursive_gaussian.h"
+#include "fft_convolution.h"
+#include "simd_kernels.h"
+#include "buffer.h"
+#include "config.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using hardware::pipeline::Pipeline;
+using hardware::pipeline::ExecutionMode;
+using hardware::pipeline::FrameJob;
+using hardware::filters::ConvolutionFilter;
+using hardware::filters::TemplateConvolutionFilter;
+
+namespace {
+
+    // config.h declares an unrelated global BaseFilter; keep this one local
+    using hardware::filters::BaseFilter;
+
+    struct Resolution {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    const Resolution RESOLUTIONS[] = {
+        {"vga", 640, 480},
+        {"720p", 1280, 720},
+        {"1080p", 1920, 1080},
+        {"4k", 3840, 2160},
+        {"8k", 7680, 4320},
+    };
+
+    struct Options {
+        std::vector<Resolution> resolutions;
+        std::string filter;         // Substring a case name must contain (empty = all)
+        std::string jsonPath;
+        int warmup = 2;
+        int minIterations = 5;
+        int maxIterations = 50;
+        double budgetSeconds = 0.5; // Per case, once minIterations are done
+        int threads = 1;
+    };
+
+    struct Result {
+        std::string name;
+        std::string kind;           // "filter" or "pipeline"
+        std::string mode;           // rgb/gray for filters, frame/stream for pipelines
+        Resolution resolution;
+        int iterations;
+        double medianMs;
+        double p99Ms;
+        double mpixPerSecond;
+        double gbPerSecond;
+    };
+
+    // Deterministic, non-constant test frame so no kernel sees a trivial input
+    void fillPattern(pixel* frame, int width, int height) {
+        uint32_t state = 0x12345678u;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                state = state * 1664525u + 1013904223u;
+                pixel& p = frame[static_cast<size_t>(y) * width + x];
+                p.r = static_cast<unsigned char>((x + (state >> 28)) & 0xFF);
+                p.g = static_cast<unsigned char>((y + (state >> 24)) & 0xFF);
+                p.b = static_cast<unsigned char>((x ^ y) & 0xFF);
+            }
+        }
+    }
+
+    // Warm up, then time `body` until both the iteration floor and the
+    // time budget are met (or the iteration cap is hit)
+    std::vector<double> measure(const Options& options, const std::function<void()>& body) {
+        for (int i = 0; i < options.warmup; i++) {
+            body();
+        }
+
+        std::vector<double> samples;
+        double total = 0.0;
+        while (static_cast<int>(samples.size()) < options.maxIterations &&
+               (static_cast<int>(samples.size()) < options.minIterations || total < options.budgetSeconds)) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            samples.push_back(elapsed.count());
+            total += elapsed.count();
+        }
+        return samples;
+    }
+
+    // Median and nearest-rank 99th percentile of the samples, in ms
+    Result summarize(const std::string& name, const std::string& kind, const std::string& mode,
+                     const Resolution& resolution, std::vector<double> samples, double bytesPerFrame) {
+        std::sort(samples.begin(), samples.end());
+        size_t count = samples.size();
+        double median = (count % 2) ? samples[count / 2]
+                                    : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+        size_t rank = static_cast<size_t>(std::ceil(0.99 * count));
+        double p99 = samples[std::max<size_t>(rank, 1) - 1];
+        double pixels = static_cast<double>(resolution.width) * resolution.height;
+
+        Result result;
+        result.name = name;
+        result.kind = kind;
+        result.mode = mode;
+        result.resolution = resolution;
+        result.iterations = static_cast<int>(count);
+        result.medianMs = median * 1e3;
+        result.p99Ms = p99 * 1e3;
+        result.mpixPerSecond = pixels / median / 1e6;
+        result.gbPerSecond = bytesPerFrame / median / 1e9;
+        return result;
+    }
+
+    void printResult(const Result& r) {
+        std::cout << std::left << std::setw(30) << r.name << std::setw(7) << r.mode
+                  << std::setw(7) << r.resolution.name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << r.medianMs << std::setw(11) << r.p99Ms
+                  << std::setprecision(1) << std::setw(10) << r.mpixPerSecond
+                  << std::setprecision(2) << std::setw(9) << r.gbPerSecond << "\n";
+    }
+
+    // One filter factory per benchmarked kernel
+    struct FilterCase {
+        const char* name;
+        std::function<BaseFilter*()> create;
+    };
+
+    template <int N>
+    BaseFilter* createBoxTemplate() {
+        float kernel[N][N];
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                kernel[i][j] = 1.0f / (N * N);
+            }
+        }
+        return new TemplateConvolutionFilter<N>(kernel);
+    }
+
+    // Unsharp mask of sigma as one dense kernel, direct or by FFT
+    BaseFilter* createUnsharp(float sigma, bool fft) {
+        int size = 0;
+        std::vector<float> kernel = hardware::filters::unsharpMaskKernel(sigma, 1.0f, size);
+        if (fft) {
+            return new hardware::filters::FftConvolutionFilter(kernel, size);
+        }
+        return new ConvolutionFilter(kernel, size);
+    }
+
+    std::vector<FilterCase> filterCases() {
+        return {
+            {"SmoothingFilter", [] { return new hardware::filters::SmoothingFilter(); }},
+            {"EdgeFilter", [] { return new hardware::filters::EdgeFilter(); }},
+            {"Convolution.gaussian3", [] { return ConvolutionFilter::createGaussian(3, 0.8f); }},
+            {"Convolution.gaussian5", [] { return ConvolutionFilter::createGaussian(5, 1.0f); }},
+            {"Convolution.gaussian7", [] { return ConvolutionFilter::createGaussian(7, 1.5f); }},
+            {"Convolution.sharpen", [] { return ConvolutionFilter::createSharpen(); }},
+            {"Convolution.sobelX", [] { return ConvolutionFilter::createSobelX(); }},
+            {"Convolution.sobelY", [] { return ConvolutionFilter::createSobelY(); }},
+            {"TemplateConvolution<3>", [] { return createBoxTemplate<3>(); }},
+            {"TemplateConvolution<5>", [] { return createBoxTemplate<5>(); }},
+            {"TemplateConvolution<7>", [] { return createBoxTemplate<7>(); }},
+            {"Static.sharpen", [] { return new hardware::filters::SharpenFilter(); }},
+            {"Static.sobelX", [] { return new hardware::filters::SobelXFilter(); }},
+            {"Static.sobelY", [] { return new hardware::filters::SobelYFilter(); }},
+            {"Static.binomial3", [] { return new hardware::filters::Binomial3Filter(); }},
+            {"Static.binomial5", [] { return new hardware::filters::Binomial5Filter(); }},
+            {"Box.r1", [] { return new hardware::filters::BoxFilter(1); }},
+            {"Box.r7", [] { return new hardware::filters::BoxFilter(7); }},
+            {"Box.r31", [] { return new hardware::filters::BoxFilter(31); }},
+            {"AdaptiveThreshold.r15", [] { return new hardware::filters::AdaptiveThresholdFilter(15); }},
+            {"Convolution.gaussian.s2", [] { return ConvolutionFilter::createGaussian(13, 2.0f); }},
+            {"Convolution.gaussian.s4", [] { return ConvolutionFilter::createGaussian(25, 4.0f); }},
+            {"Convolution.gaussian.s8", [] { return ConvolutionFilter::createGaussian(49, 8.0f); }},
+            {"RecursiveGaussian.s2", [] { return new hardware::filters::RecursiveGaussianFilter(2.0f); }},
+            {"RecursiveGaussian.s4", [] { return new hardware::filters::RecursiveGaussianFilter(4.0f); }},
+            {"RecursiveGaussian.s8", [] { return new hardware::filters::RecursiveGaussianFilter(8.0f); }},
+            {"RecursiveGaussian.s32", [] { return new hardware::filters::RecursiveGaussianFilter(32.0f); }},
+            {"Convolution.unsharp.s2", [] { return createUnsharp(2.0f, false); }},
+            {"Convolution.unsharp.s4", [] { return createUnsharp(4.0f, false); }},
+            {"Convolution.unsharp.s8", [] { return createUnsharp(8.0f, false); }},
+            {"FftConvolution.unsharp.s2", [] { return createUnsharp(2.0f, true); }},
+            {"FftConvolution.unsharp.s4", [] { return createUnsharp(4.0f, true); }},
+            {"FftConvolution.unsharp.s8", [] { return createUnsharp(8.0f, true); }},
+        };
+    }
+
+    // Whole-frame band over packed rows, as the pipeline's frame mode issues it
+    template <typename T>
+    void runFilter(BaseFilter& filter, const T* input, T* output, int width, int height,
+                   std::vector<const T*>& rows) {
+        int radius = filter.getRadius();
+        rows.resize(height + 2 * radius);
+        hardware::filters::clampedRowPointers(input, width, height, -radius, height + 2 * radius, rows.data());
+        hardware::filters::BasicRowBand<T> band = {rows.data(), output, width, 0, height, width, height, radius};
+        filter.beginFrame();
+        filter.processRows(band);
+    }
+
+    void benchFilters(const Options& options, const Resolution& res, std::vector<Result>& results) {
+        int width = res.width;
+        int height = res.height;
+        size_t pixels = static_cast<size_t>(width) * height;
+
+        hardware::memory::BufferPool pool;
+        hardware::memory::FrameBuffer input(width, height, pool);
+        hardware::memory::FrameBuffer output(width, height, pool);
+        hardware::memory::GrayPlane grayInput(width, height, pool);
+        hardware::memory::GrayPlane grayOutput(width, height, pool);
+        if (!input.getData() || !output.getData() || !grayInput.getData() || !grayOutput.getData()) {
+            std::cerr << "Error: Cannot allocate " << res.name << " frames\n";
+            return;
+        }
+
+        fillPattern(input.getData(), width, height);
+        for (size_t i = 0; i < pixels; i++) {
+            grayInput.getData()[i] = input.getData()[i].g;
+        }
+
+        std::vector<const pixel*> rgbRows;
+        std::vector<const uint8_t*> grayRows;
+        for (const FilterCase& c : filterCases()) {
+            if (!options.filter.empty() && std::string(c.name).find(options.filter) == std::string::npos) {
+                continue;
+            }
+
+            std::unique_ptr<BaseFilter> filter(c.create());
+            if (!filter) {
+                std::cerr << "Error: Cannot create " << c.name << "\n";
+                continue;
+            }
+
+            // Effective traffic: one input and one output frame per pass
+            auto rgb = measure(options, [&] {
+                runFilter(*filter, input.getData(), output.getData(), width, height, rgbRows);
+            });
+            results.push_back(summarize(c.name, "filter", "rgb", res, rgb, 2.0 * pixels * sizeof(pixel)));
+            printResult(results.back());
+
+            if (filter->supportsFormat(hardware::filters::PixelFormat::GRAY8)) {
+                auto gray = measure(options, [&] {
+                    runFilter(*filter, grayInput.getData(), grayOutput.getData(), width, height, grayRows);
+                });
+                results.push_back(summarize(c.name, "filter", "gray", res, gray, 2.0 * pixels));
+                printResult(results.back());
+            }
+        }
+    }
+
+    void benchPipelines(const Options& options, const Resolution& res, std::vector<Result>& results) {
+        struct PipelineCase {
+            const char* name;
+            std::function<void(Pipeline&)> build;
+        };
+        const PipelineCase cases[] = {
+            {"Pipeline.basic", [](Pipeline& p) {
+                 p.addStage(new hardware::filters::SmoothingFilter());
+                 p.addStage(new hardware::filters::EdgeFilter());
+             }},
+            {"Pipeline.conv", [](Pipeline& p) {
+                 p.addStage(ConvolutionFilter::createGaussian(5, 1.0f));
+                 p.addStage(new hardware::filters::SharpenFilter());
+             }},
+        };
+        const ExecutionMode modes[] = {ExecutionMode::FRAME, ExecutionMode::STREAMING};
+
+        int width = res.width;
+        int height = res.height;
+        size_t pixels = static_cast<size_t>(width) * height;
+
+        std::vector<pixel> pattern(pixels);
+        fillPattern(pattern.data(), width, height);
+
+        for (const PipelineCase& c : cases) {
+            if (!options.filter.empty() && std::string(c.name).find(options.filter) == std::string::npos) {
+                continue;
+            }
+
+            for (ExecutionMode mode : modes) {
+                Pipeline pipeline;
+                pipeline.setExecutionMode(mode);
+                pipeline.setThreadCount(options.threads);
+                c.build(pipeline);
+
+                // Decode and encode are left out: process() converts the RGB
+                // source and runs the stage chain, reusing pooled buffers
+                FrameJob job;
+                job.source = hardware::memory::FrameBuffer(width, height, pipeline.getBufferPool());
+                if (!job.source.getData()) {
+                    std::cerr << "Error: Cannot allocate " << res.name << " source frame\n";
+                    return;
+                }
+
+                job.source.copyFrom(pattern.data());
+
+                bool ok = true;
+                auto samples = measure(options, [&] {
+                    ok = pipeline.process(job) && ok;
+                });
+                if (!ok) {
+                    std::cerr << "Error: " << c.name << " failed at " << res.name << "\n";
+                    continue;
+                }
+
+                // RGB frame in, one result plane (gray or RGB) out
+                size_t outBytes = job.grayResult ? pixels : pixels * sizeof(pixel);
+                results.push_back(summarize(c.name, "pipeline", mode == ExecutionMode::STREAMING ? "stream" : "frame",
+                                            res, samples, static_cast<double>(pixels * sizeof(pixel) + outBytes)));
+                printResult(results.back());
+            }
+        }
+    }
+
+    bool writeJson(const Options& options, const std::vector<Result>& results) {
+        std::ofstream out(options.jsonPath);
+        if (!out) {
+            std::cerr << "Error: Cannot write " << options.jsonPath << "\n";
+            return false;
+        }
+
+#ifdef USE_FIXED_POINT
+        const char* arithmetic = "fixed";
+#else
+        const char* arithmetic = "float";
+#endif
+
+        out << "{\n";
+        out << "  \"arithmetic\": \"" << arithmetic << "\",\n";
+        out << "  \"simd\": \"" << hardware::filters::simd::kernels().name << "\",\n";
+        out << "  \"threads\": " << options.threads << ",\n";
+        out << "  \"warmup\": " << options.warmup << ",\n";
+        out << "  \"results\": [";
+        out << std::fixed;
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            out << (i ? ",\n" : "\n");
+            out << "    {\"name\": \"" << r.name << "\", \"kind\": \"" << r.kind << "\", \"mode\": \"" << r.mode
+                << "\", \"resolution\": \"" << r.resolution.name << "\", \"width\": " << r.resolution.width
+                << ", \"height\": " << r.resolution.height << ", \"iterations\": " << r.iterations
+                << std::setprecision(4) << ", \"median_ms\": " << r.medianMs << ", \"p99_ms\": " << r.p99Ms
+                << std::setprecision(2) << ", \"mpix_per_s\": " << r.mpixPerSecond
+                << std::setprecision(3) << ", \"gb_per_s\": " << r.gbPerSecond << "}";
+        }
+        out << "\n  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    bool parseInt(const char* text, long minValue, long maxValue, int& result) {
+        char* end = nullptr;
+        long value = strtol(text, &end, 10);
+        if (end == text || *end != '\0' || value < minValue || value > maxValue) {
+            return false;
+        }
+        result = static_cast<int>(value);
+        return true;
+    }
+
+    bool parseSizes(const std::string& list, std::vector<Resolution>& sizes) {
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            bool found = false;
+            for (const Resolution& r : RESOLUTIONS) {
+                if (item == r.name) {
+                    sizes.push_back(r);
+                    found = true;
+                }
+            }
+            if (!found) {
+                std::cerr << "Error: Unknown resolution '" << item << "'\n";
+                return false;
+            }
+        }
+        return !sizes.empty();
+    }
+
+    void printUsage(const char* programName) {
+        std::cout << "Usage: " << programName << " [options]\n";
+        std::cout << "\nOptions:\n";
+        std::cout << "  --json=FILE      : Write results as JSON (default: none)\n";
+        std::cout << "  --sizes=LIST     : Comma list of vga,720p,1080p,4k,8k (default: all)\n";
+        std::cout << "  --filter=TEXT    : Only cases whose name contains TEXT\n";
+        std::cout << "  --warmup=N       : Untimed iterations per case (default 2)\n";
+        std::cout << "  --min-iters=N    : Timed iterations per case, at least (default 5)\n";
+        std::cout << "  --max-iters=N    : Timed iterations per case, at most (default 50)\n";
+        std::cout << "  --budget-ms=N    : Keep timing a case until N ms are spent (default 500)\n";
+        std::cout << "  --threads=N      : Pipeline worker threads (default 1)\n";
+        std::cout << "  --simd=LEVEL     : Convolution kernels: auto (default), scalar, sse4.1, avx2\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        int budgetMs = 0;
+        if (strncmp(argv[i], "--json=", 7) == 0) {
+            options.jsonPath = argv[i] + 7;
+        } else if (strncmp(argv[i], "--sizes=", 8) == 0) {
+            if (!parseSizes(argv[i] + 8, options.resolutions)) {
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            options.filter = argv[i] + 9;
+        } else if (strncmp(argv[i], "--warmup=", 9) == 0) {
+            if (!parseInt(argv[i] + 9, 0, 1000, options.warmup)) {
+                std::cerr << "Error: Invalid warm-up count '" << (argv[i] + 9) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--min-iters=", 12) == 0) {
+            if (!parseInt(argv[i] + 12, 1, 100000, options.minIterations)) {
+                std::cerr << "Error: Invalid iteration count '" << (argv[i] + 12) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--max-iters=", 12) == 0) {
+            if (!parseInt(argv[i] + 12, 1, 100000, options.maxIterations)) {
+                std::cerr << "Error: Invalid iteration count '" << (argv[i] + 12) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--budget-ms=", 12) == 0) {
+            if (!parseInt(argv[i] + 12, 0, 3600000, budgetMs)) {
+                std::cerr << "Error: Invalid time budget '" << (argv[i] + 12) << "'\n";
+                return 1;
+            }
+            options.budgetSeconds = budgetMs / 1000.0;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            if (!parseInt(argv[i] + 10, 0, 1024, options.threads)) {
+                std::cerr << "Error: Invalid thread count '" << (argv[i] + 10) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--simd=", 7) == 0) {
+            using hardware::filters::simd::IsaLevel;
+            std::string level = argv[i] + 7;
+            bool selected = true;
+            if (level == "scalar") {
+                selected = hardware::filters::simd::selectIsa(IsaLevel::SCALAR);
+            } else if (level == "sse4.1") {
+                selected = hardware::filters::simd::selectIsa(IsaLevel::SSE41);
+            } else if (level == "avx2") {
+                selected = hardware::filters::simd::selectIsa(IsaLevel::AVX2);
+            } else if (level != "auto") {
+                std::cerr << "Error: Unknown SIMD level '" << level << "'\n";
+                return 1;
+            }
+            if (!selected) {
+                std::cerr << "Error: CPU does not support SIMD level '" << level << "'\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown argument '" << argv[i] << "'\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.maxIterations < options.minIterations) {
+        options.maxIterations = options.minIterations;
+    }
+    if (options.resolutions.empty()) {
+        options.resolutions.assign(std::begin(RESOLUTIONS), std::end(RESOLUTIONS));
+    }
+
+    std::cout << std::left << std::setw(30) << "case" << std::setw(7) << "mode" << std::setw(7) << "size"
+              << std::right << std::setw(11) << "median ms" << std::setw(11) << "p99 ms"
+              << std::setw(10) << "Mpix/s" << std::setw(9) << "GB/s" << "\n";
+
+    std::vector<Result> results;
+    for (const Resolution& res : options.resolutions) {
+        benchFilters(options, res, results);
+        benchPipelines(options, res, results);
+    }
+
+    if (!options.jsonPath.empty()) {
+        if (!writeJson(options, results)) {
+            return 1;
+        }
+        std::cout << "Results written to " << options.jsonPath << "\n";
+    }
+    return 0;
+}
@@ -2,17 +2,139 @@
 #define BASE_FILTER_H
 
 #include "pixel.h"
+#include "border.h"
+#include "image_view.h"
+#include <cstdint>
 
 namespace hardware {
     namespace filters {
-        
+
+        // A band of output rows [y0, y1) handed to a filter. Input rows are
+        // reached through row pointers clamped to the frame, so the same
+        // kernel code runs on whole frames and on streaming line buffers.
+        //
+        // With border == COPY rows and columns within the radius of the edge
+        // pass through unfiltered. Any other mode means every input row
+        // carries a `radius`-wide apron already filled for that mode (and
+        // rows[] reaches radius rows past the frame), so filters compute all
+        // width x height outputs with no edge tests in the inner loops.
+        template <typename T>
+        struct BasicRowBand {
+            const T* const* rows;       // rows[i] = input row (y0 - radius + i)
+            T* output;                  // output row y0
+            int outputStride;           // elements between consecutive output rows
+            int y0;
+            int y1;
+            int width;
+            int height;
+            int radius;
+            BorderMode border = BorderMode::COPY;
+            uint8_t borderConstant = 0;     // Apron intensity for BorderMode::CONSTANT
+
+            bool padded() const { return border != BorderMode::COPY; }
+            const T* inputRow(int y) const { return rows[y - y0 + radius]; }
+            T* outputRow(int y) const { return output + (y - y0) * outputStride; }
+        };
+
+        using RowBand = BasicRowBand<pixel>;
+        using GrayRowBand = BasicRowBand<uint8_t>;
+
+        // Intensity accessors so one kernel template serves both layouts
+        // (grayscale RGB frames carry the intensity in every channel)
+        inline uint8_t intensity(const pixel& p) { return p.r; }
+        inline uint8_t intensity(uint8_t v) { return v; }
+        inline void setIntensity(pixel& p, uint8_t v) { p.r = p.g = p.b = v; }
+        inline void setIntensity(uint8_t& p, uint8_t v) { p = v; }
+
+        // Fill rows[0..count) with pointers to frame rows first .. first+count-1,
+        // clamping indices outside the frame to the nearest edge row
+        template <typename T>
+        void clampedRowPointers(const T* frame, int width, int height,
+                                int first, int count, const T** rows) {
+            for (int i = 0; i < count; i++) {
+                int y = first + i;
+                if (y < 0)
+                    y = 0;
+                if (y >= height)
+                    y = height - 1;
+                rows[i] = frame + static_cast<long>(y) * width;
+            }
+        }
+
+        // As above for a strided view
+        template <typename T>
+        void clampedRowPointers(const BasicImageView<const T>& view, int first, int count, const T** rows) {
+            for (int i = 0; i < count; i++) {
+                int y = std::min(std::max(first + i, 0), view.height - 1);
+                rows[i] = view.row(y);
+            }
+        }
+
         class BaseFilter {
         public:
             virtual void apply(pixel* input, pixel* output, int width, int height) = 0;
+
+            // Gray plane counterpart of apply(); only valid if GRAY8 is supported
+            virtual void applyGray(uint8_t* input, uint8_t* output, int width, int height);
+
+            // Filter one view into another of the same size; strides are
+            // free, so the views may be rectangles of larger frames. With
+            // COPY the input view is the whole frame (rows clamp at its
+            // edges, the rim within the radius passes through). Other modes
+            // read getRadius() pixels around the input view, which the
+            // caller makes valid: a rectangle that far inside its frame, or
+            // a padded buffer with its apron filled. Input and output must
+            // not overlap.
+            void applyView(const ImageView& input, const ImageView& output,
+                           BorderMode border = BorderMode::COPY, uint8_t constant = 0);
+            void applyView(const GrayImageView& input, const GrayImageView& output,
+                           BorderMode border = BorderMode::COPY, uint8_t constant = 0);
+
+            // Short label for logs and per-stage profiles
+            virtual const char* getName() const { return "filter"; }
+
+            // Rows needed above and below each output row (line buffer depth is 2*radius+1)
+            virtual int getRadius() const { return 0; }
+
+            // Pixels an output sample reads on each side of itself. Equal to
+            // the radius unless that also covers rows a band computes ahead
+            // (block filters), which a band starting on row 0 never needs
+            virtual int getFootprint() const { return getRadius(); }
+
+            // Rows that are cheapest computed together: row-parallel runs
+            // start their bands on multiples of this
+            virtual int getRowGranularity() const { return 1; }
+
+            // True if an output sample depends on the whole of its row
+            // (recursive filters run each row from its first pixel)
+            virtual bool needsWholeRows() const { return false; }
+
+            // Multiplies per output sample in a direct datapath (DSP estimate)
+            virtual int getMultiplierCount() const {
+                int size = 2 * getRadius() + 1;
+                return size * size;
+            }
+
+            // Layouts this filter accepts; output uses the input's layout
+            virtual bool supportsFormat(PixelFormat format) const { return format == PixelFormat::RGB24; }
+
+            // Called before the first processRows() of every frame; filters
+            // that keep results across bands of one frame drop them here
+            virtual void beginFrame() {}
+
+            // Compute output rows band.y0 .. band.y1-1
+            virtual void processRows(const RowBand& band) = 0;
+            virtual void processRows(const GrayRowBand& band);
+
             virtual ~BaseFilter() = default;
+
+        protected:
+            // Run processRows over a whole packed frame
+            void applyRows(const pixel* input, pixel* output, int width, int height);
+            void applyRows(const uint8_t* input, uint8_t* output, int width, int height);
         };
-        
+
     } // namespace filters
 } // namespace hardware
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,95 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "pipeline.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hardware {
+    namespace pipeline {
+
+        // Blocking queue of bounded depth between batch stages. Producers
+        // stall when it is full, which caps the number of frames in flight.
+        template<typename T>
+        class BoundedQueue {
+        private:
+            std::mutex mutex;
+            std::condition_variable notEmpty;
+            std::condition_variable notFull;
+            std::deque<T> items;
+            size_t capacity;
+            bool closed;
+
+        public:
+            explicit BoundedQueue(size_t depth) : capacity(depth > 0 ? depth : 1), closed(false) {}
+
+            // False if the queue was closed (the item is dropped)
+            bool push(T item) {
+                std::unique_lock<std::mutex> lock(mutex);
+                notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+                if (closed)
+                    return false;
+                items.push_back(std::move(item));
+                notEmpty.notify_one();
+                return true;
+            }
+
+            // False once the queue is closed and drained
+            bool pop(T& item) {
+                std::unique_lock<std::mutex> lock(mutex);
+                notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+                if (items.empty())
+                    return false;
+                item = std::move(items.front());
+                items.pop_front();
+                notFull.notify_one();
+                return true;
+            }
+
+            // No more pushes; consumers finish what is queued
+            void close() {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+                notEmpty.notify_all();
+                notFull.notify_all();
+            }
+        };
+
+        struct BatchItem {
+            std::string inputPath;
+            std::string outputPath;
+        };
+
+        // Runs one pipeline over many images as three overlapped stages:
+        // decode thread(s) -> compute (calling thread) -> encode thread(s),
+        // connected by bounded queues, so file I/O for neighbouring frames
+        // hides behind the filter stages of the current one.
+        class BatchRunner {
+        private:
+            Pipeline& pipeline;
+            int decodeThreads;
+            int encodeThreads;
+            int queueDepth;
+
+        public:
+            BatchRunner(Pipeline& target, int ioThreads = 1, int depth = 2);
+
+            // Returns the number of items that failed
+            int run(const std::vector<BatchItem>& items);
+
+            // Build the work list from a directory (every .ppm/.pgm/.pnm/.qoi file,
+            // sorted by name) or a text file listing one input path per line
+            // ('#' starts a comment). Outputs keep the input file name, with
+            // `suffix` inserted before the extension, inside outputDir.
+            static bool collectItems(const std::string& source, const std::string& outputDir,
+                                     const std::string& suffix, std::vector<BatchItem>& items);
+        };
+
+    } // namespace pipeline
+} // namespace hardware
+
+#endif // BATCH_H
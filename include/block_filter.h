@@ -0,0 +1,45 @@
+#ifndef BLOCK_FILTER_H
+#define BLOCK_FILTER_H
+
+#include "base_filter.h"
+
+namespace hardware
+{
+    namespace filters
+    {
+        // Base for filters that compute their output a block of rows at a
+        // time (recursive and transform-domain filters). Blocks sit on a
+        // fixed grid of blockRows rows, so an output row never depends on
+        // how the frame was split into bands. A finished block is kept per
+        // thread until the next frame: its remaining rows (one call each
+        // when streaming) are copied rather than computed again.
+        //
+        // getRadius() must cover blockRows - 1 rows plus the reach of the
+        // filter itself, so that any band can compute a whole block.
+        class BlockFilter : public BaseFilter
+        {
+        private:
+            unsigned long frameSerial;  // Tags the blocks cached for this frame
+
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band);
+
+        protected:
+            int blockRows;
+
+            explicit BlockFilter(int rows = 1);
+
+            // Compute output rows [first, last) into `out` (packed rows)
+            virtual void filterBlock(const RowBand &band, int first, int last, pixel *out) = 0;
+            virtual void filterBlock(const GrayRowBand &band, int first, int last, uint8_t *out) = 0;
+
+        public:
+            void beginFrame() override;
+            void processRows(const RowBand &band) override;
+            void processRows(const GrayRowBand &band) override;
+            int getRowGranularity() const override { return blockRows; }
+        };
+    }
+}
+
+#endif
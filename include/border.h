@@ -0,0 +1,111 @@
+#ifndef BORDER_H
+#define BORDER_H
+
+#include "pixel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace hardware {
+    namespace filters {
+
+        // What a stage reads outside the frame
+        enum class BorderMode {
+            COPY,       // Rows and columns within the radius pass through unfiltered
+            REPLICATE,  // Edge pixel repeated: aaa|abcd
+            MIRROR,     // Reflected about the edge pixel: dcb|abcd
+            CONSTANT    // A fixed intensity
+        };
+
+        // Frame index an out-of-range index i reads under `mode`, or -1
+        // for CONSTANT. In-range indices map to themselves.
+        inline int borderIndex(BorderMode mode, int i, int size) {
+            if (i >= 0 && i < size)
+                return i;
+            if (mode == BorderMode::CONSTANT)
+                return -1;
+            if (mode == BorderMode::MIRROR && size > 1) {
+                int period = 2 * (size - 1);
+                i %= period;
+                if (i < 0)
+                    i += period;
+                return i < size ? i : period - i;
+            }
+            return i < 0 ? 0 : size - 1;
+        }
+
+        // A CONSTANT border sample of the given intensity
+        template <typename T>
+        T borderSample(uint8_t value);
+        template <>
+        inline pixel borderSample<pixel>(uint8_t value) { return pixel{value, value, value}; }
+        template <>
+        inline uint8_t borderSample<uint8_t>(uint8_t value) { return value; }
+
+        // Fill row[-apron, 0) and row[width, width + apron) from the row itself
+        template <typename T>
+        void fillRowApron(T* row, int width, int apron, BorderMode mode, uint8_t constant) {
+            T fill = borderSample<T>(constant);
+            for (int i = 1; i <= apron; i++) {
+                int left = borderIndex(mode, -i, width);
+                int right = borderIndex(mode, width - 1 + i, width);
+                row[-i] = left < 0 ? fill : row[left];
+                row[width - 1 + i] = right < 0 ? fill : row[right];
+            }
+        }
+
+        // Fill a `radius`-wide apron around a padded frame (origin = pixel
+        // (0, 0), rows `stride` elements apart, at least `radius` spare
+        // rows and columns on every side). O(perimeter), so it can run
+        // before every stage; filters then read any pixel within the radius
+        // without bounds checks.
+        template <typename T>
+        void fillApron(T* origin, int width, int height, int stride, int radius,
+                       BorderMode mode, uint8_t constant) {
+            if (radius <= 0 || mode == BorderMode::COPY)
+                return;
+
+            for (int y = 0; y < height; y++) {
+                fillRowApron(origin + static_cast<long>(y) * stride, width, radius, mode, constant);
+            }
+
+            // Whole padded rows above and below, corners included
+            T fill = borderSample<T>(constant);
+            int span = width + 2 * radius;
+            for (int i = 1; i <= radius; i++) {
+                int rowsOut[2] = {-i, height - 1 + i};
+                for (int y : rowsOut) {
+                    T* dest = origin + static_cast<long>(y) * stride - radius;
+                    int source = borderIndex(mode, y, height);
+                    if (source < 0) {
+                        std::fill(dest, dest + span, fill);
+                    } else {
+                        memcpy(dest, origin + static_cast<long>(source) * stride - radius, span * sizeof(T));
+                    }
+                }
+            }
+        }
+
+        // Copy the `radius` edge columns of a row through unfiltered (COPY mode)
+        template <typename T>
+        inline void copyEdgeColumns(const T* center, T* out, int width, int radius) {
+            for (int x = 0; x < radius && x < width; x++) {
+                out[x] = center[x];
+            }
+            for (int x = std::max(radius, width - radius); x < width; x++) {
+                out[x] = center[x];
+            }
+        }
+
+        // rows[0..count) = rows first .. first+count-1 of a padded frame
+        template <typename T>
+        void paddedRowPointers(const T* origin, int stride, int first, int count, const T** rows) {
+            for (int i = 0; i < count; i++) {
+                rows[i] = origin + static_cast<long>(first + i) * stride;
+            }
+        }
+
+    } // namespace filters
+} // namespace hardware
+
+#endif // BORDER_H
@@ -0,0 +1,73 @@
+#ifndef BOX_FILTER_H
+#define BOX_FILTER_H
+
+#include "base_filter.h"
+#include <cstdint>
+
+namespace hardware
+{
+    namespace filters
+    {
+        // Mean over a (2r+1) x (2r+1) window for any radius up to
+        // MAX_BOX_RADIUS. Column sums slide down each band (and on to the
+        // next band of the same frame, so streaming one row at a time
+        // slides too) and a row sum slides across each line, so a sample
+        // costs the same few adds at radius 31 as at radius 1. The integer window sum is divided
+        // exactly (truncating, like SmoothingFilter), so radius 1 gives
+        // SmoothingFilter's output bit for bit.
+        class BoxFilter : public BaseFilter
+        {
+        private:
+            int radius;
+            uint64_t reciprocal;    // ceil(2^48 / area): exact floor division of any window sum
+            unsigned long frameSerial;  // Tags the column sums kept for this frame
+
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band);
+
+        public:
+            explicit BoxFilter(int r);
+
+            void beginFrame() override;
+            void apply(pixel *input, pixel *output, int width, int height) override;
+            void processRows(const RowBand &band) override;
+            void processRows(const GrayRowBand &band) override;
+            const char *getName() const override { return "box"; }
+            int getRadius() const override { return radius; }
+            int getMultiplierCount() const override { return 1; }  // Running sums, times 1/area
+            bool supportsFormat(PixelFormat) const override { return true; }
+
+            // floor(sum / area)
+            uint8_t mean(uint32_t sum) const { return static_cast<uint8_t>((sum * reciprocal) >> 48); }
+        };
+
+        // Local-mean thresholding on the same running sums: a sample
+        // becomes 255 when it is above the mean of its (2r+1) x (2r+1)
+        // window minus `offset`, else 0. The comparison is made on the
+        // exact window sum, so no rounding of the mean is involved.
+        class AdaptiveThresholdFilter : public BaseFilter
+        {
+        private:
+            int radius;
+            int offset;
+            unsigned long frameSerial;
+
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band);
+
+        public:
+            AdaptiveThresholdFilter(int r, int meanOffset = 5);
+
+            void beginFrame() override;
+            void apply(pixel *input, pixel *output, int width, int height) override;
+            void processRows(const RowBand &band) override;
+            void processRows(const GrayRowBand &band) override;
+            const char *getName() const override { return "adaptive threshold"; }
+            int getRadius() const override { return radius; }
+            int getMultiplierCount() const override { return 1; }  // Sample times area
+            bool supportsFormat(PixelFormat) const override { return true; }
+        };
+    }
+}
+
+#endif
@@ -3,28 +3,114 @@
 
 #include "config.h"
 #include "pixel.h"
+#include "border.h"
+#include "image_view.h"
 #include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
 
 namespace hardware {
     namespace memory {
         
-        // Simulates hardware frame buffer with alignment
+        // Size-keyed pool of FRAME_BUFFER_ALIGNMENT-aligned blocks. Released
+        // blocks are kept (up to MAX_FRAME_BUFFERS per size) and handed out
+        // again, so repeated frames at one resolution stop allocating after
+        // warm-up. Thread-safe; may be shared between pipelines, but must
+        // outlive every buffer leased from it.
+        class BufferPool {
+        private:
+            mutable std::mutex mutex;
+            std::unordered_map<size_t, std::vector<void*>> freeBlocks;
+            size_t maxBlocksPerSize;
+            size_t allocations;
+            size_t reuses;
+            size_t cachedBytes;
+            
+            static size_t blockSize(size_t bytes) {
+                return (bytes + FRAME_BUFFER_ALIGNMENT - 1) / FRAME_BUFFER_ALIGNMENT * FRAME_BUFFER_ALIGNMENT;
+            }
+            
+        public:
+            explicit BufferPool(size_t maxPerSize = MAX_FRAME_BUFFERS);
+            ~BufferPool();
+            
+            BufferPool(const BufferPool&) = delete;
+            BufferPool& operator=(const BufferPool&) = delete;
+            
+            // Block of at least `bytes` bytes; nullptr if the allocation fails
+            void* acquire(size_t bytes);
+            // Return a block obtained from acquire() with the same byte count
+            void release(void* block, size_t bytes);
+            // Free every cached block
+            void trim();
+            
+            // Cached blocks kept per size (raise it when more frames are in flight)
+            void setMaxBlocksPerSize(size_t count);
+            size_t getMaxBlocksPerSize() const;
+            
+            size_t getAllocationCount() const;
+            size_t getReuseCount() const;
+            size_t getCachedBytes() const;
+            void dumpStats() const;
+        };
+        
+        // Row pitch in elements, rounded up so that consecutive rows of T
+        // are a whole number of FRAME_BUFFER_ALIGNMENT units apart
+        template<typename T>
+        inline int alignedPitch(int elements) {
+            int unit = FRAME_BUFFER_ALIGNMENT / std::gcd(static_cast<int>(sizeof(T)), FRAME_BUFFER_ALIGNMENT);
+            return (elements + unit - 1) / unit * unit;
+        }
+        
+        // Simulates hardware frame buffer with alignment. A pooled buffer
+        // may carry an apron: `apron` spare pixels on every side of each row
+        // and `apron` spare rows above and below, so a stage can read a
+        // fixed distance past the frame edge with no bounds checks.
+        // getData() points at pixel (0, 0); rows are getStride() pixels apart.
+        // Pooled buffers built with alignRows start every row (pixel 0, not
+        // the apron) on a FRAME_BUFFER_ALIGNMENT boundary for aligned loads.
         class FrameBuffer {
         private:
             pixel* data;
             int width;
             int height;
+            int apron;
+            int lead;       // Pixels before pixel 0 of each row (apron, rounded up for aligned rows)
+            int stride;
             size_t capacity;
             bool ownsMemory;
             
+            // Backing file mapping (zero-copy frames loaded via mmap)
+            void* mappedRegion;
+            size_t mappedLength;
+            
+            // Pool the pixel storage is returned to (null = plain allocation)
+            BufferPool* pool;
+            
+            void releaseMapping();
+            void releaseStorage();
+            
         public:
+            // Empty buffer, filled later by move assignment
+            FrameBuffer()
+                : data(nullptr), width(0), height(0), apron(0), lead(0), stride(0), capacity(0),
+                  ownsMemory(false),
+                  mappedRegion(nullptr), mappedLength(0), pool(nullptr) {}
+            
             // Constructor with allocation
             FrameBuffer(int w, int h) 
-                : width(w), height(h), 
+                : width(w), height(h), apron(0), lead(0), stride(w),
                   capacity(w * h * sizeof(pixel)),
-                  ownsMemory(true) {
+                  ownsMemory(true),
+                  mappedRegion(nullptr), mappedLength(0), pool(nullptr) {
                 
                 #ifdef HW_SIMULATION
                     // Simulate aligned memory allocation for hardware
@@ -37,24 +123,46 @@ namespace hardware {
                 LOG_INFO("FrameBuffer created: " << width << "x" << height);
             }
             
+            // Constructor leasing aligned storage from a pool; the storage
+            // goes back to the pool when the buffer is destroyed
+            FrameBuffer(int w, int h, BufferPool& source)
+                : FrameBuffer(w, h, 0, source) {}
+            
+            // Pooled storage with a `margin`-pixel apron on every side
+            FrameBuffer(int w, int h, int margin, BufferPool& source, bool alignRows = false)
+                : width(w), height(h), apron(margin),
+                  lead(alignRows ? alignedPitch<pixel>(margin) : margin),
+                  stride(alignRows ? alignedPitch<pixel>(lead + w + margin) : w + 2 * margin),
+                  capacity(static_cast<size_t>(stride) * (h + 2 * margin) * sizeof(pixel)),
+                  ownsMemory(true),
+                  mappedRegion(nullptr), mappedLength(0), pool(&source) {
+                pixel* block = static_cast<pixel*>(source.acquire(capacity));
+                data = block ? block + static_cast<size_t>(apron) * stride + lead : nullptr;
+                LOG_INFO("FrameBuffer leased from pool: " << width << "x" << height << ", apron " << apron);
+            }
+            
             // Constructor wrapping existing memory
             FrameBuffer(pixel* existingData, int w, int h, bool takeOwnership = false)
-                : data(existingData), width(w), height(h),
+                : data(existingData), width(w), height(h), apron(0), lead(0), stride(w),
                   capacity(w * h * sizeof(pixel)),
-                  ownsMemory(takeOwnership) {
+                  ownsMemory(takeOwnership),
+                  mappedRegion(nullptr), mappedLength(0), pool(nullptr) {
                 LOG_INFO("FrameBuffer wrapped existing memory");
             }
             
+            // Constructor wrapping a pixel payload inside a file mapping.
+            // The mapping is released (munmap) when the buffer is destroyed.
+            FrameBuffer(pixel* payload, int w, int h, void* mapping, size_t mappingLength)
+                : data(payload), width(w), height(h), apron(0), lead(0), stride(w),
+                  capacity(w * h * sizeof(pixel)),
+                  ownsMemory(false),
+                  mappedRegion(mapping), mappedLength(mappingLength), pool(nullptr) {
+                LOG_INFO("FrameBuffer wrapped mapped file (" << mappingLength << " bytes)");
+            }
+            
             ~FrameBuffer() {
-                if (ownsMemory && data) {
-                    #ifdef HW_SIMULATION
-                        free(data);
-                    #else
-                        delete[] data;
-                    #endif
-                    LOG_MEMORY_FREE(data);
-                }
-                data = nullptr;
+                releaseStorage();
+                releaseMapping();
             }
             
             // Prevent copying
@@ -64,29 +172,39 @@ namespace hardware {
             // Allow moving
             FrameBuffer(FrameBuffer&& other) noexcept
                 : data(other.data), width(other.width), height(other.height),
-                  capacity(other.capacity), ownsMemory(other.ownsMemory) {
+                  apron(other.apron), lead(other.lead), stride(other.stride), capacity(other.capacity),
+                  ownsMemory(other.ownsMemory),
+                  mappedRegion(other.mappedRegion), mappedLength(other.mappedLength),
+                  pool(other.pool) {
                 other.data = nullptr;
                 other.ownsMemory = false;
+                other.mappedRegion = nullptr;
+                other.mappedLength = 0;
+                other.pool = nullptr;
             }
             
             FrameBuffer& operator=(FrameBuffer&& other) noexcept {
                 if (this != &other) {
-                    if (ownsMemory && data) {
-                        #ifdef HW_SIMULATION
-                            free(data);
-                        #else
-                            delete[] data;
-                        #endif
-                    }
+                    releaseStorage();
+                    releaseMapping();
                     
                     data = other.data;
                     width = other.width;
                     height = other.height;
+                    apron = other.apron;
+                    lead = other.lead;
+                    stride = other.stride;
                     capacity = other.capacity;
                     ownsMemory = other.ownsMemory;
+                    mappedRegion = other.mappedRegion;
+                    mappedLength = other.mappedLength;
+                    pool = other.pool;
                     
                     other.data = nullptr;
                     other.ownsMemory = false;
+                    other.mappedRegion = nullptr;
+                    other.mappedLength = 0;
+                    other.pool = nullptr;
                 }
                 return *this;
             }
@@ -94,39 +212,85 @@ namespace hardware {
             // Accessors
             pixel* getData() { return data; }
             const pixel* getData() const { return data; }
+            pixel* row(int y) { return data + static_cast<long>(y) * stride; }
+            const pixel* row(int y) const { return data + static_cast<long>(y) * stride; }
             int getWidth() const { return width; }
             int getHeight() const { return height; }
+            int getApron() const { return apron; }
+            int getStride() const { return stride; }
             size_t getSize() const { return width * height; }
+            
+            // The frame, or a rectangle of it, as a strided view
+            hardware::filters::ImageView view() { return {data, width, height, stride}; }
+            hardware::filters::ImageView view(int x, int y, int w, int h) { return view().region(x, y, w, h); }
             size_t getCapacity() const { return capacity; }
+            bool isMapped() const { return mappedRegion != nullptr; }
+            bool isPooled() const { return pool != nullptr; }
+            
+            // Drop the pixel storage (back to its pool, if any) and any file mapping
+            void reset() {
+                releaseStorage();
+                releaseMapping();
+                width = height = 0;
+                apron = lead = stride = 0;
+                capacity = 0;
+                ownsMemory = false;
+                pool = nullptr;
+            }
             
             // Operations
             void clear() {
                 if (data) {
-                    memset(data, 0, capacity);
+                    memset(data - static_cast<size_t>(apron) * stride - lead, 0, capacity);
                     LOG_VERBOSE("FrameBuffer cleared");
                 }
             }
             
+            // Packed width x height pixels in and out (the apron is skipped)
             void copyFrom(const pixel* source) {
                 if (data && source) {
-                    memcpy(data, source, width * height * sizeof(pixel));
+                    if (stride == width) {
+                        memcpy(data, source, width * height * sizeof(pixel));
+                    } else {
+                        for (int y = 0; y < height; y++) {
+                            memcpy(row(y), source + static_cast<size_t>(y) * width, width * sizeof(pixel));
+                        }
+                    }
                     LOG_VERBOSE("FrameBuffer copied from source");
                 }
             }
             
             void copyTo(pixel* dest) const {
                 if (data && dest) {
-                    memcpy(dest, data, width * height * sizeof(pixel));
+                    if (stride == width) {
+                        memcpy(dest, data, width * height * sizeof(pixel));
+                    } else {
+                        for (int y = 0; y < height; y++) {
+                            memcpy(dest + static_cast<size_t>(y) * width, row(y), width * sizeof(pixel));
+                        }
+                    }
                     LOG_VERBOSE("FrameBuffer copied to destination");
                 }
             }
             
+            // Fill the innermost `radius` apron pixels around the frame for
+            // `mode`; runs before each stage that reads this buffer
+            void fillBorder(int radius, hardware::filters::BorderMode mode, uint8_t constant = 0) {
+                if (data) {
+                    hardware::filters::fillApron(data, width, height, stride, std::min(radius, apron),
+                                                 mode, constant);
+                }
+            }
+            
             void dumpInfo() const {
                 LOG_INFO("FrameBuffer Info:");
                 LOG_INFO("  Dimensions: " << width << "x" << height);
                 LOG_INFO("  Size: " << (width * height) << " pixels");
+                LOG_INFO("  Apron: " << apron << " pixels (stride " << stride << ")");
                 LOG_INFO("  Capacity: " << capacity << " bytes");
                 LOG_INFO("  Memory owned: " << (ownsMemory ? "yes" : "no"));
+                LOG_INFO("  File mapped: " << (mappedRegion ? "yes" : "no"));
+                LOG_INFO("  Pooled: " << (pool ? "yes" : "no"));
                 LOG_INFO("  Data pointer: " << static_cast<void*>(data));
                 
                 #ifdef HW_SIMULATION
@@ -137,23 +301,251 @@ namespace hardware {
             }
         };
         
-        // Simulates hardware FIFO (First-In-First-Out buffer)
+        // Single-channel 8-bit plane. Everything after grayscale conversion
+        // carries one intensity per pixel, so stages move a third of the bytes
+        // an RGB FrameBuffer would. Pooled planes may carry an apron and
+        // aligned rows, laid out as in FrameBuffer.
+        class GrayPlane {
+        private:
+            uint8_t* data;
+            int width;
+            int height;
+            int apron;
+            int lead;
+            int stride;
+            size_t capacity;
+            BufferPool* pool;
+            
+            void release() {
+                if (!data)
+                    return;
+                if (pool) {
+                    pool->release(data - static_cast<size_t>(apron) * stride - lead, capacity);
+                } else {
+                    #ifdef HW_SIMULATION
+                        free(data);
+                    #else
+                        delete[] data;
+                    #endif
+                    LOG_MEMORY_FREE(data);
+                }
+                data = nullptr;
+            }
+            
+        public:
+            // Empty plane, filled later by move assignment
+            GrayPlane() : data(nullptr), width(0), height(0), apron(0), lead(0), stride(0), capacity(0), pool(nullptr) {}
+            
+            GrayPlane(int w, int h)
+                : width(w), height(h), apron(0), lead(0), stride(w),
+                  capacity(static_cast<size_t>(w) * h), pool(nullptr) {
+                
+                #ifdef HW_SIMULATION
+                    // aligned_alloc wants a whole number of alignment units
+                    size_t rounded = (capacity + FRAME_BUFFER_ALIGNMENT - 1) /
+                                     FRAME_BUFFER_ALIGNMENT * FRAME_BUFFER_ALIGNMENT;
+                    data = static_cast<uint8_t*>(aligned_alloc(FRAME_BUFFER_ALIGNMENT, rounded));
+                #else
+                    data = new uint8_t[capacity];
+                #endif
+                
+                LOG_MEMORY_ALLOC(capacity, data);
+                LOG_INFO("GrayPlane created: " << width << "x" << height);
+            }
+            
+            GrayPlane(int w, int h, BufferPool& source)
+                : GrayPlane(w, h, 0, source) {}
+            
+            GrayPlane(int w, int h, int margin, BufferPool& source, bool alignRows = false)
+                : width(w), height(h), apron(margin),
+                  lead(alignRows ? alignedPitch<uint8_t>(margin) : margin),
+                  stride(alignRows ? alignedPitch<uint8_t>(lead + w + margin) : w + 2 * margin),
+                  capacity(static_cast<size_t>(stride) * (h + 2 * margin)), pool(&source) {
+                uint8_t* block = static_cast<uint8_t*>(source.acquire(capacity));
+                data = block ? block + static_cast<size_t>(apron) * stride + lead : nullptr;
+                LOG_INFO("GrayPlane leased from pool: " << width << "x" << height << ", apron " << apron);
+            }
+            
+            ~GrayPlane() { release(); }
+            
+            GrayPlane(const GrayPlane&) = delete;
+            GrayPlane& operator=(const GrayPlane&) = delete;
+            
+            GrayPlane(GrayPlane&& other) noexcept
+                : data(other.data), width(other.width), height(other.height),
+                  apron(other.apron), lead(other.lead), stride(other.stride), capacity(other.capacity),
+                  pool(other.pool) {
+                other.data = nullptr;
+                other.pool = nullptr;
+            }
+            
+            GrayPlane& operator=(GrayPlane&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    data = other.data;
+                    width = other.width;
+                    height = other.height;
+                    apron = other.apron;
+                    lead = other.lead;
+                    stride = other.stride;
+                    capacity = other.capacity;
+                    pool = other.pool;
+                    other.data = nullptr;
+                    other.pool = nullptr;
+                }
+                return *this;
+            }
+            
+            uint8_t* getData() { return data; }
+            const uint8_t* getData() const { return data; }
+            uint8_t* row(int y) { return data + static_cast<long>(y) * stride; }
+            const uint8_t* row(int y) const { return data + static_cast<long>(y) * stride; }
+            int getWidth() const { return width; }
+            int getHeight() const { return height; }
+            int getApron() const { return apron; }
+            int getStride() const { return stride; }
+            size_t getSize() const { return static_cast<size_t>(width) * height; }
+            
+            hardware::filters::GrayImageView view() { return {data, width, height, stride}; }
+            hardware::filters::GrayImageView view(int x, int y, int w, int h) { return view().region(x, y, w, h); }
+            size_t getCapacity() const { return capacity; }
+            
+            // Drop the storage (back to its pool, if any)
+            void reset() {
+                release();
+                width = height = 0;
+                apron = lead = stride = 0;
+                capacity = 0;
+                pool = nullptr;
+            }
+            
+            void clear() {
+                if (data) {
+                    memset(data - static_cast<size_t>(apron) * stride - lead, 0, capacity);
+                    LOG_VERBOSE("GrayPlane cleared");
+                }
+            }
+            
+            // Replicate every intensity into the three channels of a packed RGB frame
+            void expandTo(pixel* dest) const {
+                if (data && dest) {
+                    for (int y = 0; y < height; y++) {
+                        const uint8_t* src = row(y);
+                        pixel* out = dest + static_cast<size_t>(y) * width;
+                        for (int x = 0; x < width; x++) {
+                            out[x].r = out[x].g = out[x].b = src[x];
+                        }
+                    }
+                    LOG_VERBOSE("GrayPlane expanded to RGB");
+                }
+            }
+            
+            // As FrameBuffer::fillBorder
+            void fillBorder(int radius, hardware::filters::BorderMode mode, uint8_t constant = 0) {
+                if (data) {
+                    hardware::filters::fillApron(data, width, height, stride, std::min(radius, apron),
+                                                 mode, constant);
+                }
+            }
+        };
+        
+        // Simulates an FPGA line buffer: a ring holding the most recent
+        // `lines` rows of a frame, indexed by absolute row number. Each line
+        // may carry `apron` spare pixels on both sides for border fill.
+        // T is pixel for RGB stages and uint8_t for gray planes.
+        template<typename T>
+        class LineBuffer {
+        private:
+            std::vector<T> storage;
+            int width;
+            int lines;
+            int apron;
+            
+            size_t offset(int y) const {
+                return static_cast<size_t>(y % lines) * (width + 2 * apron) + apron;
+            }
+            
+        public:
+            LineBuffer(int w, int k, int margin = 0)
+                : storage(static_cast<size_t>(w + 2 * margin) * k), width(w), lines(k), apron(margin) {
+                LOG_VERBOSE("LineBuffer created: " << k << " lines of " << w << " pixels");
+            }
+            
+            T* line(int y) { return &storage[offset(y)]; }
+            const T* line(int y) const { return &storage[offset(y)]; }
+            
+            int getWidth() const { return width; }
+            int getLineCount() const { return lines; }
+            int getApron() const { return apron; }
+            size_t getCapacity() const { return storage.size() * sizeof(T); }
+        };
+        
+        // Simulates hardware FIFO (First-In-First-Out buffer).
+        // Lock-free single-producer/single-consumer ring: one thread may push
+        // while another pops. Indices run freely and are masked into the
+        // power-of-two buffer; producer and consumer state sit on separate
+        // cache lines so the two sides never share a line they write.
         template<typename T, int CAPACITY>
         class FIFO {
         private:
-            T buffer[CAPACITY];
-            int head;
-            int tail;
-            int count;
+            static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                          "FIFO capacity must be a power of two");
+            static constexpr size_t MASK = CAPACITY - 1;
+            
+            // Consumer side: next slot to read, plus its view of the producer
+            alignas(FRAME_BUFFER_ALIGNMENT) std::atomic<size_t> head;
+            size_t cachedTail;
+            #ifdef HW_SIMULATION
+                std::atomic<int> underflowCount;
+            #endif
             
+            // Producer side: next slot to write, plus its view of the consumer
+            alignas(FRAME_BUFFER_ALIGNMENT) std::atomic<size_t> tail;
+            size_t cachedHead;
             #ifdef HW_SIMULATION
-                // Hardware simulation registers
-                int overflowCount;
-                int underflowCount;
+                std::atomic<int> overflowCount;
             #endif
             
+            alignas(FRAME_BUFFER_ALIGNMENT) T buffer[CAPACITY];
+            
+            // Free slots as seen by the producer (refreshes its copy of head only when needed)
+            size_t writable(size_t position, size_t wanted) {
+                size_t space = CAPACITY - (position - cachedHead);
+                if (space < wanted) {
+                    cachedHead = head.load(std::memory_order_acquire);
+                    space = CAPACITY - (position - cachedHead);
+                }
+                return space;
+            }
+            
+            // Filled slots as seen by the consumer
+            size_t readable(size_t position, size_t wanted) {
+                size_t available = cachedTail - position;
+                if (available < wanted) {
+                    cachedTail = tail.load(std::memory_order_acquire);
+                    available = cachedTail - position;
+                }
+                return available;
+            }
+            
+            void reportOverflow() {
+                LOG_WARNING("FIFO overflow");
+                #ifdef HW_SIMULATION
+                    overflowCount.fetch_add(1, std::memory_order_relaxed);
+                    DUMP_REGISTER("FIFO_OVERFLOW", overflowCount.load(std::memory_order_relaxed));
+                #endif
+            }
+            
+            void reportUnderflow() {
+                LOG_WARNING("FIFO underflow");
+                #ifdef HW_SIMULATION
+                    underflowCount.fetch_add(1, std::memory_order_relaxed);
+                    DUMP_REGISTER("FIFO_UNDERFLOW", underflowCount.load(std::memory_order_relaxed));
+                #endif
+            }
+            
         public:
-            FIFO() : head(0), tail(0), count(0) {
+            FIFO() : head(0), cachedTail(0), tail(0), cachedHead(0) {
                 #ifdef HW_SIMULATION
                     overflowCount = 0;
                     underflowCount = 0;
@@ -161,54 +553,94 @@ namespace hardware {
                 LOG_VERBOSE("FIFO created with capacity " << CAPACITY);
             }
             
+            FIFO(const FIFO&) = delete;
+            FIFO& operator=(const FIFO&) = delete;
+            
+            // Producer thread only
             bool push(const T& item) {
-                if (count >= CAPACITY) {
-                    LOG_WARNING("FIFO overflow");
-                    #ifdef HW_SIMULATION
-                        overflowCount++;
-                        DUMP_REGISTER("FIFO_OVERFLOW", overflowCount);
-                    #endif
+                size_t position = tail.load(std::memory_order_relaxed);
+                if (writable(position, 1) == 0) {
+                    reportOverflow();
                     return false;
                 }
                 
-                buffer[tail] = item;
-                tail = (tail + 1) % CAPACITY;
-                count++;
+                buffer[position & MASK] = item;
+                tail.store(position + 1, std::memory_order_release);
                 
-                LOG_VERBOSE("FIFO push: count=" << count);
+                LOG_VERBOSE("FIFO push: count=" << (position + 1 - cachedHead));
                 #ifdef HW_SIMULATION
-                    DUMP_REGISTER("FIFO_COUNT", count);
+                    DUMP_REGISTER("FIFO_COUNT", position + 1 - cachedHead);
                 #endif
                 
                 return true;
             }
             
+            // Producer thread only. Copies as many of `count` items as fit,
+            // as at most two contiguous spans, and publishes them at once.
+            // Returns the number pushed; a short burst counts as an overflow.
+            size_t push_burst(const T* items, size_t count) {
+                size_t position = tail.load(std::memory_order_relaxed);
+                size_t accepted = std::min(count, writable(position, count));
+                
+                size_t first = position & MASK;
+                size_t span = std::min(accepted, CAPACITY - first);
+                std::copy(items, items + span, buffer + first);
+                std::copy(items + span, items + accepted, buffer);
+                tail.store(position + accepted, std::memory_order_release);
+                
+                if (accepted < count) {
+                    reportOverflow();
+                }
+                LOG_VERBOSE("FIFO burst push: " << accepted << "/" << count);
+                return accepted;
+            }
+            
+            // Consumer thread only
             bool pop(T& item) {
-                if (count <= 0) {
-                    LOG_WARNING("FIFO underflow");
-                    #ifdef HW_SIMULATION
-                        underflowCount++;
-                        DUMP_REGISTER("FIFO_UNDERFLOW", underflowCount);
-                    #endif
+                size_t position = head.load(std::memory_order_relaxed);
+                if (readable(position, 1) == 0) {
+                    reportUnderflow();
                     return false;
                 }
                 
-                item = buffer[head];
-                head = (head + 1) % CAPACITY;
-                count--;
+                item = buffer[position & MASK];
+                head.store(position + 1, std::memory_order_release);
                 
-                LOG_VERBOSE("FIFO pop: count=" << count);
+                LOG_VERBOSE("FIFO pop: count=" << (cachedTail - position - 1));
                 return true;
             }
             
-            bool isEmpty() const { return count == 0; }
-            bool isFull() const { return count == CAPACITY; }
-            int size() const { return count; }
+            // Consumer thread only. Copies up to `count` items out as at most
+            // two contiguous spans; a short burst counts as an underflow.
+            size_t pop_burst(T* items, size_t count) {
+                size_t position = head.load(std::memory_order_relaxed);
+                size_t delivered = std::min(count, readable(position, count));
+                
+                size_t first = position & MASK;
+                size_t span = std::min(delivered, CAPACITY - first);
+                std::copy(buffer + first, buffer + first + span, items);
+                std::copy(buffer, buffer + (delivered - span), items + span);
+                head.store(position + delivered, std::memory_order_release);
+                
+                if (delivered < count) {
+                    reportUnderflow();
+                }
+                LOG_VERBOSE("FIFO burst pop: " << delivered << "/" << count);
+                return delivered;
+            }
+            
+            // Snapshots; exact only when the other side is idle
+            bool isEmpty() const { return size() == 0; }
+            bool isFull() const { return size() == CAPACITY; }
+            int size() const {
+                size_t filled = tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+                return static_cast<int>(std::min(filled, static_cast<size_t>(CAPACITY)));
+            }
             int getCapacity() const { return CAPACITY; }
             
             #ifdef HW_SIMULATION
-                int getOverflowCount() const { return overflowCount; }
-                int getUnderflowCount() const { return underflowCount; }
+                int getOverflowCount() const { return overflowCount.load(std::memory_order_relaxed); }
+                int getUnderflowCount() const { return underflowCount.load(std::memory_order_relaxed); }
                 
                 void resetStats() {
                     overflowCount = 0;
@@ -216,10 +648,12 @@ namespace hardware {
                 }
             #endif
             
+            // Only while neither side is active
             void clear() {
-                head = 0;
-                tail = 0;
-                count = 0;
+                head.store(0, std::memory_order_relaxed);
+                tail.store(0, std::memory_order_relaxed);
+                cachedHead = 0;
+                cachedTail = 0;
                 LOG_VERBOSE("FIFO cleared");
             }
         };
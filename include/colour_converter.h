@@ -2,11 +2,16 @@
 #define COLOUR_CONVERTER_H
 
 #include "pixel.h"
+#include <cstdint>
 
 namespace hardware {
     namespace pipeline {
         
         void convertToGrayscale(pixel* frame, int width, int height);
+        void convertToGrayscale(const pixel* input, pixel* output, int width, int height);
+        
+        // Write luma straight into a single-channel plane
+        void convertToGrayscale(const pixel* input, uint8_t* output, int width, int height);
         
     }
 }
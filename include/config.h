@@ -1,6 +1,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <cstddef>
+
 // Add this near other configuration macros
 #ifndef HAS_CONVOLUTION
 #define HAS_CONVOLUTION 1  // Enable convolution engine
@@ -17,6 +19,10 @@ namespace hardware {
         constexpr int DEFAULT_WIDTH = 640;
         constexpr int DEFAULT_HEIGHT = 480;
         constexpr int MAX_PIPELINE_STAGES = 10;
+        constexpr int MAX_FUSED_RADIUS = 4;     // Largest combined footprint of a fused stage group
+        constexpr int DEFAULT_TILE_SIZE = 512;  // Tile edge of created out-of-core (.tiles) images
+        constexpr int LAZY_TILE_SIZE = 128;     // Tile edge of demand-driven (lazy) evaluation
+        constexpr size_t LAZY_CACHE_BYTES = size_t(256) << 20;  // Tiles kept by a lazy evaluator
         
         // Processing modes
         enum class ProcessingMode {
@@ -24,6 +30,13 @@ namespace hardware {
             FIXED_POINT,
             HARDWARE_SIM
         };
+        
+        // Execution strategies for the stage chain
+        enum class ExecutionMode {
+            FRAME,      // Materialize a full frame between stages
+            STREAMING,  // Stream rows through per-stage line buffers
+            LAZY        // Compute only the stage tiles the output needs (see LazyEvaluator)
+        };
     }
     
     namespace memory {
@@ -44,6 +57,18 @@ namespace hardware {
         using Kernel3x3 = KernelSize<3>;
         using Kernel5x5 = KernelSize<5>;
         using Kernel7x7 = KernelSize<7>;
+        
+        // Largest runtime radius of the running-sum filters (column sums of
+        // 2r+1 8-bit samples must fit 16 bits)
+        constexpr int MAX_BOX_RADIUS = 127;
+        
+        // Gaussian blurs above this sigma run as the recursive filter, whose
+        // cost per pixel does not depend on sigma (createGaussianBlur)
+        constexpr float RECURSIVE_GAUSSIAN_MIN_SIGMA = 4.0f;
+        constexpr float MAX_GAUSSIAN_SIGMA = 32.0f;
+        
+        // Largest tile transform of the FFT convolution (N x N floats, twice)
+        constexpr int MAX_FFT_SIZE = 1024;
     }
 }
 
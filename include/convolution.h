@@ -3,6 +3,7 @@
 
 #include "base_filter.h"
 #include "pixel.h"
+#include "fixed_point.h"
 #include <vector>
 #include <cmath>
 #include <cstdint>
@@ -26,8 +27,28 @@ namespace hardware
             int kernelSize;
             int kernelRadius;
 
+            // Rank-1 factorization: kernel[i][j] == columnKernel[i] * rowKernel[j]
+            bool separable;
+            std::vector<float> rowKernel;
+            std::vector<float> columnKernel;
+            std::vector<KernelTap> rowTaps;    // Quantized once for the accumulate loops
+            std::vector<KernelTap> columnTaps;
+            std::vector<KernelTap> denseTaps;
+
+            void quantizeDense();
+            void detectSeparable();
+            void setSeparable(const std::vector<float> &row, const std::vector<float> &column);
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band);
+            template <typename T>
+            void processRowsDense(const BasicRowBand<T> &band);
+            template <typename T>
+            void processRowsSeparable(const BasicRowBand<T> &band);
+
         public:
             ConvolutionFilter(const std::vector<float> &k, int size);
+            // Separable kernel given as its row and column vectors (same odd length)
+            ConvolutionFilter(const std::vector<float> &row, const std::vector<float> &column);
 
             static ConvolutionFilter *createGaussian(int size, float sigma);
             static ConvolutionFilter *createSharpen();
@@ -35,9 +56,18 @@ namespace hardware
             static ConvolutionFilter *createSobelY();
 
             void apply(pixel *input, pixel *output, int width, int height) override;
+            void processRows(const RowBand &band) override;
+            void processRows(const GrayRowBand &band) override;
+            const char *getName() const override { return "convolution"; }
+            int getRadius() const override { return kernelRadius; }
+            int getMultiplierCount() const override;    // Non-zero taps of the path in use
+            bool supportsFormat(PixelFormat) const override { return true; }
 
             void printKernel() const;
             int getKernelSize() const { return kernelSize; }
+            bool isSeparable() const { return separable; }
+            // Filter a rank-1 kernel with the dense path (to check one path against the other)
+            void forceDense() { separable = false; }
         };
 
         // Template version for compile-time kernel sizes
@@ -59,47 +89,72 @@ namespace hardware
                 }
             }
 
+            const char *getName() const override { return "template convolution"; }
+            int getRadius() const override { return KERNEL_SIZE / 2; }
+
             void apply(pixel *input, pixel *output, int width, int height) override
             {
+                applyRows(input, output, width, height);
+            }
+
+            bool supportsFormat(PixelFormat) const override { return true; }
+
+            void processRows(const RowBand &band) override { processBand(band); }
+            void processRows(const GrayRowBand &band) override { processBand(band); }
+
+        private:
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band)
+            {
+                // Every byte of a pixel is an independent channel (3 for RGB, 1 for gray)
+                const int channels = sizeof(T);
                 int radius = KERNEL_SIZE / 2;
+                int width = band.width;
+                int height = band.height;
+                bool padded = band.padded();
+                int x0 = padded ? 0 : radius;
+                int x1 = padded ? width : width - radius;
 
-                for (int y = radius; y < height - radius; y++)
+                for (int y = band.y0; y < band.y1; y++)
                 {
-                    for (int x = radius; x < width - radius; x++)
+                    const T *center = band.inputRow(y);
+                    T *out = band.outputRow(y);
+
+                    // Handle borders
+                    if (!padded && (y < radius || y >= height - radius))
                     {
-                        float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
+                        for (int x = 0; x < width; x++)
+                        {
+                            out[x] = center[x];
+                        }
+                        continue;
+                    }
 
-                        for (int ky = -radius; ky <= radius; ky++)
+                    uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                    for (int x = x0; x < x1; x++)
+                    {
+                        for (int c = 0; c < channels; c++)
                         {
-                            for (int kx = -radius; kx <= radius; kx++)
-                            {
-                                int idx = (y + ky) * width + (x + kx);
-                                float weight = kernel[ky + radius][kx + radius];
+                            float sum = 0.0f;
 
-                                sum_r += input[idx].r * weight;
-                                sum_g += input[idx].g * weight;
-                                sum_b += input[idx].b * weight;
+                            for (int ky = -radius; ky <= radius; ky++)
+                            {
+                                const uint8_t *row = reinterpret_cast<const uint8_t *>(band.inputRow(y + ky));
+                                for (int kx = -radius; kx <= radius; kx++)
+                                {
+                                    float weight = kernel[ky + radius][kx + radius];
+                                    sum += row[(x + kx) * channels + c] * weight;
+                                }
                             }
-                        }
 
-                        // Clamp and store (using custom clamp)
-                        int idx = y * width + x;
-                        output[idx].r = static_cast<uint8_t>(clamp_value(sum_r, 0.0f, 255.0f));
-                        output[idx].g = static_cast<uint8_t>(clamp_value(sum_g, 0.0f, 255.0f));
-                        output[idx].b = static_cast<uint8_t>(clamp_value(sum_b, 0.0f, 255.0f));
+                            // Clamp and store (using custom clamp)
+                            dst[x * channels + c] = static_cast<uint8_t>(clamp_value(sum, 0.0f, 255.0f));
+                        }
                     }
-                }
 
-                // Handle borders
-                for (int y = 0; y < height; y++)
-                {
-                    for (int x = 0; x < width; x++)
+                    if (!padded)
                     {
-                        if (y < radius || y >= height - radius ||
-                            x < radius || x >= width - radius)
-                        {
-                            output[y * width + x] = input[y * width + x];
-                        }
+                        copyEdgeColumns(center, out, width, radius);
                     }
                 }
             }
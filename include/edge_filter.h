@@ -18,6 +18,12 @@ namespace hardware
             EdgeFilter();
             ~EdgeFilter();
             void apply(pixel *input, pixel *output, int width, int height) override;
+            void processRows(const RowBand &band) override;
+            void processRows(const GrayRowBand &band) override;
+            const char *getName() const override { return "edge"; }
+            int getRadius() const override { return 1; }
+            int getMultiplierCount() const override { return 0; }   // Sobel weights are shifts and adds
+            bool supportsFormat(PixelFormat) const override { return true; }
         };
     }
 }
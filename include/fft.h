@@ -0,0 +1,49 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace fft
+        {
+            // Smallest power of two >= n
+            int nextPowerOfTwo(int n);
+
+            // Radix-2 decimation-in-time FFT of one power-of-two size, with
+            // its bit-reversal and twiddle tables built once. Data is split
+            // into real and imaginary arrays so butterflies vectorize.
+            // Transforms are unnormalized: inverse(forward(x)) = N * x.
+            class Plan
+            {
+            private:
+                int n;
+                std::vector<int> reversed;      // Bit-reversed index of each position
+                std::vector<float> cosines;     // cos(2*pi*k/n), k < n/2
+                std::vector<float> sines;       // sin(2*pi*k/n)
+
+            public:
+                explicit Plan(int size = 1);
+
+                int size() const { return n; }
+
+                // One sequence of size() values, in place
+                void transform(float *re, float *im, bool inverse) const;
+
+                // A size() x size() row-major array, in place, left
+                // transposed: transforming back restores the layout, and a
+                // spectrum made by the same call lines up with the data.
+                // Both passes run down columns, so every butterfly combines
+                // two whole rows.
+                void transform2D(float *re, float *im, bool inverse) const;
+
+            private:
+                void transformColumns(float *re, float *im, bool inverse) const;
+            };
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef FFT_CONVOLUTION_H
+#define FFT_CONVOLUTION_H
+
+#include "block_filter.h"
+#include "fft.h"
+#include <cstdint>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        // Dense K x K convolution (a correlation, like ConvolutionFilter)
+        // computed per tile in the frequency domain. The kernel's spectrum
+        // is computed once, at construction. Each block of L = N - K + 1
+        // rows (see BlockFilter) is cut into L x L output tiles; a tile's
+        // N x N input (the tile plus the kernel's reach) is transformed,
+        // multiplied by the spectrum and transformed back, and the wrapped
+        // part of the result is discarded (overlap-save). Two real planes,
+        // channels or neighbouring tiles, share one complex transform.
+        //
+        // A tile costs O(N^2 log N) whatever K is, against K^2 multiplies
+        // per output sample done directly; planConvolution() picks the
+        // cheaper one. Sums are converted back as ConvolutionFilter does
+        // (truncated, or rounded half up under USE_FIXED_POINT, where the
+        // taps are first quantized like the direct path's), so both paths
+        // agree up to float rounding.
+        class FftConvolutionFilter : public BlockFilter
+        {
+        private:
+            int kernelSize;
+            int kernelRadius;
+            fft::Plan plan;
+            std::vector<float> spectrumRe;  // conj(FFT(kernel)) / N^2
+            std::vector<float> spectrumIm;
+
+            template <typename T>
+            void filterTiles(const BasicRowBand<T> &band, int first, int last, T *out);
+
+        protected:
+            void filterBlock(const RowBand &band, int first, int last, pixel *out) override;
+            void filterBlock(const GrayRowBand &band, int first, int last, uint8_t *out) override;
+
+        public:
+            // fftSize 0 lets planConvolution() choose the transform size
+            FftConvolutionFilter(const std::vector<float> &k, int size, int fftSize = 0);
+
+            void apply(pixel *input, pixel *output, int width, int height) override;
+            const char *getName() const override { return "fft convolution"; }
+            int getRadius() const override { return blockRows - 1 + kernelRadius; }
+            int getFootprint() const override { return kernelRadius; }
+            int getMultiplierCount() const override;    // Per output sample, amortized over a tile
+            bool supportsFormat(PixelFormat) const override { return true; }
+
+            int getKernelSize() const { return kernelSize; }
+            int getFftSize() const { return plan.size(); }
+        };
+
+        enum class ConvolutionPath
+        {
+            DIRECT,     // K^2 multiplies per sample
+            SEPARABLE,  // 2K multiplies per sample (rank-1 kernels only)
+            FFT         // Tiled transforms of fftSize
+        };
+
+        struct ConvolutionPlan
+        {
+            ConvolutionPath path;
+            int fftSize;            // FFT path only
+            float cost;             // Estimated time per output sample, in direct multiply-adds
+        };
+
+        // Cheapest way to run a K x K kernel. With the frame size known the
+        // FFT estimate includes the partial tiles at its right and bottom
+        // edges; without it tiles are assumed full.
+        ConvolutionPlan planConvolution(int kernelSize, bool separable, int width = 0, int height = 0);
+
+        // Convolution stage on the path planConvolution() picks
+        BaseFilter *createConvolution(const std::vector<float> &kernel, int size, int width = 0, int height = 0);
+
+        // Unsharp mask: the sample plus `amount` times its difference from
+        // a Gaussian blur of the given sigma (size 2*ceil(3*sigma)+1). The
+        // kernel is not separable.
+        std::vector<float> unsharpMaskKernel(float sigma, float amount, int &size);
+    }
+}
+
+#endif
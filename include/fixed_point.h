@@ -1,11 +1,86 @@
 // In fixed_point.h:
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cstdint>
+#include <type_traits>
+
+namespace hardware {
+    namespace fixed {
+
+        // Q-format number: a sign bit, IntBits integer bits and FracBits
+        // fraction bits held in Storage. Products widen to Wide (32 bits for
+        // 16-bit storage, like a DSP slice's 16x16->32 multiplier), so a sum
+        // of products is accumulated exactly and rounded once at the end.
+        template <int IntBits, int FracBits, typename Storage = int16_t>
+        struct Fixed {
+            static_assert(std::is_signed<Storage>::value, "Storage must be signed");
+            static_assert(IntBits >= 0 && FracBits >= 0 &&
+                          IntBits + FracBits + 1 <= static_cast<int>(sizeof(Storage) * 8),
+                          "Q format does not fit its storage");
+
+            typedef Storage StorageType;
+            typedef typename std::conditional<(sizeof(Storage) <= 2), int32_t, int64_t>::type Wide;
+
+            static constexpr int INT_BITS = IntBits;
+            static constexpr int FRAC_BITS = FracBits;
+            static constexpr Wide ONE = Wide(1) << FracBits;
+            static constexpr Wide MAX_RAW = (Wide(1) << (IntBits + FracBits)) - 1;
+            static constexpr Wide MIN_RAW = -(Wide(1) << (IntBits + FracBits));
+
+            Storage raw;
+
+            static constexpr Fixed fromRaw(Storage value) { return Fixed{value}; }
+
+            // Round to nearest, saturating to the representable range
+            static constexpr Fixed fromFloat(float value) {
+                float scaled = value * ONE + (value < 0 ? -0.5f : 0.5f);
+                if (scaled >= MAX_RAW)
+                    return fromRaw(static_cast<Storage>(MAX_RAW));
+                if (scaled <= MIN_RAW)
+                    return fromRaw(static_cast<Storage>(MIN_RAW));
+                return fromRaw(static_cast<Storage>(scaled));
+            }
+
+            constexpr float toFloat() const { return static_cast<float>(raw) / ONE; }
+
+            // acc + this * sample, in the wide type
+            constexpr Wide mac(Wide acc, Wide sample) const { return acc + static_cast<Wide>(raw) * sample; }
+        };
+
+        // Accumulator with FRAC fraction bits back to an 8-bit sample:
+        // round half up, then saturate to [0, 255]
+        template <int FRAC, typename Wide>
+        constexpr uint8_t roundToPixel(Wide acc) {
+            Wide value = acc;
+            if constexpr (FRAC > 0)
+                value = (acc + (Wide(1) << (FRAC - 1))) >> FRAC;
+            return static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+
+        // Kernel coefficients: Q7.8 fills one 16-bit SIMD lane and a pair
+        // of them feeds one pmaddwd (16x16 multiply, 32-bit pairwise sum)
+        typedef Fixed<7, 8, int16_t> Q7_8;
+
+    } // namespace fixed
+} // namespace hardware
+
 #ifdef USE_FIXED_POINT
-    typedef int Fixed;
+    typedef int Fixed;                              // Wide accumulator
+    typedef hardware::fixed::Q7_8 KernelTap;        // Quantized once per kernel
     #define FP_SCALE 256
     #define TO_FIXED(x) ((Fixed)((x) * FP_SCALE))
     #define FROM_FIXED(x) ((uint8_t)((x) / FP_SCALE))
+    #define TO_TAP(x) (KernelTap::fromFloat(x))
+    #define TAP_WEIGHT(t) ((t).raw)
+    static_assert(FP_SCALE == KernelTap::ONE, "Tap format must match FP_SCALE");
 #else
     typedef float Fixed;
+    typedef float KernelTap;
     #define TO_FIXED(x) (x)
     #define FROM_FIXED(x) ((uint8_t)(x))
-#endif
\ No newline at end of file
+    #define TO_TAP(x) (x)
+    #define TAP_WEIGHT(t) (t)
+#endif
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,59 @@
+#ifndef FUSED_FILTER_H
+#define FUSED_FILTER_H
+
+#include "base_filter.h"
+#include <string>
+
+namespace hardware
+{
+    namespace filters
+    {
+        // Two neighbourhood filters run as one sweep: the output of `first` is
+        // kept in a rolling ring of 2*r2+1 rows (r2 = second's radius) and fed
+        // straight to `second`, so the intermediate frame is never written.
+        // Every intermediate row is computed exactly as the unfused pipeline
+        // would compute it, so results are bit-identical. The parts are not
+        // owned; they must outlive the fused filter.
+        class FusedFilter : public BaseFilter
+        {
+        private:
+            BaseFilter *first;
+            BaseFilter *second;
+            std::string name;
+
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band);
+
+        public:
+            FusedFilter(BaseFilter *firstStage, BaseFilter *secondStage);
+
+            void apply(pixel *input, pixel *output, int width, int height) override;
+            void beginFrame() override
+            {
+                first->beginFrame();
+                second->beginFrame();
+            }
+            void processRows(const RowBand &band) override;
+            void processRows(const GrayRowBand &band) override;
+
+            // "first+second"
+            const char *getName() const override { return name.c_str(); }
+
+            // Footprint of the pair: the second filter reads first's rows y-r2..y+r2
+            int getRadius() const override { return first->getRadius() + second->getRadius(); }
+            int getMultiplierCount() const override
+            {
+                return first->getMultiplierCount() + second->getMultiplierCount();
+            }
+            bool supportsFormat(PixelFormat format) const override
+            {
+                return first->supportsFormat(format) && second->supportsFormat(format);
+            }
+
+            BaseFilter *getFirst() const { return first; }
+            BaseFilter *getSecond() const { return second; }
+        };
+    }
+}
+
+#endif
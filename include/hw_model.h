@@ -0,0 +1,69 @@
+#ifndef HW_MODEL_H
+#define HW_MODEL_H
+
+#include "config.h"
+#include <vector>
+
+#ifdef HW_SIMULATION
+
+namespace hardware {
+    namespace simulation {
+
+        // Clock, memory and datapath parameters of the modelled device
+        struct HardwareParams {
+            int cyclesPerPixel = CLOCK_CYCLES_PER_PIXEL;  // Initiation interval of every stage
+            int pipelineDepth = PIPELINE_DEPTH;           // Arithmetic register stages per filter
+            double clockMHz = CLOCK_FREQUENCY;
+            double memoryMBps = MEMORY_BANDWIDTH;         // Shared by frame reads and writes
+            int busBits = BUS_WIDTH;
+        };
+
+        // One streaming stage as the model sees it
+        struct StageDescription {
+            const char* name;
+            int radius;             // Window rows/columns on each side
+            int multipliers;        // Multiplies per output sample
+            int bytesPerPixel;      // Samples per pixel in the stage's line buffer
+        };
+
+        struct StageEstimate {
+            const char* name;
+            long long busyCycles;   // Cycles spent computing one frame
+            long long fillCycles;   // From its first input pixel to its first output pixel
+            int lineBufferRows;     // Rows kept for the window (2 * radius)
+            int fifoRows;           // Extra input rows needed so the producer never stalls
+            int bram18;             // 18 Kbit blocks for line buffer + FIFO
+            int dsp;                // Multipliers after time-multiplexing over cyclesPerPixel
+        };
+
+        struct FrameEstimate {
+            int width;
+            int height;
+            std::vector<StageEstimate> stages;
+            long long readCycles;       // Source frame transfer
+            long long writeCycles;      // Result frame transfer
+            long long frameCycles;      // Sustained interval between frames
+            long long fillCycles;       // First input pixel to first output pixel
+            long long latencyCycles;    // First input pixel to last output pixel written
+            double framesPerSecond;
+            const char* bottleneck;     // "datapath" or "memory", whichever sets frameCycles
+            int bram18;
+            int dsp;
+
+            double cyclesToMs(long long cycles, const HardwareParams& params) const {
+                return cycles / (params.clockMHz * 1e3);
+            }
+        };
+
+        // Analytic/event model of the stages as a streaming datapath. Rows
+        // are the unit of simulation, so the cost is O(stages x rows) and
+        // independent of the frame width.
+        FrameEstimate estimateFrame(const std::vector<StageDescription>& stages, int width, int height,
+                                    int sourceBytesPerPixel, const HardwareParams& params = HardwareParams());
+
+    }
+}
+
+#endif // HW_SIMULATION
+
+#endif // HW_MODEL_H
@@ -0,0 +1,60 @@
+#ifndef IMAGE_VIEW_H
+#define IMAGE_VIEW_H
+
+#include "pixel.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace hardware {
+    namespace filters {
+
+        // Frame layouts a filter can consume and produce
+        enum class PixelFormat {
+            RGB24,  // Interleaved pixel structs
+            GRAY8   // One intensity byte per pixel
+        };
+
+        template <typename T>
+        struct PixelFormatOf;
+        template <>
+        struct PixelFormatOf<pixel> { static constexpr PixelFormat value = PixelFormat::RGB24; };
+        template <>
+        struct PixelFormatOf<uint8_t> { static constexpr PixelFormat value = PixelFormat::GRAY8; };
+        template <typename T>
+        struct PixelFormatOf<const T> : PixelFormatOf<T> {};
+
+        // Non-owning window onto pixels someone else holds: a whole packed
+        // frame, a padded buffer or a rectangle inside either. Rows are
+        // `stride` elements apart and need not be contiguous, so a region of
+        // interest is a view of its frame rather than a copy.
+        template <typename T>
+        struct BasicImageView {
+            T* data;        // Pixel (0, 0)
+            int width;
+            int height;
+            int stride;     // Elements between consecutive rows
+
+            static constexpr PixelFormat format = PixelFormatOf<T>::value;
+
+            T* row(int y) const { return data + static_cast<long>(y) * stride; }
+            bool packed() const { return stride == width; }
+
+            // The w x h rectangle at (x, y), sharing this view's rows
+            BasicImageView region(int x, int y, int w, int h) const {
+                return {row(y) + x, w, h, stride};
+            }
+        };
+
+        using ImageView = BasicImageView<pixel>;
+        using GrayImageView = BasicImageView<uint8_t>;
+
+        // A packed width x height frame as a view
+        template <typename T>
+        BasicImageView<T> packedView(T* data, int width, int height) {
+            return {data, width, height, width};
+        }
+
+    } // namespace filters
+} // namespace hardware
+
+#endif // IMAGE_VIEW_H
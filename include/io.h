@@ -1,23 +1,149 @@
 #ifndef IO_H
 #define IO_H
 #include "pixel.h"
+#include "buffer.h"
+#include "qoi.h"
+#include "tiled_image.h"
 #include <string> // Add this
+#include <cstdint>
+#include <vector>
 
 namespace hardware
 {
     namespace pipeline
     {
+        // Supported Netpbm variants
+        enum class ImageFormat
+        {
+            P3, // ASCII RGB
+            P5, // Binary grayscale
+            P6, // Binary RGB
+            QOI, // Lossless compressed RGB (.qoi)
+            QOI_GRAY, // Lossless compressed gray (.qoi, one channel)
+            TILED, // Memory-mapped RGB tiles (.tiles, see TiledImage)
+            TILED_GRAY // Memory-mapped gray tiles (.tiles, one channel)
+        };
+
+        // Format to write `filename` in. A .qoi or .tiles extension selects
+        // QOI or TILED, in the gray variant when the input (P5, QOI_GRAY,
+        // TILED_GRAY) or the result (`grayResult`) is gray. For other input
+        // .ppm selects P6, .pgm P5 and .pnm either by the input's channels;
+        // Netpbm input keeps its encoding, as does any input under any
+        // other extension.
+        ImageFormat formatForPath(const char *filename, ImageFormat input, bool grayResult = false);
+
         struct FrameReader
         {
             pixel *loadImage(const char *filename, int &width, int &height);
+
+            // Maps the file into memory. Binary P6 payloads are used in place
+            // (zero-copy); P3, P5, QOI and tiled images are decoded into a frame leased from `pool`
+            // (or freshly allocated when no pool is given). Large P3 payloads
+            // are decoded in parallel chunks; '#' comments may appear anywhere.
+            hardware::memory::FrameBuffer *mapImage(const char *filename, ImageFormat &format,
+                                                    hardware::memory::BufferPool *pool = nullptr);
+
+            // Same, loading into an existing (reusable) FrameBuffer object
+            bool mapImage(const char *filename, ImageFormat &format, hardware::memory::FrameBuffer &frame,
+                          hardware::memory::BufferPool *pool = nullptr);
+        };
+
+        // Sequential decoding of a Netpbm or QOI file one row at a time
+        // through a fixed read buffer, so memory use does not depend on the
+        // image height; tiled images are read from their mapping, dropping
+        // each row of tiles once passed. Every format comes out as RGB rows
+        // (gray replicated).
+        class RowReader
+        {
+        private:
+            int fd;
+            ImageFormat format;
+            int width;
+            int height;
+            int maxVal;
+            int rowsRead;
+            std::string path;
+            std::vector<char> buffer;
+            size_t begin;           // Unread bytes are buffer[begin, end)
+            size_t end;
+            bool eof;
+            qoi::Decoder decoder;
+            TiledImage tiled;
+
+            bool fill();            // Keep the unread bytes, read more after them
+            bool readSample(int &value);
+
+        public:
+            RowReader();
+            ~RowReader();
+
+            RowReader(const RowReader &) = delete;
+            RowReader &operator=(const RowReader &) = delete;
+
+            // Open the file and parse its header
+            bool open(const char *filename);
+            void close();
+
+            // The next row (width pixels); false at the end or on bad data
+            bool readRow(pixel *row);
+
+            int getWidth() const { return width; }
+            int getHeight() const { return height; }
+            ImageFormat getFormat() const { return format; }
+        };
+
+        // Row-at-a-time counterpart of FrameWriter: the header goes out on
+        // open(), rows are formatted into a buffer flushed in large writes.
+        // Tiled images are created whole and written through their mapping.
+        class RowWriter
+        {
+        private:
+            int fd;
+            ImageFormat format;
+            int width;
+            std::string path;
+            std::vector<char> buffer;
+            size_t used;
+            bool failed;
+            qoi::Encoder encoder;
+            TiledImage tiled;
+            int rowsWritten;
+            std::vector<uint8_t> line;  // QOI/tiled rows whose channel count differs from the file's
+
+            bool flush();
+            char *reserve(size_t bytes);    // Room for bytes more, flushing first if needed
+            bool writeTiledRow(const uint8_t *samples);    // Samples in the file's channels
+
+        public:
+            RowWriter();
+            ~RowWriter();
+
+            RowWriter(const RowWriter &) = delete;
+            RowWriter &operator=(const RowWriter &) = delete;
+
+            bool open(const char *filename, ImageFormat format, int width, int height);
+            bool writeRow(const pixel *row);
+            bool writeRow(const uint8_t *row);     // Gray row (P3/P6/QOI replicate it)
+            bool close();                           // Flush (and end a QOI stream); false if any write failed
         };
 
         struct FrameWriter
         {
+            // P3 text is formatted from a table of decimal strings into a
+            // buffer written out a megabyte at a time
             bool saveImage(const char *filename, pixel *buffer, int width, int height);        // Changed to bool
             bool saveImage(const std::string &filename, pixel *buffer, int width, int height); // Optional overload
+
+            // Binary Netpbm is emitted with a single gathered write per frame,
+            // QOI and tiled images row by row through a RowWriter
+            bool saveImage(const char *filename, const pixel *buffer, int width, int height, ImageFormat format);
+
+            // Single-channel planes: P5, QOI_GRAY and TILED_GRAY are written
+            // straight from the plane, P3/P6/QOI/TILED replicate each
+            // intensity into three channels on the way out
+            bool saveImage(const char *filename, const uint8_t *plane, int width, int height, ImageFormat format);
         };
     }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,124 @@
+#ifndef LAZY_EVALUATOR_H
+#define LAZY_EVALUATOR_H
+
+#include "pipeline.h"
+#include "tiled_image.h"
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace hardware {
+    namespace pipeline {
+
+        // Demand-driven evaluation of a pipeline over one image. The
+        // grayscale-converted input (level 0) and every stage's output
+        // (level k) are split into square tiles that are computed only when
+        // a request needs them and kept in one LRU cache, so overlapping
+        // requests reuse each other's work and latency follows the size of
+        // the request rather than of the image.
+        //
+        // A level-k tile needs level k-1 over the tile grown by stage k's
+        // footprint; those tiles are pulled in turn, down to the source,
+        // which is only read where needed (tiled images tile by tile). Each
+        // stage runs on that window as on a frame with the pipeline's border
+        // mode, so results match a whole-frame run. Block filters compute
+        // whole blocks on the frame's block grid and cache every tile those
+        // cover; their results match to within rounding. Stages run unfused
+        // on the calling thread; an evaluator is not thread-safe.
+        //
+        // open() reads the pipeline's stages and border mode; reopen after
+        // changing them.
+        class LazyEvaluator {
+        private:
+            struct Tile {
+                uint64_t key;
+                std::vector<uint8_t> samples;   // Packed rows of the tile's width
+            };
+
+            Pipeline& pipeline;
+            int tileSize;
+            size_t cacheBytes;
+
+            // Source: a decoded (or mapped) frame, or a tiled image
+            hardware::memory::FrameBuffer frame;
+            TiledImage tiled;
+            ImageFormat format;
+            int width;
+            int height;
+            bool gray;                          // Tiles hold uint8_t, else pixel
+
+            std::vector<filters::BaseFilter*> stages;
+            filters::BorderMode border;
+            uint8_t borderConstant;
+
+            // Most recently used tile first
+            std::list<Tile> tiles;
+            std::unordered_map<uint64_t, std::list<Tile>::iterator> index;
+            size_t cachedBytes;
+            std::vector<size_t> computed;       // Tiles computed per level
+            size_t hits;
+
+            // Stage k gathers its window into windows[k]; gathering level k
+            // only recurses into lower levels, so the buffers never clash
+            std::vector<std::vector<uint8_t>> windows;
+            std::vector<uint8_t> results;
+            std::vector<pixel> sourceRows;
+
+            Region tileRect(int tx, int ty) const;
+
+            // The tile's samples, valid until the next fetch()
+            template<typename T>
+            const T* fetch(int level, int tx, int ty);
+            template<typename T>
+            void computeSource(const Region& rect, T* out);
+            // Run stage `level` over the blocks tile (tx, ty) lies in,
+            // caching every tile they cover; returns (tx, ty)
+            template<typename T>
+            const T* computeStage(int level, int tx, int ty);
+            const uint8_t* insert(int level, int tx, int ty, std::vector<uint8_t>&& samples);
+            template<typename T>
+            bool copyRegion(const Region& area, T* out, int stride);
+
+            void evict();
+
+        public:
+            explicit LazyEvaluator(Pipeline& target, int tile = LAZY_TILE_SIZE, size_t budget = LAZY_CACHE_BYTES);
+
+            LazyEvaluator(const LazyEvaluator&) = delete;
+            LazyEvaluator& operator=(const LazyEvaluator&) = delete;
+
+            // Read the pipeline's stages and open the input: tiled images
+            // are mapped, other formats mapped or decoded. Drops the cache.
+            bool open(const char* inputPath);
+
+            int getWidth() const { return width; }
+            int getHeight() const { return height; }
+            int getTileSize() const { return tileSize; }
+            ImageFormat getFormat() const { return format; }
+            // Results are gray planes when every stage accepts them
+            bool isGray() const { return gray; }
+
+            // What each level must supply for `area` of the result: [k] is
+            // level k, the last entry `area` itself
+            std::vector<Region> footprint(const Region& area) const;
+
+            // Copy `area` (inside the frame) of the last stage's output to
+            // `out`, rows `stride` elements apart, computing the tiles it
+            // needs that are not cached. Use the overload isGray() selects.
+            bool request(const Region& area, uint8_t* out, int stride);
+            bool request(const Region& area, pixel* out, int stride);
+
+            // Tiles computed at `level` since open(), and fetches the cache served
+            size_t getTilesComputed(int level) const;
+            size_t getCacheHits() const { return hits; }
+            size_t getCachedBytes() const { return cachedBytes; }
+
+            // Drop every cached tile
+            void clear();
+        };
+
+    } // namespace pipeline
+} // namespace hardware
+
+#endif // LAZY_EVALUATOR_H
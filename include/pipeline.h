@@ -4,6 +4,11 @@
 #include "config.h"
 #include "base_filter.h"
 #include "buffer.h"
+#include "thread_pool.h"
+#include "io.h"
+#include "fused_filter.h"
+#include "hw_model.h"
+#include <memory>
 #include <string>
 #include <vector>
 #include <functional>
@@ -12,11 +17,77 @@
 namespace hardware {
     namespace pipeline {
         
+        // Measurements for one stage of one frame. Stages are numbered in
+        // frame order: decode (0), grayscale (1), the filter passes (fused
+        // groups count once in frame mode), then encode.
+        struct StageStats {
+            const char* name;
+            int index;
+            double wallSeconds;
+            double cpuSeconds;      // Process CPU time, so worker threads are included
+            size_t inputBytes;
+            size_t outputBytes;
+            int width;
+            int height;
+            
+            double megapixelsPerSecond() const {
+                return wallSeconds > 0.0 ? static_cast<double>(width) * height / wallSeconds / 1e6 : 0.0;
+            }
+        };
+        
+        // A rectangle of a frame in pixels; an empty one means the whole frame
+        struct Region {
+            int x = 0;
+            int y = 0;
+            int width = 0;
+            int height = 0;
+            
+            bool empty() const { return width <= 0 || height <= 0; }
+        };
+        
+        // One frame's buffers on its way through decode -> process -> encode.
+        // Jobs are independent, so phases of different frames may run on
+        // different threads (see BatchRunner). Storage comes from the
+        // pipeline's buffer pool and returns to it when the job is released.
+        struct FrameJob {
+            const char* inputPath;
+            const char* outputPath;
+            ImageFormat format;
+            hardware::memory::FrameBuffer source;   // Decoded or mapped input
+            hardware::memory::FrameBuffer output;   // RGB stage scratch (RGB chains)
+            hardware::memory::GrayPlane plane;      // Gray planes (gray chains)
+            hardware::memory::GrayPlane scratch;
+            hardware::memory::FrameBuffer paddedFrames[2];  // Apron-padded stage inputs
+            hardware::memory::GrayPlane paddedPlanes[2];    // (frame mode, border != COPY)
+            hardware::memory::FrameBuffer window;   // Converted region window (RGB chains, COPY border)
+            pixel* rgbResult;                       // Set by process(), one of the two
+            uint8_t* grayResult;
+            int resultWidth;                        // The frame, or the region of interest
+            int resultHeight;
+            int stagesRun;                          // Filter passes process() ran (stats indices)
+            
+            FrameJob(const char* input = nullptr, const char* outputFile = nullptr)
+                : inputPath(input), outputPath(outputFile), format(ImageFormat::P3),
+                  rgbResult(nullptr), grayResult(nullptr), resultWidth(0), resultHeight(0), stagesRun(0) {}
+            
+            void release() {
+                source.reset();
+                output.reset();
+                plane.reset();
+                scratch.reset();
+                for (int i = 0; i < 2; i++) {
+                    paddedFrames[i].reset();
+                    paddedPlanes[i].reset();
+                }
+                window.reset();
+                rgbResult = nullptr;
+                grayResult = nullptr;
+            }
+        };
+        
         class Pipeline {
         private:
             std::vector<filters::BaseFilter*> stages;
-            hardware::memory::FrameBuffer* inputBuffer;
-            hardware::memory::FrameBuffer* outputBuffer;
             
             // Function pointer registry for dynamic filter creation
             std::unordered_map<std::string, FilterCreator> filterRegistry;
@@ -26,6 +97,40 @@ namespace hardware {
             StageCallback stageCallback;
             void* callbackUserData;
             
+            // Per-stage measurements; no clock is read while this is unset
+            typedef void (*StatsCallback)(const StageStats& stats, void* userData);
+            StatsCallback statsCallback;
+            void* statsUserData;
+            
+            ExecutionMode executionMode;
+            
+            // What stages read past the frame edge
+            filters::BorderMode borderMode;
+            uint8_t borderConstant;
+            
+            // Rectangle of every frame that is filtered and written (empty = all)
+            Region region;
+            
+            // Persistent workers for row-band parallel execution (null = serial)
+            std::unique_ptr<ThreadPool> threadPool;
+            
+            // Frame and plane storage recycled across runs
+            std::shared_ptr<hardware::memory::BufferPool> bufferPool;
+            
+            // Frame-mode stage plan with adjacent stages fused into single
+            // sweeps; rebuilt when the stage list or a stage radius changes
+            bool fusionEnabled;
+            std::vector<std::unique_ptr<filters::FusedFilter>> fusedStages;
+            std::vector<filters::BaseFilter*> framePlan;
+            std::vector<filters::BaseFilter*> planStages;
+            std::vector<int> planRadii;
+            
+            #ifdef HW_SIMULATION
+                long long simulatedCycles;  // Model clock, advanced by simulateClockCycles()
+                int modelWidth;             // Frame size the model describes (last frame processed)
+                int modelHeight;
+            #endif
+            
         public:
             Pipeline();
             ~Pipeline();
@@ -50,19 +155,85 @@ namespace hardware {
                 callbackUserData = userData;
             }
             
-            // Pipeline execution
+            // Receive a StageStats record for every stage of every frame.
+            // decode() and encode() may report from batch I/O threads.
+            void setStatsCallback(StatsCallback callback, void* userData = nullptr) {
+                statsCallback = callback;
+                statsUserData = userData;
+            }
+            bool isProfiling() const { return statsCallback != nullptr; }
+            
+            // Pipeline execution: decode, process and encode one frame. In
+            // STREAMING mode rows are decoded, filtered and written one at a
+            // time, so memory is a few rows per stage whatever the height.
+            // Tiled inputs run tile by tile in FRAME mode (see runTiled).
+            // LAZY mode pulls the region (or frame) through a LazyEvaluator.
             bool run(const char* inputPath, const char* outputPath);
             
-            // Hardware simulation methods
+            // The phases of run(), for callers that overlap frames. decode()
+            // and encode() only touch the job and the (thread-safe) buffer
+            // pool, so they may run concurrently with each other and with
+            // process(); process() calls must not overlap. process() runs
+            // LAZY pipelines over whole frames, as FRAME.
+            bool decode(FrameJob& job);
+            bool process(FrameJob& job);
+            bool encode(FrameJob& job);    // Releases the job's buffers
+            
+            void setExecutionMode(ExecutionMode mode) { executionMode = mode; }
+            ExecutionMode getExecutionMode() const { return executionMode; }
+            
+            // Border handling for every stage. COPY passes the pixels within
+            // each stage's radius of the edge through unfiltered; the other
+            // modes filter the whole frame against an apron filled once per
+            // stage (constant = apron intensity for CONSTANT).
+            void setBorder(filters::BorderMode mode, uint8_t constant = 0) {
+                borderMode = mode;
+                borderConstant = constant;
+            }
+            filters::BorderMode getBorder() const { return borderMode; }
+            uint8_t getBorderConstant() const { return borderConstant; }
+            
+            // Filter and write only this rectangle of each frame. Stages
+            // read it, plus a halo of their summed radii, straight from the
+            // decoded frame: from the block filters' grid (see runTiled), and
+            // across whole rows if a stage needs them (recursive filters).
+            // The output image is the rectangle, equal to the same rectangle
+            // of a whole-frame run (LAZY runs match as LazyEvaluator's do).
+            // Parts outside the frame are clipped off. Tiled inputs need LAZY
+            // mode for a region.
+            void setRegion(const Region& area) { region = area; }
+            const Region& getRegion() const { return region; }
+            
+            // Fuse adjacent frame-mode stages (output is identical either way)
+            void setFusion(bool enabled) { fusionEnabled = enabled; }
+            bool getFusion() const { return fusionEnabled; }
+            
+            // Number of threads used to process each stage in row bands
+            void setThreadCount(int count);
+            int getThreadCount() const { return threadPool ? threadPool->getThreadCount() : 1; }
+            
+            // Share one buffer pool between pipelines (each pipeline starts with its own)
+            void setBufferPool(std::shared_ptr<hardware::memory::BufferPool> pool);
+            hardware::memory::BufferPool& getBufferPool() const { return *bufferPool; }
+            
+            // Hardware simulation: the stages modelled as a streaming datapath
+            // (see hw_model.h) for the last frame size processed
             #ifdef HW_SIMULATION
+                // Advance the model clock and report the frames and rows the
+                // datapath would have completed by then
                 void simulateClockCycles(int cycles);
+                // Status registers of the modelled pipeline
                 void dumpPipelineRegisters() const;
+                // Print per-stage line buffer, FIFO and DSP estimates; returns BRAM18 blocks
                 int estimateResourceUsage() const;
+                
+                simulation::FrameEstimate estimateHardware() const;
             #endif
             
             // Utility methods
             void listRegisteredFilters() const;
             int getStageCount() const { return stages.size(); }
+            filters::BaseFilter* getStage(int index) const { return stages[index]; }
             void clearStages();
             
         private:
@@ -72,8 +243,72 @@ namespace hardware {
                 }
             }
             
-            bool allocateBuffers(int width, int height);
-            void releaseBuffers();
+            void reportStage(const StageStats& stats) const {
+                if (statsCallback) {
+                    statsCallback(stats, statsUserData);
+                }
+            }
+            
+            // True when every stage accepts single-channel planes
+            bool grayChain() const;
+            
+            // Stages as run in frame mode (fused groups when fusion is on)
+            const std::vector<filters::BaseFilter*>& frameStages();
+            
+            // Stage chain execution strategies over RGB frames (T = pixel) or
+            // gray planes (T = uint8_t); each returns the packed buffer
+            // holding the source view's filtered pixels. runFrame converts
+            // source into frame (which may alias a packed source).
+            template<typename T>
+            T* runFrame(const filters::ImageView& source, T* frame, T* scratch);
+            template<typename T>
+            T* runStreaming(const filters::ImageView& source, T* output);
+            // The streaming engine: RGB rows from source(y) (null = no row)
+            // through every stage's line buffer; sink.row(y) is where the
+            // last stage writes row y and sink.done(y) takes it. False if a
+            // row could not be read or taken.
+            template<typename T, typename Source, typename Sink>
+            bool streamRows(int width, int height, const Source& source, const Sink& sink);
+            // STREAMING run(): RowReader -> stages -> RowWriter
+            bool streamFile(const char* inputPath, const char* outputPath);
+            // FRAME run() of a tiled image: each tile is processed as a frame
+            // of the tile plus a halo of the stages' summed radii gathered
+            // from its neighbours, and its centre is kept. Windows start on
+            // the block filters' grid, so blocks match a whole-frame run's,
+            // but rows still start at the window edge: a recursive filter's
+            // decayed transient, or an FFT tile's float round-off, can move
+            // a sample by one level. Rows of tiles go to a RowWriter in
+            // order, so memory is one row of tiles plus the windows whatever
+            // the image size.
+            bool runTiled(const char* inputPath, const char* outputPath);
+            // LAZY run(): the region is requested from a LazyEvaluator a
+            // strip of tiles at a time and written by a RowWriter
+            bool runLazy(const char* inputPath, const char* outputPath);
+            // Frame mode with a border mode: source is converted into padded[0]
+            // and stages ping-pong between the padded buffers, refilling the
+            // apron before each one; the last stage writes the packed result
+            template<typename T, typename Buffer>
+            T* runFramePadded(const filters::ImageView& source, Buffer (&padded)[2], T* result);
+            
+            // Split [0, height) into bands and run body(y0, y1) on the thread
+            // pool; inner band edges are multiples of `granularity`
+            template<typename Body>
+            void forEachBand(int height, const Body& body, int granularity = 1);
+            
+            // The region clipped to a width x height frame (`area`) and grown
+            // by the stages' summed radii (`window`, what they must read);
+            // the whole frame for both without a region. False if the
+            // region misses the frame.
+            bool regionWindow(int width, int height, Region& area, Region& window) const;
+            
+            // Lease the job's stage buffers for `input` (gray planes or RGB
+            // scratch, plus padded inputs when a border mode is set) from the pool
+            bool allocateBuffers(FrameJob& job, bool gray, const filters::ImageView& input);
+            
+            #ifdef HW_SIMULATION
+                // Modelled hardware timing next to the measured software time
+                void reportHardwareModel(double softwareSeconds) const;
+            #endif
         };
         
     }
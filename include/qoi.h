@@ -0,0 +1,92 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include "pixel.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        namespace qoi
+        {
+            // "Quite OK Image" lossless coding: every pixel becomes a run of
+            // the previous one, a slot of a 64-entry table of recently seen
+            // pixels, a small difference from the previous pixel, or the
+            // pixel itself. One pass each way, no entropy coder.
+            //
+            // Three-channel files follow the QOI specification (RGB, alpha
+            // 255). Gray files (channels byte 1) are this project's variant:
+            //   00iiiiii  table slot
+            //   01aaabbb  two samples, each -4..3 from the one before
+            //   10dddddd  difference from the previous sample, -32..31
+            //   11rrrrrr  run of 1..62
+            //   0xfe v    sample
+            constexpr size_t HEADER_BYTES = 14;    // "qoif", width, height (big-endian), channels, colorspace
+            constexpr size_t END_BYTES = 8;        // Seven zero bytes and a one
+            constexpr int MAX_RUN = 62;
+
+            // Upper bound on the coded size of `count` pixels
+            inline size_t maxCodedBytes(size_t count, int channels) { return count * (channels + 1); }
+
+            bool isQoi(const uint8_t *data, size_t size);
+
+            // False unless the header is complete, 3 or 4 channels (alpha is
+            // dropped on decoding) or 1, and the size fits 2^24 x 2^24
+            bool parseHeader(const uint8_t *data, size_t size, int &width, int &height, int &channels);
+            uint8_t *writeHeader(uint8_t *out, int width, int height, int channels);
+
+            // Codes pixels in raster order; a run may continue across calls
+            class Encoder
+            {
+            private:
+                int channels;       // 3 (RGB samples) or 1 (gray)
+                int run;
+                uint32_t previous;  // RGBA, r in the low byte
+                uint32_t table[64];
+
+                uint8_t *encodeRgb(const uint8_t *samples, int count, uint8_t *out);
+                uint8_t *encodeGray(const uint8_t *samples, int count, uint8_t *out);
+
+            public:
+                explicit Encoder(int channels = 3);
+
+                void reset(int channels);
+
+                // `count` pixels of `channels` samples each; writes at most
+                // maxCodedBytes(count, channels) bytes and returns the end
+                uint8_t *encode(const uint8_t *samples, int count, uint8_t *out);
+
+                // The pending run and the end marker
+                uint8_t *finish(uint8_t *out);
+            };
+
+            // Decodes into RGB pixels (gray replicated); a run may continue
+            // across calls
+            class Decoder
+            {
+            private:
+                int channels;
+                int run;
+                bool pending;       // Second sample of a gray pair still owed
+                uint32_t previous;
+                uint32_t table[64];
+
+                const uint8_t *decodeRgb(const uint8_t *p, const uint8_t *end, pixel *out, int count);
+                const uint8_t *decodeGray(const uint8_t *p, const uint8_t *end, pixel *out, int count);
+
+            public:
+                explicit Decoder(int channels = 3);
+
+                void reset(int channels);
+
+                // `count` pixels from [p, end); the position after them, or
+                // nullptr when the data ends first
+                const uint8_t *decode(const uint8_t *p, const uint8_t *end, pixel *out, int count);
+            };
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef RECURSIVE_GAUSSIAN_H
+#define RECURSIVE_GAUSSIAN_H
+
+#include "block_filter.h"
+#include <cstdint>
+
+namespace hardware
+{
+    namespace filters
+    {
+        // Gaussian blur by the third-order recursive filter of Young and
+        // van Vliet: a causal and an anti-causal pass along every row and
+        // every column, four multiplies per pass and sample whatever sigma
+        // is. A dense kernel needs about 6*sigma taps per direction instead.
+        //
+        // Rows are filtered whole. Columns are filtered per block of rows
+        // (see BlockFilter), each run from `warmup` rows above to `warmup`
+        // rows below the block so the start-up transient has decayed
+        // (below 2^-10) before it reaches an output row.
+        //
+        // Every output sample is filtered: under BorderMode::COPY the
+        // frame's edge pixels are repeated (like REPLICATE) rather than
+        // passed through, since the support is far wider than an edge
+        // strip. Under USE_FIXED_POINT the recursion runs on Q15.16
+        // samples with Q7.24 coefficients whose sum is exactly one.
+        class RecursiveGaussianFilter : public BlockFilter
+        {
+        private:
+            float sigma;
+            int warmup;         // Samples run before the first and after the last one kept
+#ifdef USE_FIXED_POINT
+            int32_t gain;       // Q7.24
+            int32_t feedback[3];
+#else
+            float gain;
+            float feedback[3];
+#endif
+
+            template <typename T>
+            void filterRows(const BasicRowBand<T> &band, int first, int last, T *out);
+
+        protected:
+            void filterBlock(const RowBand &band, int first, int last, pixel *out) override;
+            void filterBlock(const GrayRowBand &band, int first, int last, uint8_t *out) override;
+
+        public:
+            explicit RecursiveGaussianFilter(float s);
+
+            void apply(pixel *input, pixel *output, int width, int height) override;
+            const char *getName() const override { return "recursive gaussian"; }
+            int getRadius() const override { return blockRows - 1 + warmup; }
+            int getFootprint() const override { return warmup; }
+            bool needsWholeRows() const override { return true; }
+            int getMultiplierCount() const override { return 16; }  // 4 taps x 2 passes x 2 directions
+            bool supportsFormat(PixelFormat) const override { return true; }
+
+            float getSigma() const { return sigma; }
+        };
+
+        // Gaussian blur stage for any sigma: the separable convolution
+        // (size 2*ceil(3*sigma)+1) up to RECURSIVE_GAUSSIAN_MIN_SIGMA, the
+        // recursive filter above it, where its constant cost wins
+        BaseFilter *createGaussianBlur(float sigma);
+    }
+}
+
+#endif
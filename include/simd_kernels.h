@@ -0,0 +1,63 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include "fixed_point.h"
+#include <cstdint>
+
+namespace hardware {
+    namespace filters {
+        namespace simd {
+
+            // Instruction set levels, in increasing order of preference
+            enum class IsaLevel {
+                SCALAR,
+                SSE41,
+                AVX2
+            };
+
+            // Line primitives operate on interleaved samples: neighbouring
+            // pixels are `step` samples apart (3 for RGB), so every sample lane
+            // is filtered independently and no channel shuffling is needed.
+            // Each primitive computes samples j in [begin, end).
+            //
+            // Float builds accumulate in float and truncate at the output.
+            // Fixed-point builds multiply 8-bit samples by Q7.8 taps into
+            // 32-bit sums (line holds Q.8 values, so a horizontal pass sums
+            // Q.16) and round and saturate only when the sample is stored.
+
+            // dst[j] = sum over (ky, kx) of rows[ky][j + (kx - radius) * step] * taps[ky * size + kx]
+            typedef void (*DenseRowFunc)(const uint8_t* const* rows, const KernelTap* taps, int size,
+                                         int step, uint8_t* dst, int begin, int end);
+
+            // line[j] = sum over k of rows[k][j] * taps[k]
+            typedef void (*VerticalPassFunc)(const uint8_t* const* rows, const KernelTap* taps, int size,
+                                             Fixed* line, int begin, int end);
+
+            // dst[j] = sum over k of line[j + (k - radius) * step] * taps[k]
+            typedef void (*HorizontalPassFunc)(const Fixed* line, const KernelTap* taps, int size,
+                                               int step, uint8_t* dst, int begin, int end);
+
+            struct KernelTable {
+                IsaLevel level;
+                const char* name;
+                DenseRowFunc denseRow;
+                VerticalPassFunc verticalPass;
+                HorizontalPassFunc horizontalPass;
+            };
+
+            // Best level supported by the running CPU
+            IsaLevel detectIsa();
+
+            // Active kernel table; picked from detectIsa() on first use.
+            // Every variant produces bit-identical results.
+            const KernelTable& kernels();
+
+            // Force a level (e.g. for testing); fails if the CPU lacks it.
+            // Call before any processing starts.
+            bool selectIsa(IsaLevel level);
+
+        } // namespace simd
+    } // namespace filters
+} // namespace hardware
+
+#endif // SIMD_KERNELS_H
@@ -11,6 +11,12 @@ namespace hardware
 		{
 		public:
 			void apply(pixel *input, pixel *output, int width, int height) override;
+			void processRows(const RowBand &band) override;
+			void processRows(const GrayRowBand &band) override;
+			const char *getName() const override { return "smoothing"; }
+			int getRadius() const override { return 1; }
+			int getMultiplierCount() const override { return 1; }	// Sum of nine, times 1/9
+			bool supportsFormat(PixelFormat) const override { return true; }
 		};
 	}
 }
@@ -0,0 +1,302 @@
+#ifndef STATIC_KERNEL_H
+#define STATIC_KERNEL_H
+
+#include "base_filter.h"
+#include "fixed_point.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        constexpr bool isPowerOfTwo(int v) { return v > 0 && (v & (v - 1)) == 0; }
+        constexpr int exactLog2(int v) { return v <= 1 ? 0 : 1 + exactLog2(v / 2); }
+
+        // sample * W with the multiply resolved at compile time: zero taps
+        // vanish, +-1 become add/subtract and +-2^k become shifts
+        template <int W>
+        inline int weighTap(int sample)
+        {
+            if constexpr (W == 0)
+                return 0;
+            else if constexpr (isPowerOfTwo(W))
+                return static_cast<int>(static_cast<unsigned>(sample) << exactLog2(W));
+            else if constexpr (isPowerOfTwo(-W))
+                return -static_cast<int>(static_cast<unsigned>(sample) << exactLog2(-W));
+            else
+                return sample * W;
+        }
+
+        // Integer sum back to a sample, as ConvolutionFilter converts the same
+        // kernel: the fixed-point build rounds half up, the float build
+        // truncates; both saturate
+        template <int SHIFT>
+        inline uint8_t descaleSample(int sum)
+        {
+            static_assert(SHIFT >= 0 && SHIFT <= 8, "Divisor must fit the 8-bit fixed-point fraction");
+#ifdef USE_FIXED_POINT
+            return hardware::fixed::roundToPixel<SHIFT>(sum);
+#else
+            return static_cast<uint8_t>(std::min(std::max(sum >> SHIFT, 0), 255));
+#endif
+        }
+
+        // Convolution kernel whose integer weights are compile-time constants
+        // (row-major, SIZE x SIZE), fully unrolled with zero taps dropped
+        template <int SIZE, int... W>
+        struct StaticKernel
+        {
+            static_assert(SIZE % 2 == 1, "Kernel size must be odd");
+            static_assert(sizeof...(W) == SIZE * SIZE, "Kernel needs SIZE*SIZE weights");
+
+            static constexpr int RADIUS = SIZE / 2;
+            static constexpr int weights[SIZE * SIZE] = {W...};
+
+            // Taps left after zero elimination
+            static constexpr int TAPS = ((W != 0) + ... + 0);
+            // Taps that still need a multiplier (not 0 or +-2^k)
+            static constexpr int MULTIPLIES = ((W != 0 && !isPowerOfTwo(W) && !isPowerOfTwo(-W)) + ... + 0);
+
+            // sum over (ky, kx) of rows[ky][j + (kx - RADIUS) * step] * weight(ky, kx)
+            static inline int apply(const uint8_t *const *rows, int j, int step)
+            {
+                return accumulate(rows, j, step, std::make_integer_sequence<int, SIZE * SIZE>());
+            }
+
+        private:
+            template <int I>
+            static inline int tap(const uint8_t *const *rows, int j, int step)
+            {
+                if constexpr (weights[I] == 0)
+                    return 0;
+                else
+                    return weighTap<weights[I]>(rows[I / SIZE][j + (I % SIZE - RADIUS) * step]);
+            }
+
+            template <int... I>
+            static inline int accumulate(const uint8_t *const *rows, int j, int step,
+                                         std::integer_sequence<int, I...>)
+            {
+                return (tap<I>(rows, j, step) + ... + 0);
+            }
+        };
+
+        // One-dimensional compile-time taps for kernels that factor into a
+        // column pass and a row pass (2*SIZE taps per sample instead of SIZE^2)
+        template <int... W>
+        struct StaticTaps
+        {
+            static constexpr int SIZE = sizeof...(W);
+            static_assert(SIZE % 2 == 1, "Tap count must be odd");
+
+            static constexpr int RADIUS = SIZE / 2;
+            static constexpr int weights[SIZE] = {W...};
+
+            static constexpr int MULTIPLIES = ((W != 0 && !isPowerOfTwo(W) && !isPowerOfTwo(-W)) + ... + 0);
+
+            // Largest magnitude a pass over 8-bit samples can reach
+            static constexpr int BOUND = ((W < 0 ? -W : W) + ... + 0) * 255;
+
+            // sum over k of rows[k][j] * weight(k)
+            static inline int column(const uint8_t *const *rows, int j)
+            {
+                return columnSum(rows, j, std::make_integer_sequence<int, SIZE>());
+            }
+
+            // sum over k of line[j + (k - RADIUS) * step] * weight(k)
+            template <typename L>
+            static inline int row(const L *line, int j, int step)
+            {
+                return rowSum(line, j, step, std::make_integer_sequence<int, SIZE>());
+            }
+
+        private:
+            template <int... I>
+            static inline int columnSum(const uint8_t *const *rows, int j, std::integer_sequence<int, I...>)
+            {
+                return (weighTap<weights[I]>(rows[I][j]) + ... + 0);
+            }
+
+            template <typename L, int... I>
+            static inline int rowSum(const L *line, int j, int step, std::integer_sequence<int, I...>)
+            {
+                return (weighTap<weights[I]>(line[j + (I - RADIUS) * step]) + ... + 0);
+            }
+        };
+
+        using SobelXKernel = StaticKernel<3,
+                                          -1, 0, 1,
+                                          -2, 0, 2,
+                                          -1, 0, 1>;
+        using SobelYKernel = StaticKernel<3,
+                                          -1, -2, -1,
+                                          0, 0, 0,
+                                          1, 2, 1>;
+        using SharpenKernel = StaticKernel<3,
+                                           0, -1, 0,
+                                           -1, 5, -1,
+                                           0, -1, 0>;
+        using Binomial3Kernel = StaticKernel<3,     // Sum 16, all shifts
+                                             1, 2, 1,
+                                             2, 4, 2,
+                                             1, 2, 1>;
+        using Binomial5Taps = StaticTaps<1, 4, 6, 4, 1>;    // Sum 16 per pass
+
+        // All-integer convolution with a compile-time kernel; the sum is
+        // divided by 2^SHIFT. Borders are handled as in ConvolutionFilter, so
+        // the two are interchangeable bit for bit on the same kernel.
+        template <typename KERNEL, int SHIFT = 0>
+        class StaticConvolutionFilter : public BaseFilter
+        {
+        public:
+            const char *getName() const override { return "static convolution"; }
+            int getRadius() const override { return KERNEL::RADIUS; }
+            int getMultiplierCount() const override { return KERNEL::MULTIPLIES; }
+            bool supportsFormat(PixelFormat) const override { return true; }
+
+            void apply(pixel *input, pixel *output, int width, int height) override
+            {
+                applyRows(input, output, width, height);
+            }
+
+            void processRows(const RowBand &band) override { processBand(band); }
+            void processRows(const GrayRowBand &band) override { processBand(band); }
+
+        private:
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band)
+            {
+                // Channels stay interleaved: neighbouring pixels are sizeof(T) samples apart
+                const int step = sizeof(T);
+                constexpr int radius = KERNEL::RADIUS;
+                int width = band.width;
+                int height = band.height;
+                bool padded = band.padded();
+                int begin = padded ? 0 : radius * step;
+                int end = padded ? width * step : (width - radius) * step;
+
+                for (int y = band.y0; y < band.y1; y++)
+                {
+                    const T *center = band.inputRow(y);
+                    T *out = band.outputRow(y);
+
+                    if (!padded && (y < radius || y >= height - radius))
+                    {
+                        memcpy(out, center, width * sizeof(T));
+                        continue;
+                    }
+
+                    const uint8_t *window[2 * radius + 1];
+                    for (int k = 0; k <= 2 * radius; k++)
+                    {
+                        window[k] = reinterpret_cast<const uint8_t *>(band.inputRow(y - radius + k));
+                    }
+
+                    uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                    for (int j = begin; j < end; j++)
+                    {
+                        dst[j] = descaleSample<SHIFT>(KERNEL::apply(window, j, step));
+                    }
+
+                    if (!padded)
+                        copyEdgeColumns(center, out, width, radius);
+                }
+            }
+        };
+
+        // Separable form: COLUMN taps down, then ROW taps across an integer
+        // line; the exact integer sum equals the dense outer-product kernel's
+        template <typename ROW, typename COLUMN, int SHIFT = 0>
+        class StaticSeparableFilter : public BaseFilter
+        {
+        public:
+            static_assert(ROW::SIZE == COLUMN::SIZE, "Row and column taps must have the same length");
+
+            const char *getName() const override { return "static separable"; }
+            int getRadius() const override { return ROW::RADIUS; }
+            int getMultiplierCount() const override { return ROW::MULTIPLIES + COLUMN::MULTIPLIES; }
+            bool supportsFormat(PixelFormat) const override { return true; }
+
+            void apply(pixel *input, pixel *output, int width, int height) override
+            {
+                applyRows(input, output, width, height);
+            }
+
+            void processRows(const RowBand &band) override { processBand(band); }
+            void processRows(const GrayRowBand &band) override { processBand(band); }
+
+        private:
+            // Column sums stay in 16 bits when the taps allow: twice the lanes per vector
+            typedef typename std::conditional<(COLUMN::BOUND <= 32767), int16_t, int>::type Line;
+
+            template <typename T>
+            void processBand(const BasicRowBand<T> &band)
+            {
+                const int step = sizeof(T);
+                constexpr int radius = ROW::RADIUS;
+                int width = band.width;
+                int height = band.height;
+                bool padded = band.padded();
+
+                // Padded rows: the column pass also covers the aprons
+                int apron = padded ? radius * step : 0;
+                int lineBytes = width * step + 2 * apron;
+                int begin = padded ? 0 : radius * step;
+                int end = padded ? width * step : (width - radius) * step;
+
+                // One column-pass line per thread keeps bands independent
+                thread_local std::vector<Line> columnPass;
+                if (static_cast<int>(columnPass.size()) < lineBytes)
+                {
+                    columnPass.resize(lineBytes);
+                }
+                Line *line = columnPass.data() + apron;
+
+                for (int y = band.y0; y < band.y1; y++)
+                {
+                    const T *center = band.inputRow(y);
+                    T *out = band.outputRow(y);
+
+                    if (!padded && (y < radius || y >= height - radius))
+                    {
+                        memcpy(out, center, width * sizeof(T));
+                        continue;
+                    }
+
+                    const uint8_t *window[2 * radius + 1];
+                    for (int k = 0; k <= 2 * radius; k++)
+                    {
+                        window[k] = reinterpret_cast<const uint8_t *>(band.inputRow(y - radius + k));
+                    }
+
+                    for (int j = -apron; j < lineBytes - apron; j++)
+                    {
+                        line[j] = static_cast<Line>(COLUMN::column(window, j));
+                    }
+
+                    uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                    for (int j = begin; j < end; j++)
+                    {
+                        dst[j] = descaleSample<SHIFT>(ROW::row(line, j, step));
+                    }
+
+                    if (!padded)
+                        copyEdgeColumns(center, out, width, radius);
+                }
+            }
+        };
+
+        using SharpenFilter = StaticConvolutionFilter<SharpenKernel>;
+        using SobelXFilter = StaticConvolutionFilter<SobelXKernel>;
+        using SobelYFilter = StaticConvolutionFilter<SobelYKernel>;
+        using Binomial3Filter = StaticConvolutionFilter<Binomial3Kernel, 4>;
+        using Binomial5Filter = StaticSeparableFilter<Binomial5Taps, Binomial5Taps, 8>;
+    }
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hardware {
+    namespace pipeline {
+        
+        // Persistent worker pool: threads are created once and reused for every
+        // parallel region, modelling a fixed array of processing elements
+        class ThreadPool {
+        private:
+            std::vector<std::thread> workers;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable done;
+            
+            const std::function<void(int)>* job;
+            int jobCount;
+            std::atomic<int> nextTask;
+            int pendingWorkers;
+            unsigned generation;
+            bool stopping;
+            
+            void workerLoop();
+            void runTasks();
+            
+        public:
+            // threadCount includes the calling thread; 1 means run inline
+            explicit ThreadPool(int threadCount);
+            ~ThreadPool();
+            
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+            
+            int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+            
+            // Run task(i) for every i in [0, count) and wait for all of them.
+            // The calling thread takes part in the work.
+            void parallelFor(int count, const std::function<void(int)>& task);
+        };
+        
+    } // namespace pipeline
+} // namespace hardware
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,92 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include "pixel.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        // Out-of-core raw image for frames too large to hold: square tiles of
+        // 8-bit samples (1 or 3 channels) behind a header and an index of tile
+        // offsets, the whole file memory-mapped. Edge tiles are stored padded
+        // to full size and every created tile starts on a page boundary, so
+        // the pages of finished tiles can be dropped from the process; the
+        // page cache decides what stays in memory.
+        //
+        // Layout (little-endian):
+        //   "HWTILES1"                       magic
+        //   uint32 width, height, tileSize, channels
+        //   uint64 offset of every tile, row-major by tile row
+        class TiledImage
+        {
+        private:
+            std::string path;
+            uint8_t *base;
+            size_t length;
+            bool writable;
+            int width;
+            int height;
+            int tileSize;
+            int channels;
+            int tilesAcross;
+            int tilesDown;
+            const uint64_t *index;
+
+            size_t tileBytes() const { return static_cast<size_t>(tileSize) * tileSize * channels; }
+
+        public:
+            TiledImage();
+            ~TiledImage();
+
+            TiledImage(const TiledImage &) = delete;
+            TiledImage &operator=(const TiledImage &) = delete;
+
+            // Map an existing file read-only, checking the header and index
+            bool open(const char *filename);
+
+            // Create (and reserve disk space for) a file of zeroed tiles
+            bool create(const char *filename, int width, int height, int channels, int tileSize);
+
+            // Unmap; false if a created file could not be written back
+            bool close();
+
+            bool isOpen() const { return base != nullptr; }
+            int getWidth() const { return width; }
+            int getHeight() const { return height; }
+            int getTileSize() const { return tileSize; }
+            int getChannels() const { return channels; }
+            int getTilesAcross() const { return tilesAcross; }
+            int getTilesDown() const { return tilesDown; }
+
+            // Samples of row y (absolute) within tile column tx: tileSize
+            // samples of `channels` bytes, of which the image holds
+            // min(tileSize, width - tx * tileSize)
+            uint8_t *tileRow(int tx, int y) const
+            {
+                return base + index[static_cast<size_t>(y / tileSize) * tilesAcross + tx] +
+                       static_cast<size_t>(y % tileSize) * tileSize * channels;
+            }
+
+            // Gather a rectangle from every tile it overlaps as RGB pixels
+            // (gray replicated), rows `stride` pixels apart
+            void readRegion(int x0, int y0, int w, int h, pixel *out, size_t stride) const;
+
+            // One full image row, in and out, in the file's channels
+            void readRow(int y, uint8_t *samples) const;
+            void writeRow(int y, const uint8_t *samples);
+
+            // Drop the pages of tile rows [first, last) from this process;
+            // they are read back from the page cache or the file if needed
+            void releaseTileRows(int first, int last) const;
+        };
+
+        // True when the file starts with the tiled image magic
+        bool isTiledImage(const char *filename);
+    }
+}
+
+#endif
@@ -0,0 +1,78 @@
+#include "base_filter.h"
+#include "config.h"
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace
+        {
+            template <typename T>
+            void applyBand(BaseFilter &filter, const BasicImageView<const T> &input, const BasicImageView<T> &output,
+                           BorderMode border, uint8_t constant)
+            {
+                int radius = filter.getRadius();
+                int height = input.height;
+                thread_local std::vector<const T *> rows;
+                rows.resize(height + 2 * radius);
+                if (border == BorderMode::COPY)
+                    clampedRowPointers(input, -radius, height + 2 * radius, rows.data());
+                else
+                    paddedRowPointers(input.data, input.stride, -radius, height + 2 * radius, rows.data());
+
+                BasicRowBand<T> band = {rows.data(), output.data, output.stride, 0, height, input.width, height, radius,
+                                        border, constant};
+                filter.beginFrame();
+                filter.processRows(band);
+            }
+
+            template <typename T>
+            BasicImageView<const T> constView(const BasicImageView<T> &view)
+            {
+                return {view.data, view.width, view.height, view.stride};
+            }
+        }
+
+        void BaseFilter::applyGray(uint8_t *input, uint8_t *output, int width, int height)
+        {
+            if (!supportsFormat(PixelFormat::GRAY8))
+            {
+                LOG_ERROR("Filter does not accept gray planes");
+                return;
+            }
+            applyRows(input, output, width, height);
+        }
+
+        void BaseFilter::applyView(const ImageView &input, const ImageView &output, BorderMode border, uint8_t constant)
+        {
+            applyBand(*this, constView(input), output, border, constant);
+        }
+
+        void BaseFilter::applyView(const GrayImageView &input, const GrayImageView &output, BorderMode border,
+                                   uint8_t constant)
+        {
+            if (!supportsFormat(PixelFormat::GRAY8))
+            {
+                LOG_ERROR("Filter does not accept gray planes");
+                return;
+            }
+            applyBand(*this, constView(input), output, border, constant);
+        }
+
+        void BaseFilter::processRows(const GrayRowBand &)
+        {
+            LOG_ERROR("Filter does not accept gray planes");
+        }
+
+        void BaseFilter::applyRows(const pixel *input, pixel *output, int width, int height)
+        {
+            applyBand(*this, packedView(input, width, height), packedView(output, width, height), BorderMode::COPY, 0);
+        }
+
+        void BaseFilter::applyRows(const uint8_t *input, uint8_t *output, int width, int height)
+        {
+            applyBand(*this, packedView(input, width, height), packedView(output, width, height), BorderMode::COPY, 0);
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#include "batch.h"
+#include "config.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        namespace fs = std::filesystem;
+
+        namespace
+        {
+            bool isImageFile(const fs::path &path)
+            {
+                std::string ext = path.extension().string();
+                std::transform(ext.begin(), ext.end(), ext.begin(),
+                               [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                return ext == ".ppm" || ext == ".pgm" || ext == ".pnm" || ext == ".qoi";
+            }
+
+            std::string outputFor(const fs::path &input, const fs::path &outputDir, const std::string &suffix)
+            {
+                std::string name = input.stem().string() + suffix + input.extension().string();
+                return (outputDir / name).string();
+            }
+
+            std::string trim(const std::string &text)
+            {
+                size_t begin = text.find_first_not_of(" \t\r");
+                if (begin == std::string::npos)
+                    return "";
+                size_t end = text.find_last_not_of(" \t\r");
+                return text.substr(begin, end - begin + 1);
+            }
+        }
+
+        BatchRunner::BatchRunner(Pipeline &target, int ioThreads, int depth)
+            : pipeline(target),
+              decodeThreads(std::max(1, ioThreads)),
+              encodeThreads(std::max(1, ioThreads)),
+              queueDepth(std::max(1, depth))
+        {
+        }
+
+        int BatchRunner::run(const std::vector<BatchItem> &items)
+        {
+            if (items.empty())
+            {
+                LOG_WARNING("Batch is empty");
+                return 0;
+            }
+
+            // Every frame that can be in flight (queued or held by a thread)
+            // keeps its blocks cached, so the pool stops allocating after the
+            // first few frames of a resolution
+            size_t inFlight = 2 * queueDepth + decodeThreads + encodeThreads + 1;
+            memory::BufferPool &pool = pipeline.getBufferPool();
+            if (pool.getMaxBlocksPerSize() < 2 * inFlight)
+            {
+                pool.setMaxBlocksPerSize(2 * inFlight);
+            }
+
+            BoundedQueue<std::unique_ptr<FrameJob>> decoded(queueDepth);
+            BoundedQueue<std::unique_ptr<FrameJob>> processed(queueDepth);
+            std::atomic<size_t> nextItem(0);
+            std::atomic<int> activeDecoders(decodeThreads);
+            std::atomic<int> failures(0);
+
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<std::thread> decoders;
+            for (int t = 0; t < decodeThreads; t++)
+            {
+                decoders.emplace_back([&]() {
+                    size_t index;
+                    while ((index = nextItem.fetch_add(1)) < items.size())
+                    {
+                        std::unique_ptr<FrameJob> job(new FrameJob(items[index].inputPath.c_str(),
+                                                                   items[index].outputPath.c_str()));
+                        if (!pipeline.decode(*job))
+                        {
+                            std::cerr << "[BATCH] ERROR: Failed to decode " << items[index].inputPath << std::endl;
+                            failures++;
+                            continue;
+                        }
+                        if (!decoded.push(std::move(job)))
+                            break;
+                    }
+
+                    // The last decoder to finish ends the compute stage's input
+                    if (activeDecoders.fetch_sub(1) == 1)
+                        decoded.close();
+                });
+            }
+
+            std::vector<std::thread> encoders;
+            for (int t = 0; t < encodeThreads; t++)
+            {
+                encoders.emplace_back([&]() {
+                    std::unique_ptr<FrameJob> job;
+                    while (processed.pop(job))
+                    {
+                        if (!pipeline.encode(*job))
+                        {
+                            std::cerr << "[BATCH] ERROR: Failed to write " << job->outputPath << std::endl;
+                            failures++;
+                        }
+                        job.reset();
+                    }
+                });
+            }
+
+            // Compute runs on the calling thread; process() calls never overlap
+            std::unique_ptr<FrameJob> job;
+            while (decoded.pop(job))
+            {
+                if (!pipeline.process(*job))
+                {
+                    std::cerr << "[BATCH] ERROR: Failed to process " << job->inputPath << std::endl;
+                    failures++;
+                    continue;
+                }
+                processed.push(std::move(job));
+            }
+            processed.close();
+
+            for (auto &thread : decoders)
+            {
+                thread.join();
+            }
+            for (auto &thread : encoders)
+            {
+                thread.join();
+            }
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            int succeeded = static_cast<int>(items.size()) - failures.load();
+            std::cout << "[BATCH] " << succeeded << "/" << items.size() << " image(s) in "
+                      << seconds * 1000.0 << " ms";
+            if (seconds > 0.0)
+            {
+                std::cout << " (" << succeeded / seconds << " images/s)";
+            }
+            std::cout << std::endl;
+
+            return failures.load();
+        }
+
+        bool BatchRunner::collectItems(const std::string &source, const std::string &outputDir,
+                                       const std::string &suffix, std::vector<BatchItem> &items)
+        {
+            std::error_code error;
+            fs::path outDir(outputDir);
+            std::vector<fs::path> inputs;
+
+            if (fs::is_directory(source, error))
+            {
+                for (const auto &entry : fs::directory_iterator(source, error))
+                {
+                    if (entry.is_regular_file(error) && isImageFile(entry.path()))
+                        inputs.push_back(entry.path());
+                }
+                if (error)
+                {
+                    std::cerr << "Error: could not read directory " << source << ": " << error.message() << std::endl;
+                    return false;
+                }
+                std::sort(inputs.begin(), inputs.end());
+            }
+            else
+            {
+                std::ifstream list(source);
+                if (!list.is_open())
+                {
+                    std::cerr << "Error: could not open batch list " << source << std::endl;
+                    return false;
+                }
+
+                std::string line;
+                while (std::getline(list, line))
+                {
+                    line = trim(line);
+                    if (!line.empty() && line[0] != '#')
+                        inputs.push_back(line);
+                }
+            }
+
+            if (!fs::is_directory(outDir, error) && !fs::create_directories(outDir, error))
+            {
+                std::cerr << "Error: could not create output directory " << outputDir << std::endl;
+                return false;
+            }
+
+            for (const auto &input : inputs)
+            {
+                items.push_back({input.string(), outputFor(input, outDir, suffix)});
+            }
+
+            LOG_INFO("Batch: " << items.size() << " image(s) from " << source);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#include "block_filter.h"
+#include "config.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace
+        {
+            std::atomic<unsigned long> frameCounter(0);
+
+            // One block of finished output rows on one thread
+            struct CachedBlock
+            {
+                const void *owner = nullptr;
+                unsigned long serial = 0;
+                int first = -1;
+                unsigned long lastUse = 0;
+                std::vector<uint8_t> pixels;
+            };
+
+            // The owner's block slot on this thread; a few slots let chained
+            // block filters interleave rows without evicting each other
+            CachedBlock &blockSlot(const void *owner)
+            {
+                thread_local CachedBlock slots[4];
+                thread_local unsigned long clock = 0;
+
+                CachedBlock *victim = &slots[0];
+                for (CachedBlock &slot : slots)
+                {
+                    if (slot.owner == owner)
+                    {
+                        victim = &slot;
+                        break;
+                    }
+                    if (slot.lastUse < victim->lastUse)
+                        victim = &slot;
+                }
+                if (victim->owner != owner)
+                {
+                    victim->owner = owner;
+                    victim->first = -1;
+                }
+                victim->lastUse = ++clock;
+                return *victim;
+            }
+        }
+
+        BlockFilter::BlockFilter(int rows)
+            : frameSerial(++frameCounter), blockRows(std::max(rows, 1))
+        {
+        }
+
+        void BlockFilter::beginFrame()
+        {
+            frameSerial = ++frameCounter;
+        }
+
+        void BlockFilter::processRows(const RowBand &band)
+        {
+            processBand(band);
+        }
+
+        void BlockFilter::processRows(const GrayRowBand &band)
+        {
+            processBand(band);
+        }
+
+        template <typename T>
+        void BlockFilter::processBand(const BasicRowBand<T> &band)
+        {
+            size_t rowBytes = static_cast<size_t>(band.width) * sizeof(T);
+
+            CachedBlock &block = blockSlot(this);
+            for (int y = band.y0; y < band.y1; y++)
+            {
+                int first = y - y % blockRows;
+                if (block.serial != frameSerial || block.first != first)
+                {
+                    int last = std::min(first + blockRows, band.height);
+                    if (block.pixels.size() < (last - first) * rowBytes)
+                    {
+                        block.pixels.resize((last - first) * rowBytes);
+                    }
+                    filterBlock(band, first, last, reinterpret_cast<T *>(block.pixels.data()));
+                    block.serial = frameSerial;
+                    block.first = first;
+                }
+
+                memcpy(band.outputRow(y), block.pixels.data() + (y - first) * rowBytes, rowBytes);
+            }
+        }
+    }
+}
@@ -0,0 +1,266 @@
+#include "box_filter.h"
+#include "config.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace
+        {
+            int checkedRadius(int r, const char *tag)
+            {
+                int clamped = std::min(std::max(r, 1), MAX_BOX_RADIUS);
+                if (clamped != r)
+                {
+                    std::cerr << tag << " WARNING: Radius " << r << " out of range, using " << clamped << "\n";
+                }
+                return clamped;
+            }
+
+            std::atomic<unsigned long> frameCounter(0);
+
+            // Column sums one filter left on one thread, ready for the row
+            // after the last one it filtered
+            struct ColumnState
+            {
+                const void *owner = nullptr;
+                unsigned long serial = 0;
+                int next = -1;              // Row the sums continue at (-1: none)
+                int lineSamples = 0;
+                unsigned long lastUse = 0;
+                std::vector<uint16_t> sums;
+            };
+
+            // The owner's slot on this thread; a few slots let chained box
+            // filters stream row by row without evicting each other
+            ColumnState &columnSlot(const void *owner)
+            {
+                thread_local ColumnState slots[4];
+                thread_local unsigned long clock = 0;
+
+                ColumnState *victim = &slots[0];
+                for (ColumnState &slot : slots)
+                {
+                    if (slot.owner == owner)
+                    {
+                        victim = &slot;
+                        break;
+                    }
+                    if (slot.lastUse < victim->lastUse)
+                        victim = &slot;
+                }
+                if (victim->owner != owner)
+                {
+                    victim->owner = owner;
+                    victim->next = -1;
+                }
+                victim->lastUse = ++clock;
+                return *victim;
+            }
+
+            // Walk a band with a (2r+1) x (2r+1) window sum and call
+            // emit(dst, j, sum, sample) for every filtered sample j of each
+            // row. Samples are interleaved bytes (sizeof(T) lanes per pixel).
+            //
+            // Column sums cover the line (plus the aprons of a padded band)
+            // and are updated by one entering and one leaving row per output
+            // row; each lane's row sum then slides by one column per sample.
+            // A band ends by dropping its last window's top row, while that
+            // row is still in the window, and the sums stay with the owner
+            // until the frame (`serial`) changes: a band that starts on the
+            // next row (streaming passes one row per band) only adds its
+            // entering row. Only a band that starts elsewhere pays for 2r+1
+            // rows, so every sample costs O(1) column adds.
+            template <typename T, typename Emit>
+            void slidingWindowRows(const BasicRowBand<T> &band, int radius, const void *owner,
+                                   unsigned long serial, const Emit &emit)
+            {
+                const int step = sizeof(T);
+                int width = band.width;
+                int height = band.height;
+                bool padded = band.padded();
+
+                int apron = padded ? radius * step : 0;
+                int lineSamples = width * step + 2 * apron;
+                int begin = padded ? 0 : radius * step;
+                int end = padded ? width * step : (width - radius) * step;
+
+                // 2r+1 samples of up to 255 stay within 16 bits for r <= 128.
+                // One spare pixel at the end absorbs the row sum's last
+                // (unused) slide so the inner loop needs no test.
+                ColumnState &state = columnSlot(owner);
+                bool resumable = state.serial == serial && state.next == band.y0 &&
+                                 state.lineSamples == lineSamples;
+                if (static_cast<int>(state.sums.size()) < lineSamples + step)
+                {
+                    state.sums.assign(lineSamples + step, 0);
+                }
+                state.serial = serial;
+                state.lineSamples = lineSamples;
+                state.next = -1;
+                uint16_t *column = state.sums.data() + apron;
+
+                bool primed = false;
+                for (int y = band.y0; y < band.y1; y++)
+                {
+                    const T *center = band.inputRow(y);
+                    T *out = band.outputRow(y);
+
+                    if (!padded && (y < radius || y >= height - radius))
+                    {
+                        memcpy(out, center, width * sizeof(T));
+                        primed = false;
+                        resumable = false;
+                        continue;
+                    }
+
+                    if (!primed && resumable)
+                    {
+                        // The sums hold rows y-r .. y+r-1
+                        const uint8_t *entering = reinterpret_cast<const uint8_t *>(band.inputRow(y + radius));
+                        for (int j = -apron; j < lineSamples - apron; j++)
+                        {
+                            column[j] = static_cast<uint16_t>(column[j] + entering[j]);
+                        }
+                        primed = true;
+                    }
+                    else if (!primed)
+                    {
+                        std::fill(column - apron, column - apron + lineSamples, 0);
+                        for (int k = -radius; k <= radius; k++)
+                        {
+                            const uint8_t *row = reinterpret_cast<const uint8_t *>(band.inputRow(y + k));
+                            for (int j = -apron; j < lineSamples - apron; j++)
+                            {
+                                column[j] = static_cast<uint16_t>(column[j] + row[j]);
+                            }
+                        }
+                        primed = true;
+                    }
+                    else
+                    {
+                        const uint8_t *entering = reinterpret_cast<const uint8_t *>(band.inputRow(y + radius));
+                        const uint8_t *leaving = reinterpret_cast<const uint8_t *>(band.inputRow(y - radius - 1));
+                        for (int j = -apron; j < lineSamples - apron; j++)
+                        {
+                            column[j] = static_cast<uint16_t>(column[j] + entering[j] - leaving[j]);
+                        }
+                    }
+
+                    const uint8_t *src = reinterpret_cast<const uint8_t *>(center);
+                    uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                    for (int lane = 0; lane < step && begin < end; lane++)
+                    {
+                        int first = begin + lane;
+                        uint32_t sum = 0;
+                        for (int k = -radius; k <= radius; k++)
+                        {
+                            sum += column[first + k * step];
+                        }
+                        for (int j = first; j < end; j += step)
+                        {
+                            emit(dst, j, sum, src[j]);
+                            sum += column[j + (radius + 1) * step] - column[j - radius * step];
+                        }
+                    }
+
+                    if (!padded)
+                    {
+                        copyEdgeColumns(center, out, width, radius);
+                    }
+                }
+
+                if (primed)
+                {
+                    int last = band.y1 - 1;
+                    const uint8_t *leaving = reinterpret_cast<const uint8_t *>(band.inputRow(last - radius));
+                    for (int j = -apron; j < lineSamples - apron; j++)
+                    {
+                        column[j] = static_cast<uint16_t>(column[j] - leaving[j]);
+                    }
+                    state.next = band.y1;
+                }
+            }
+        }
+
+        BoxFilter::BoxFilter(int r)
+            : radius(checkedRadius(r, "[BOX]")), frameSerial(++frameCounter)
+        {
+            uint64_t area = static_cast<uint64_t>(2 * radius + 1) * (2 * radius + 1);
+            // Window sums are below 2^24, so the error of the rounded-up
+            // reciprocal stays under 2^-24 < 1/area: the floor is exact
+            reciprocal = ((1ULL << 48) + area - 1) / area;
+        }
+
+        void BoxFilter::beginFrame()
+        {
+            frameSerial = ++frameCounter;
+        }
+
+        void BoxFilter::apply(pixel *input, pixel *output, int width, int height)
+        {
+            applyRows(input, output, width, height);
+        }
+
+        void BoxFilter::processRows(const RowBand &band)
+        {
+            processBand(band);
+        }
+
+        void BoxFilter::processRows(const GrayRowBand &band)
+        {
+            processBand(band);
+        }
+
+        template <typename T>
+        void BoxFilter::processBand(const BasicRowBand<T> &band)
+        {
+            slidingWindowRows(band, radius, this, frameSerial, [this](uint8_t *dst, int j, uint32_t sum, uint8_t) {
+                dst[j] = mean(sum);
+            });
+        }
+
+        AdaptiveThresholdFilter::AdaptiveThresholdFilter(int r, int meanOffset)
+            : radius(checkedRadius(r, "[THRESHOLD]")),
+              offset(std::min(std::max(meanOffset, -255), 255)),
+              frameSerial(++frameCounter)
+        {
+        }
+
+        void AdaptiveThresholdFilter::beginFrame()
+        {
+            frameSerial = ++frameCounter;
+        }
+
+        void AdaptiveThresholdFilter::apply(pixel *input, pixel *output, int width, int height)
+        {
+            applyRows(input, output, width, height);
+        }
+
+        void AdaptiveThresholdFilter::processRows(const RowBand &band)
+        {
+            processBand(band);
+        }
+
+        void AdaptiveThresholdFilter::processRows(const GrayRowBand &band)
+        {
+            processBand(band);
+        }
+
+        template <typename T>
+        void AdaptiveThresholdFilter::processBand(const BasicRowBand<T> &band)
+        {
+            // sample > sum / area - offset  <=>  (sample + offset) * area > sum
+            int area = (2 * radius + 1) * (2 * radius + 1);
+            int bias = offset;
+            slidingWindowRows(band, radius, this, frameSerial, [area, bias](uint8_t *dst, int j, uint32_t sum, uint8_t sample) {
+                dst[j] = ((sample + bias) * area > static_cast<int>(sum)) ? 255 : 0;
+            });
+        }
+    }
+}
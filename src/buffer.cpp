@@ -0,0 +1,157 @@
+#include "buffer.h"
+#include <sys/mman.h>
+
+namespace hardware
+{
+    namespace memory
+    {
+        BufferPool::BufferPool(size_t maxPerSize)
+            : maxBlocksPerSize(maxPerSize), allocations(0), reuses(0), cachedBytes(0)
+        {
+            LOG_INFO("BufferPool created (" << maxPerSize << " blocks per size)");
+        }
+
+        BufferPool::~BufferPool()
+        {
+            trim();
+        }
+
+        void *BufferPool::acquire(size_t bytes)
+        {
+            size_t size = blockSize(bytes);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = freeBlocks.find(size);
+                if (it != freeBlocks.end() && !it->second.empty())
+                {
+                    void *block = it->second.back();
+                    it->second.pop_back();
+                    cachedBytes -= size;
+                    reuses++;
+                    LOG_VERBOSE("BufferPool reuse: " << size << " bytes");
+                    return block;
+                }
+                allocations++;
+            }
+
+            void *block = aligned_alloc(FRAME_BUFFER_ALIGNMENT, size);
+            if (!block)
+            {
+                LOG_ERROR("BufferPool allocation of " << size << " bytes failed");
+                return nullptr;
+            }
+            LOG_MEMORY_ALLOC(size, block);
+            return block;
+        }
+
+        void BufferPool::release(void *block, size_t bytes)
+        {
+            if (!block)
+                return;
+
+            size_t size = blockSize(bytes);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::vector<void *> &blocks = freeBlocks[size];
+                if (blocks.size() < maxBlocksPerSize)
+                {
+                    // Reserve up front so later releases never allocate
+                    if (blocks.capacity() < maxBlocksPerSize)
+                        blocks.reserve(maxBlocksPerSize);
+                    blocks.push_back(block);
+                    cachedBytes += size;
+                    return;
+                }
+            }
+
+            free(block);
+            LOG_MEMORY_FREE(block);
+        }
+
+        void BufferPool::trim()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &entry : freeBlocks)
+            {
+                for (void *block : entry.second)
+                {
+                    free(block);
+                    LOG_MEMORY_FREE(block);
+                }
+            }
+            freeBlocks.clear();
+            cachedBytes = 0;
+        }
+
+        void BufferPool::setMaxBlocksPerSize(size_t count)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            maxBlocksPerSize = count;
+        }
+
+        size_t BufferPool::getMaxBlocksPerSize() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return maxBlocksPerSize;
+        }
+
+        size_t BufferPool::getAllocationCount() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return allocations;
+        }
+
+        size_t BufferPool::getReuseCount() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return reuses;
+        }
+
+        size_t BufferPool::getCachedBytes() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return cachedBytes;
+        }
+
+        void BufferPool::dumpStats() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            LOG_INFO("BufferPool Stats:");
+            LOG_INFO("  Allocations: " << allocations);
+            LOG_INFO("  Reuses: " << reuses);
+            LOG_INFO("  Cached: " << cachedBytes << " bytes in " << freeBlocks.size() << " size class(es)");
+        }
+
+        void FrameBuffer::releaseStorage()
+        {
+            if (!data)
+                return;
+
+            if (pool)
+            {
+                pool->release(data - static_cast<size_t>(apron) * stride - lead, capacity);
+            }
+            else if (ownsMemory)
+            {
+#ifdef HW_SIMULATION
+                free(data);
+#else
+                delete[] data;
+#endif
+                LOG_MEMORY_FREE(data);
+            }
+            data = nullptr;
+        }
+
+        void FrameBuffer::releaseMapping()
+        {
+            if (mappedRegion)
+            {
+                munmap(mappedRegion, mappedLength);
+                LOG_MEMORY_FREE(mappedRegion);
+                mappedRegion = nullptr;
+                mappedLength = 0;
+            }
+        }
+    }
+}
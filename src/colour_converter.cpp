@@ -6,14 +6,30 @@ namespace hardware
     namespace pipeline
     {
         void convertToGrayscale(pixel *frame, int width, int height)
+        {
+            convertToGrayscale(frame, frame, width, height);
+        }
+
+        void convertToGrayscale(const pixel *input, pixel *output, int width, int height)
         {
             for (int i = 0; i < width * height; i++)
             {
                 uint8_t gray = static_cast<uint8_t>(
-                    0.299f * frame[i].r +
-                    0.587f * frame[i].g +
-                    0.114f * frame[i].b);
-                frame[i].r = frame[i].g = frame[i].b = gray;
+                    0.299f * input[i].r +
+                    0.587f * input[i].g +
+                    0.114f * input[i].b);
+                output[i].r = output[i].g = output[i].b = gray;
+            }
+        }
+
+        void convertToGrayscale(const pixel *input, uint8_t *output, int width, int height)
+        {
+            for (int i = 0; i < width * height; i++)
+            {
+                output[i] = static_cast<uint8_t>(
+                    0.299f * input[i].r +
+                    0.587f * input[i].g +
+                    0.114f * input[i].b);
             }
         }
     }
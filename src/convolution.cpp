@@ -1,52 +1,149 @@
 #include "convolution.h"
 #include "fixed_point.h"
+#include "simd_kernels.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
 #include <cstdint>
+#include <cstring>
 #include "config.h"
 
-#ifdef USE_FIXED_POINT
-#define PROCESS_VALUE(val, weight) ((TO_FIXED(val) * TO_FIXED(weight)) / FP_SCALE)
-#define CONVERT_BACK(val) FROM_FIXED(val)
-#else
-#define PROCESS_VALUE(val, weight) ((val) * (weight))
-#define CONVERT_BACK(val) static_cast<uint8_t>(std::max(0.0f, std::min((val), 255.0f)))
-#endif
-
 namespace hardware
 {
     namespace filters
     {
         ConvolutionFilter::ConvolutionFilter(const std::vector<float> &k, int size)
-            : kernel(k), kernelSize(size), kernelRadius(size / 2)
+            : kernel(k), kernelSize(size), kernelRadius(size / 2), separable(false)
         {
+            quantizeDense();
+            detectSeparable();
+        }
+
+        ConvolutionFilter::ConvolutionFilter(const std::vector<float> &row, const std::vector<float> &column)
+            : kernelSize(static_cast<int>(std::min(row.size(), column.size()))),
+              kernelRadius(kernelSize / 2), separable(false)
+        {
+            if (row.size() != column.size())
+            {
+                std::cerr << "[CONV] WARNING: Row/column kernel sizes differ ("
+                          << row.size() << " vs " << column.size() << "), truncating\n";
+            }
+
+            std::vector<float> r(row.begin(), row.begin() + kernelSize);
+            std::vector<float> c(column.begin(), column.begin() + kernelSize);
+
+            // Keep the dense form for printing and the non-separable path
+            kernel.resize(kernelSize * kernelSize);
+            for (int i = 0; i < kernelSize; i++)
+            {
+                for (int j = 0; j < kernelSize; j++)
+                {
+                    kernel[i * kernelSize + j] = c[i] * r[j];
+                }
+            }
+
+            quantizeDense();
+            setSeparable(r, c);
+        }
+
+        void ConvolutionFilter::quantizeDense()
+        {
+            denseTaps.resize(kernel.size());
+            for (size_t i = 0; i < kernel.size(); i++)
+            {
+                denseTaps[i] = TO_TAP(kernel[i]);
+            }
+        }
+
+        void ConvolutionFilter::detectSeparable()
+        {
+            if (kernelSize <= 0 || static_cast<int>(kernel.size()) != kernelSize * kernelSize)
+                return;
+
+            // Factor around the largest-magnitude coefficient
+            int pivot = 0;
+            for (int i = 1; i < kernelSize * kernelSize; i++)
+            {
+                if (std::fabs(kernel[i]) > std::fabs(kernel[pivot]))
+                    pivot = i;
+            }
+
+            float peak = kernel[pivot];
+            if (peak == 0.0f)
+                return;
+
+            int pivotRow = pivot / kernelSize;
+            int pivotCol = pivot % kernelSize;
+
+            // Split the peak evenly between the factors: both then keep the
+            // kernel's own scale, so quantized taps lose no precision (a
+            // binomial kernel factors into its exact binomial vectors). When
+            // the root is inexact, split by the nearest power of two instead,
+            // which divides exactly: integer kernels such as Sobel then give
+            // exact factors, and sums match the dense path's
+            float scale = std::sqrt(std::fabs(peak));
+            if (scale * scale != std::fabs(peak))
+                scale = std::exp2(std::round(std::log2(scale)));
+            std::vector<float> row(kernelSize), column(kernelSize);
+            for (int j = 0; j < kernelSize; j++)
+            {
+                row[j] = kernel[pivotRow * kernelSize + j] / scale;
+            }
+            for (int i = 0; i < kernelSize; i++)
+            {
+                column[i] = kernel[i * kernelSize + pivotCol] * scale / peak;
+            }
+
+            // Rank-1 check: every coefficient must be reproduced by the outer product
+            float tolerance = 1e-5f * std::fabs(peak);
+            for (int i = 0; i < kernelSize; i++)
+            {
+                for (int j = 0; j < kernelSize; j++)
+                {
+                    if (std::fabs(kernel[i * kernelSize + j] - column[i] * row[j]) > tolerance)
+                        return;
+                }
+            }
+
+            setSeparable(row, column);
+        }
+
+        void ConvolutionFilter::setSeparable(const std::vector<float> &row, const std::vector<float> &column)
+        {
+            separable = true;
+            rowKernel = row;
+            columnKernel = column;
+
+            rowTaps.resize(kernelSize);
+            columnTaps.resize(kernelSize);
+            for (int i = 0; i < kernelSize; i++)
+            {
+                rowTaps[i] = TO_TAP(row[i]);
+                columnTaps[i] = TO_TAP(column[i]);
+            }
         }
 
         ConvolutionFilter *ConvolutionFilter::createGaussian(int size, float sigma)
         {
-            std::vector<float> kernel(size * size);
+            // The 2D Gaussian is the outer product of two 1D Gaussians
+            std::vector<float> taps(size);
             int radius = size / 2;
             float sum = 0.0f;
 
-            // Create Gaussian kernel
-            for (int y = -radius; y <= radius; y++)
+            for (int x = -radius; x <= radius; x++)
             {
-                for (int x = -radius; x <= radius; x++)
-                {
-                    float value = exp(-(x * x + y * y) / (2 * sigma * sigma)) / (2 * M_PI * sigma * sigma);
-                    kernel[(y + radius) * size + (x + radius)] = value;
-                    sum += value;
-                }
+                float value = exp(-(x * x) / (2 * sigma * sigma));
+                taps[x + radius] = value;
+                sum += value;
             }
 
             // Normalize
-            for (auto &val : kernel)
+            for (auto &val : taps)
             {
                 val /= sum;
             }
 
-            return new ConvolutionFilter(kernel, size);
+            return new ConvolutionFilter(taps, taps);
         }
 
         ConvolutionFilter *ConvolutionFilter::createSharpen()
@@ -84,62 +181,172 @@ namespace hardware
             std::cout << "[CONV] Applying " << kernelSize << "x" << kernelSize
                       << " convolution\n";
             std::cout << "[CONV] Kernel radius: " << kernelRadius << "\n";
+            std::cout << "[CONV] Path: " << (separable ? "separable (2 x 1D)" : "dense")
+                      << ", " << simd::kernels().name << "\n";
 #endif
 
-            for (int y = kernelRadius; y < height - kernelRadius; y++)
+            applyRows(input, output, width, height);
+        }
+
+        void ConvolutionFilter::processRows(const RowBand &band)
+        {
+            processBand(band);
+        }
+
+        void ConvolutionFilter::processRows(const GrayRowBand &band)
+        {
+            processBand(band);
+        }
+
+        template <typename T>
+        void ConvolutionFilter::processBand(const BasicRowBand<T> &band)
+        {
+            if (separable)
+            {
+                processRowsSeparable(band);
+            }
+            else
+            {
+                processRowsDense(band);
+            }
+        }
+
+        // Both layouts are filtered as interleaved byte lines: neighbouring
+        // pixels are sizeof(T) samples apart (3 for RGB, 1 for gray planes)
+        template <typename T>
+        void ConvolutionFilter::processRowsSeparable(const BasicRowBand<T> &band)
+        {
+            const int step = sizeof(T);
+            int width = band.width;
+            int height = band.height;
+            bool padded = band.padded();
+
+            // Padded rows: the vertical pass also covers the column aprons,
+            // so the horizontal pass can produce every output sample
+            int apron = padded ? kernelRadius * step : 0;
+            int lineBytes = width * step + 2 * apron;
+            int begin = padded ? 0 : kernelRadius * step;
+            int end = padded ? width * step : (width - kernelRadius) * step;
+
+            // Vertically filtered line: K ops per sample down, then K across,
+            // instead of K*K. One line per thread keeps bands independent.
+            thread_local std::vector<Fixed> columnPass;
+            thread_local std::vector<const uint8_t *> windowRows;
+            if (static_cast<int>(columnPass.size()) < lineBytes)
+            {
+                columnPass.resize(lineBytes);
+            }
+            if (static_cast<int>(windowRows.size()) < kernelSize)
             {
-                for (int x = kernelRadius; x < width - kernelRadius; x++)
+                windowRows.resize(kernelSize);
+            }
+            Fixed *line = columnPass.data() + apron;
+            const uint8_t **window = windowRows.data();
+            const simd::KernelTable &isa = simd::kernels();
+
+            for (int y = band.y0; y < band.y1; y++)
+            {
+                const T *center = band.inputRow(y);
+                T *out = band.outputRow(y);
+
+                // Handle borders by copying
+                if (!padded && (y < kernelRadius || y >= height - kernelRadius))
                 {
-// Simulated hardware registers
-#ifdef USE_FIXED_POINT
-                    Fixed sum_r = 0, sum_g = 0, sum_b = 0;
-#else
-                    float sum_r = 0.0f, sum_g = 0.0f, sum_b = 0.0f;
-#endif
+                    memcpy(out, center, width * sizeof(T));
+                    continue;
+                }
+
+                // Vertical pass over the whole line (channels stay interleaved)
+                for (int k = 0; k < kernelSize; k++)
+                {
+                    window[k] = reinterpret_cast<const uint8_t *>(band.inputRow(y - kernelRadius + k)) - apron;
+                }
+                isa.verticalPass(window, columnTaps.data(), kernelSize, line - apron, 0, lineBytes);
 
-                    for (int ky = -kernelRadius; ky <= kernelRadius; ky++)
-                    {
-                        for (int kx = -kernelRadius; kx <= kernelRadius; kx++)
-                        {
-                            int idx = (y + ky) * width + (x + kx);
-                            int kernelIdx = (ky + kernelRadius) * kernelSize + (kx + kernelRadius);
-
-                            // Use PROCESS_VALUE macro directly - it handles the conversion
-                            sum_r += PROCESS_VALUE(input[idx].r, kernel[kernelIdx]);
-                            sum_g += PROCESS_VALUE(input[idx].g, kernel[kernelIdx]);
-                            sum_b += PROCESS_VALUE(input[idx].b, kernel[kernelIdx]);
-                        }
-                    }
-
-                    int idx = y * width + x;
-                    output[idx].r = CONVERT_BACK(sum_r);
-                    output[idx].g = CONVERT_BACK(sum_g);
-                    output[idx].b = CONVERT_BACK(sum_b);
+                // Horizontal pass: neighbouring pixels are `step` samples apart
+                uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                isa.horizontalPass(line, rowTaps.data(), kernelSize, step, dst, begin, end);
 
 #ifdef DEBUG
-                    if (x == kernelRadius && y == kernelRadius)
-                    {
-                        std::cout << "[CONV] First pixel result: "
-                                  << (int)output[idx].r << "\n";
-                    }
+                if (y == kernelRadius && width > 2 * kernelRadius)
+                {
+                    std::cout << "[CONV] First pixel result: "
+                              << (int)intensity(out[kernelRadius]) << " (separable)\n";
+                }
 #endif
+
+                // Left/right borders
+                if (!padded)
+                {
+                    copyEdgeColumns(center, out, width, kernelRadius);
                 }
             }
+        }
 
-            // Handle borders by copying
-            for (int y = 0; y < height; y++)
+        template <typename T>
+        void ConvolutionFilter::processRowsDense(const BasicRowBand<T> &band)
+        {
+            const int step = sizeof(T);
+            int width = band.width;
+            int height = band.height;
+            bool padded = band.padded();
+            int begin = padded ? 0 : kernelRadius * step;
+            int end = padded ? width * step : (width - kernelRadius) * step;
+
+            thread_local std::vector<const uint8_t *> windowRows;
+            if (static_cast<int>(windowRows.size()) < kernelSize)
             {
-                for (int x = 0; x < width; x++)
+                windowRows.resize(kernelSize);
+            }
+            const uint8_t **window = windowRows.data();
+            const simd::KernelTable &isa = simd::kernels();
+
+            for (int y = band.y0; y < band.y1; y++)
+            {
+                const T *center = band.inputRow(y);
+                T *out = band.outputRow(y);
+
+                // Handle borders by copying
+                if (!padded && (y < kernelRadius || y >= height - kernelRadius))
+                {
+                    memcpy(out, center, width * sizeof(T));
+                    continue;
+                }
+
+                // Simulated hardware registers: one accumulator per sample lane
+                for (int k = 0; k < kernelSize; k++)
+                {
+                    window[k] = reinterpret_cast<const uint8_t *>(band.inputRow(y - kernelRadius + k));
+                }
+                uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                isa.denseRow(window, denseTaps.data(), kernelSize, step, dst, begin, end);
+
+#ifdef DEBUG
+                if (y == kernelRadius && width > 2 * kernelRadius)
+                {
+                    std::cout << "[CONV] First pixel result: "
+                              << (int)intensity(out[kernelRadius]) << "\n";
+                }
+#endif
+
+                // Left/right borders
+                if (!padded)
                 {
-                    if (y < kernelRadius || y >= height - kernelRadius ||
-                        x < kernelRadius || x >= width - kernelRadius)
-                    {
-                        output[y * width + x] = input[y * width + x];
-                    }
+                    copyEdgeColumns(center, out, width, kernelRadius);
                 }
             }
         }
 
+        int ConvolutionFilter::getMultiplierCount() const
+        {
+            auto nonZero = [](const std::vector<KernelTap> &taps) {
+                return static_cast<int>(std::count_if(taps.begin(), taps.end(), [](const KernelTap &t) {
+                    return TAP_WEIGHT(t) != 0;
+                }));
+            };
+            return separable ? nonZero(rowTaps) + nonZero(columnTaps) : nonZero(denseTaps);
+        }
+
         void ConvolutionFilter::printKernel() const
         {
             std::cout << "Convolution Kernel " << kernelSize << "x" << kernelSize << ":\n";
@@ -151,6 +358,21 @@ namespace hardware
                 }
                 std::cout << "\n";
             }
+
+            if (separable)
+            {
+                std::cout << "Separable: row [";
+                for (int j = 0; j < kernelSize; j++)
+                {
+                    std::cout << (j ? " " : "") << rowKernel[j];
+                }
+                std::cout << "] x column [";
+                for (int i = 0; i < kernelSize; i++)
+                {
+                    std::cout << (i ? " " : "") << columnKernel[i];
+                }
+                std::cout << "]\n";
+            }
         }
     }
 }
\ No newline at end of file
@@ -1,8 +1,9 @@
 #include "edge_filter.h"
-#include "fixed_point.h"
+#include "static_kernel.h"
 #include <cstdlib>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
 
 namespace hardware
 {
@@ -40,76 +41,76 @@ namespace hardware
                 return;
             }
 
-            int Gx[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
-            int Gy[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
-
             std::cout << "[EDGE] Processing interior pixels..." << std::endl;
 
-            for (int y = 1; y < height - 1; y++)
+            applyRows(input, output, width, height);
+
+            std::cout << "[EDGE] Filter applied successfully." << std::endl;
+        }
+
+        namespace
+        {
+            // Shared by RGB frames and gray planes: reads and writes intensities only
+            template <typename T>
+            void sobelRows(const BasicRowBand<T> &band)
             {
-                for (int x = 1; x < width - 1; x++)
+                // Gradients in integer arithmetic: the compile-time Sobel
+                // kernels reduce to 6 adds/shifts each (zero taps dropped)
+                const int step = sizeof(T);
+                int width = band.width;
+                int height = band.height;
+                bool padded = band.padded();
+
+                // Padded rows have their borders filled in: filter every column
+                int x0 = padded ? 0 : 1;
+                int x1 = padded ? width : width - 1;
+
+                for (int y = band.y0; y < band.y1; y++)
                 {
-                    Fixed gx = 0, gy = 0;
-                    for (int ky = -1; ky <= 1; ky++)
+                    T *out = band.outputRow(y);
+
+                    // Top/bottom borders (and frames too small to filter) are black
+                    if (!padded && (y < 1 || y >= height - 1 || width <= 2 || height <= 2))
                     {
-                        for (int kx = -1; kx <= 1; kx++)
-                        {
-                            int idx = (y + ky) * width + (x + kx);
-
-                            // Bounds check
-                            if (idx < 0 || idx >= width * height)
-                            {
-                                std::cerr << "[EDGE] ERROR: Index out of bounds! idx=" << idx << std::endl;
-                                continue;
-                            }
-
-                            Fixed intensity = Fixed((float)input[idx].r);
-                            gx += intensity * Gx[ky + 1][kx + 1];
-                            gy += intensity * Gy[ky + 1][kx + 1];
-                        }
+                        memset(out, 0, width * sizeof(T));
+                        continue;
                     }
 
-                    int mag = (int)(float(std::abs(gx) + std::abs(gy)));
-                    if (mag > 255)
-                        mag = 255;
-
-                    int idx = y * width + x;
+                    // The intensity is the first byte of every sample
+                    const uint8_t *window[3] = {reinterpret_cast<const uint8_t *>(band.inputRow(y - 1)),
+                                                reinterpret_cast<const uint8_t *>(band.inputRow(y)),
+                                                reinterpret_cast<const uint8_t *>(band.inputRow(y + 1))};
 
-                    // Bounds check for output
-                    if (idx < 0 || idx >= width * height)
+                    for (int x = x0; x < x1; x++)
                     {
-                        std::cerr << "[EDGE] ERROR: Output index out of bounds!" << std::endl;
-                        continue;
-                    }
+                        int gx = SobelXKernel::apply(window, x * step, step);
+                        int gy = SobelYKernel::apply(window, x * step, step);
 
-                    output[idx].r = output[idx].g = output[idx].b = (uint8_t)mag;
-                }
-            }
+                        int mag = std::abs(gx) + std::abs(gy);
+                        if (mag > 255)
+                            mag = 255;
 
-            std::cout << "[EDGE] Setting borders to black..." << std::endl;
+                        setIntensity(out[x], (uint8_t)mag);
+                    }
 
-            // Handle borders - set to black
-            for (int x = 0; x < width; x++)
-            {
-                if (x < width * height)
-                    output[x] = pixel{0, 0, 0};
-                if ((height - 1) * width + x < width * height)
-                {
-                    output[(height - 1) * width + x] = pixel{0, 0, 0};
+                    // Left/right borders
+                    if (!padded)
+                    {
+                        out[0] = T{};
+                        out[width - 1] = T{};
+                    }
                 }
             }
+        }
 
-            for (int y = 0; y < height; y++)
-            {
-                if (y * width < width * height)
-                    output[y * width] = pixel{0, 0, 0};
-                if (y * width + width - 1 < width * height)
-                {
-                    output[y * width + width - 1] = pixel{0, 0, 0};
-                }
-            }
+        void EdgeFilter::processRows(const RowBand &band)
+        {
+            sobelRows(band);
+        }
 
-            std::cout << "[EDGE] Filter applied successfully." << std::endl;
+        void EdgeFilter::processRows(const GrayRowBand &band)
+        {
+            sobelRows(band);
         }
     }
-}
\ No newline at end of file
+}
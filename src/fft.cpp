@@ -0,0 +1,164 @@
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace fft
+        {
+            namespace
+            {
+                // In place, in cache-sized blocks
+                void transpose(float *a, int n)
+                {
+                    const int block = 16;
+                    for (int i0 = 0; i0 < n; i0 += block)
+                    {
+                        for (int j0 = i0; j0 < n; j0 += block)
+                        {
+                            for (int i = i0; i < std::min(i0 + block, n); i++)
+                            {
+                                for (int j = (j0 == i0 ? i + 1 : j0); j < std::min(j0 + block, n); j++)
+                                {
+                                    std::swap(a[static_cast<size_t>(i) * n + j], a[static_cast<size_t>(j) * n + i]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            int nextPowerOfTwo(int n)
+            {
+                int p = 1;
+                while (p < n)
+                {
+                    p <<= 1;
+                }
+                return p;
+            }
+
+            Plan::Plan(int size)
+                : n(nextPowerOfTwo(std::max(size, 1)))
+            {
+                int bits = 0;
+                while ((1 << bits) < n)
+                {
+                    bits++;
+                }
+
+                reversed.resize(n);
+                for (int i = 0; i < n; i++)
+                {
+                    int r = 0;
+                    for (int b = 0; b < bits; b++)
+                    {
+                        r |= ((i >> b) & 1) << (bits - 1 - b);
+                    }
+                    reversed[i] = r;
+                }
+
+                const double pi = 3.14159265358979323846;
+                cosines.resize(std::max(n / 2, 1));
+                sines.resize(std::max(n / 2, 1));
+                for (int k = 0; k < n / 2; k++)
+                {
+                    cosines[k] = static_cast<float>(std::cos(2.0 * pi * k / n));
+                    sines[k] = static_cast<float>(std::sin(2.0 * pi * k / n));
+                }
+            }
+
+            void Plan::transform(float *re, float *im, bool inverse) const
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    int j = reversed[i];
+                    if (i < j)
+                    {
+                        std::swap(re[i], re[j]);
+                        std::swap(im[i], im[j]);
+                    }
+                }
+
+                // Forward uses e^(-2*pi*i*k/n), inverse its conjugate
+                float sign = inverse ? 1.0f : -1.0f;
+                for (int length = 2; length <= n; length <<= 1)
+                {
+                    int half = length / 2;
+                    int stride = n / length;
+                    for (int start = 0; start < n; start += length)
+                    {
+                        for (int k = 0; k < half; k++)
+                        {
+                            float wr = cosines[k * stride];
+                            float wi = sign * sines[k * stride];
+                            int a = start + k;
+                            int b = a + half;
+                            float tr = wr * re[b] - wi * im[b];
+                            float ti = wr * im[b] + wi * re[b];
+                            re[b] = re[a] - tr;
+                            im[b] = im[a] - ti;
+                            re[a] += tr;
+                            im[a] += ti;
+                        }
+                    }
+                }
+            }
+
+            void Plan::transform2D(float *re, float *im, bool inverse) const
+            {
+                transformColumns(re, im, inverse);
+                transpose(re, n);
+                transpose(im, n);
+                transformColumns(re, im, inverse);
+            }
+
+            // The same butterflies as transform(), with whole rows as operands
+            void Plan::transformColumns(float *re, float *im, bool inverse) const
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    int j = reversed[i];
+                    if (i < j)
+                    {
+                        std::swap_ranges(re + static_cast<size_t>(i) * n, re + static_cast<size_t>(i + 1) * n,
+                                         re + static_cast<size_t>(j) * n);
+                        std::swap_ranges(im + static_cast<size_t>(i) * n, im + static_cast<size_t>(i + 1) * n,
+                                         im + static_cast<size_t>(j) * n);
+                    }
+                }
+
+                float sign = inverse ? 1.0f : -1.0f;
+                for (int length = 2; length <= n; length <<= 1)
+                {
+                    int half = length / 2;
+                    int stride = n / length;
+                    for (int start = 0; start < n; start += length)
+                    {
+                        for (int k = 0; k < half; k++)
+                        {
+                            float wr = cosines[k * stride];
+                            float wi = sign * sines[k * stride];
+                            float *ar = re + static_cast<size_t>(start + k) * n;
+                            float *ai = im + static_cast<size_t>(start + k) * n;
+                            float *br = ar + static_cast<size_t>(half) * n;
+                            float *bi = ai + static_cast<size_t>(half) * n;
+                            for (int x = 0; x < n; x++)
+                            {
+                                float tr = wr * br[x] - wi * bi[x];
+                                float ti = wr * bi[x] + wi * br[x];
+                                br[x] = ar[x] - tr;
+                                bi[x] = ai[x] - ti;
+                                ar[x] += tr;
+                                ai[x] += ti;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,318 @@
+#include "fft_convolution.h"
+#include "convolution.h"
+#include "fixed_point.h"
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace
+        {
+            // Cost model, in units of one direct multiply-add (the vector
+            // dense loop); measured with bench/benchmark on 1080p frames
+            constexpr float SEPARABLE_TAP_COST = 1.0f;     // Two passes of K taps
+            constexpr float BUTTERFLY_COST = 6.0f;         // Per complex butterfly of a 2D transform
+            constexpr float SPECTRUM_COST = 8.0f;          // Per sample: load, transposes, product, store
+
+            int log2Of(int n)
+            {
+                int bits = 0;
+                while ((1 << bits) < n)
+                {
+                    bits++;
+                }
+                return bits;
+            }
+
+            // Forward and inverse transform plus spectrum product of one
+            // N x N tile, shared by the two real planes it carries
+            float tileCost(int n)
+            {
+                float butterflies = 2.0f * n * n * log2Of(n);  // Rows and columns, one direction
+                return (2.0f * butterflies * BUTTERFLY_COST + float(n) * n * SPECTRUM_COST) / 2.0f;
+            }
+
+            // FFT cost per output sample with N x N tiles
+            float fftCost(int n, int kernelSize, int width, int height)
+            {
+                int tile = n - kernelSize + 1;
+                if (width <= 0 || height <= 0)
+                {
+                    return tileCost(n) / (float(tile) * tile);
+                }
+                float tiles = float((width + tile - 1) / tile) * ((height + tile - 1) / tile);
+                return tiles * tileCost(n) / (float(width) * height);
+            }
+
+            // Well above the transform's round-off on sums of 8-bit samples
+            constexpr float ROUNDOFF = 1.0f / 1024;
+
+            // Back to a sample as the direct path converts the same sum: the
+            // fixed-point build rounds half up, the float build truncates.
+            // Round-off is absorbed first, so a sum that lands just under a
+            // whole number is not pushed down one level.
+            inline uint8_t toPixel(float v)
+            {
+#ifdef USE_FIXED_POINT
+                v += 0.5f;
+#endif
+                v += ROUNDOFF;
+                return v <= 0.0f ? 0 : v >= 255.0f ? 255 : static_cast<uint8_t>(v);
+            }
+        }
+
+        FftConvolutionFilter::FftConvolutionFilter(const std::vector<float> &k, int size, int fftSize)
+            : kernelSize(std::max(size, 1)), kernelRadius(kernelSize / 2)
+        {
+            if (fftSize <= 0)
+            {
+                fftSize = planConvolution(kernelSize, false).fftSize;
+            }
+            plan = fft::Plan(std::max(fftSize, kernelSize));
+            int n = plan.size();
+            blockRows = n - kernelSize + 1;
+
+            // Kernel at [0, K) x [0, K). Correlating with it is multiplying
+            // by the conjugate of its spectrum; the inverse transform's
+            // 1/N^2 is folded in too.
+            std::vector<float> re(static_cast<size_t>(n) * n, 0.0f);
+            std::vector<float> im(static_cast<size_t>(n) * n, 0.0f);
+            for (int i = 0; i < kernelSize; i++)
+            {
+                for (int j = 0; j < kernelSize; j++)
+                {
+                    size_t index = static_cast<size_t>(i) * kernelSize + j;
+                    float tap = index < k.size() ? k[index] : 0.0f;
+#ifdef USE_FIXED_POINT
+                    // The direct path's Q7.8 taps
+                    tap = static_cast<float>(TAP_WEIGHT(TO_TAP(tap))) / FP_SCALE;
+#endif
+                    re[static_cast<size_t>(i) * n + j] = tap;
+                }
+            }
+            plan.transform2D(re.data(), im.data(), false);
+
+            float scale = 1.0f / (float(n) * n);
+            spectrumRe.resize(re.size());
+            spectrumIm.resize(im.size());
+            for (size_t i = 0; i < re.size(); i++)
+            {
+                spectrumRe[i] = re[i] * scale;
+                spectrumIm[i] = -im[i] * scale;
+            }
+
+            LOG_INFO("FFT convolution " << kernelSize << "x" << kernelSize << ": " << n << "-point tiles, "
+                                        << blockRows << " output rows each");
+        }
+
+        void FftConvolutionFilter::apply(pixel *input, pixel *output, int width, int height)
+        {
+#ifdef DEBUG
+            std::cout << "[FFT] Applying " << kernelSize << "x" << kernelSize << " kernel with "
+                      << plan.size() << "-point tiles\n";
+#endif
+
+            applyRows(input, output, width, height);
+        }
+
+        int FftConvolutionFilter::getMultiplierCount() const
+        {
+            // Four real multiplies per butterfly and per spectrum product,
+            // two planes per transform
+            int n = plan.size();
+            long multiplies = 8L * n * n * log2Of(n) + 4L * n * n;
+            long outputs = 2L * blockRows * blockRows;
+            return static_cast<int>((multiplies + outputs - 1) / outputs);
+        }
+
+        void FftConvolutionFilter::filterBlock(const RowBand &band, int first, int last, pixel *out)
+        {
+            filterTiles(band, first, last, out);
+        }
+
+        void FftConvolutionFilter::filterBlock(const GrayRowBand &band, int first, int last, uint8_t *out)
+        {
+            filterTiles(band, first, last, out);
+        }
+
+        template <typename T>
+        void FftConvolutionFilter::filterTiles(const BasicRowBand<T> &band, int first, int last, T *out)
+        {
+            const int step = sizeof(T);
+            const int n = plan.size();
+            const int tile = blockRows;
+            int width = band.width;
+            int height = band.height;
+            bool padded = band.padded();
+            int count = last - first;
+            int inputRows = std::min(n, count + kernelSize - 1);
+
+            thread_local std::vector<float> bufferRe, bufferIm;
+            size_t samples = static_cast<size_t>(n) * n;
+            if (bufferRe.size() < samples)
+            {
+                bufferRe.resize(samples);
+                bufferIm.resize(samples);
+            }
+            float *re = bufferRe.data();
+            float *im = bufferIm.data();
+
+            // Plane q is channel q % step of tile column q / step. Its input
+            // reaches kernelRadius past the tile on every side; samples
+            // beyond the apron (padded) are zero, COPY bands repeat the edge.
+            auto load = [&](int q, float *plane) {
+                int x0 = (q / step) * tile - kernelRadius;
+                int c = q % step;
+                int columns = std::min(n, tile + kernelSize - 1);
+                for (int i = 0; i < inputRows; i++)
+                {
+                    const uint8_t *row = reinterpret_cast<const uint8_t *>(band.inputRow(first - kernelRadius + i));
+                    float *dst = plane + static_cast<size_t>(i) * n;
+                    for (int j = 0; j < columns; j++)
+                    {
+                        int x = x0 + j;
+                        if (padded)
+                        {
+                            dst[j] = x < width + kernelRadius ? row[x * step + c] : 0.0f;
+                        }
+                        else
+                        {
+                            dst[j] = row[std::min(std::max(x, 0), width - 1) * step + c];
+                        }
+                    }
+                    std::fill(dst + columns, dst + n, 0.0f);
+                }
+                std::fill(plane + static_cast<size_t>(inputRows) * n, plane + samples, 0.0f);
+            };
+
+            auto store = [&](int q, const float *plane) {
+                int x0 = (q / step) * tile;
+                int c = q % step;
+                int columns = std::min(tile, width - x0);
+                uint8_t *dst = reinterpret_cast<uint8_t *>(out);
+                for (int i = 0; i < count; i++)
+                {
+                    const float *src = plane + static_cast<size_t>(i) * n;
+                    uint8_t *line = dst + (static_cast<size_t>(i) * width + x0) * step + c;
+                    for (int j = 0; j < columns; j++)
+                    {
+                        line[j * step] = toPixel(src[j]);
+                    }
+                }
+            };
+
+            // The kernel is real, so a pair of planes packed as real and
+            // imaginary parts comes back as the pair of results
+            int planes = (width + tile - 1) / tile * step;
+            for (int q = 0; q < planes; q += 2)
+            {
+                load(q, re);
+                if (q + 1 < planes)
+                {
+                    load(q + 1, im);
+                }
+                else
+                {
+                    std::fill(im, im + samples, 0.0f);
+                }
+
+                plan.transform2D(re, im, false);
+                for (size_t i = 0; i < samples; i++)
+                {
+                    float a = re[i];
+                    float b = im[i];
+                    re[i] = a * spectrumRe[i] - b * spectrumIm[i];
+                    im[i] = a * spectrumIm[i] + b * spectrumRe[i];
+                }
+                plan.transform2D(re, im, true);
+
+                store(q, re);
+                if (q + 1 < planes)
+                {
+                    store(q + 1, im);
+                }
+            }
+
+            if (!padded)
+            {
+                for (int y = first; y < last; y++)
+                {
+                    const T *center = band.inputRow(y);
+                    T *row = out + static_cast<size_t>(y - first) * width;
+                    if (y < kernelRadius || y >= height - kernelRadius)
+                    {
+                        memcpy(row, center, width * sizeof(T));
+                    }
+                    else
+                    {
+                        copyEdgeColumns(center, row, width, kernelRadius);
+                    }
+                }
+            }
+        }
+
+        ConvolutionPlan planConvolution(int kernelSize, bool separable, int width, int height)
+        {
+            ConvolutionPlan best = {ConvolutionPath::DIRECT, 0, float(kernelSize) * kernelSize};
+            if (separable && 2.0f * kernelSize * SEPARABLE_TAP_COST < best.cost)
+            {
+                best = {ConvolutionPath::SEPARABLE, 0, 2.0f * kernelSize * SEPARABLE_TAP_COST};
+            }
+
+            for (int n = fft::nextPowerOfTwo(kernelSize + 1); n <= MAX_FFT_SIZE; n *= 2)
+            {
+                float cost = fftCost(n, kernelSize, width, height);
+                if (cost < best.cost)
+                {
+                    best = {ConvolutionPath::FFT, n, cost};
+                }
+            }
+            return best;
+        }
+
+        BaseFilter *createConvolution(const std::vector<float> &kernel, int size, int width, int height)
+        {
+            ConvolutionFilter *direct = new ConvolutionFilter(kernel, size);
+            ConvolutionPlan plan = planConvolution(size, direct->isSeparable(), width, height);
+            if (plan.path != ConvolutionPath::FFT)
+            {
+                return direct;
+            }
+
+            delete direct;
+            return new FftConvolutionFilter(kernel, size, plan.fftSize);
+        }
+
+        std::vector<float> unsharpMaskKernel(float sigma, float amount, int &size)
+        {
+            int radius = static_cast<int>(std::ceil(3.0f * sigma));
+            size = 2 * radius + 1;
+
+            std::vector<float> gaussian(size);
+            float sum = 0.0f;
+            for (int x = -radius; x <= radius; x++)
+            {
+                gaussian[x + radius] = std::exp(-(x * x) / (2 * sigma * sigma));
+                sum += gaussian[x + radius];
+            }
+
+            // (1 + amount) * delta - amount * G
+            std::vector<float> kernel(static_cast<size_t>(size) * size);
+            for (int i = 0; i < size; i++)
+            {
+                for (int j = 0; j < size; j++)
+                {
+                    kernel[static_cast<size_t>(i) * size + j] = -amount * gaussian[i] * gaussian[j] / (sum * sum);
+                }
+            }
+            kernel[static_cast<size_t>(radius) * size + radius] += 1.0f + amount;
+            return kernel;
+        }
+    }
+}
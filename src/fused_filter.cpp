@@ -0,0 +1,143 @@
+#include "fused_filter.h"
+#include "config.h"
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace
+        {
+            // Ring and window storage per nesting level: a fused filter may be
+            // the first part of another one, so each level needs its own. A
+            // deque keeps outer levels in place while inner ones are added.
+            template <typename T>
+            struct FusionScratch
+            {
+                std::vector<T> ring;
+                std::vector<int> tags;              // Intermediate row held by each ring slot
+                std::vector<const T *> window;
+            };
+
+            template <typename T>
+            struct ScratchLevel
+            {
+                static thread_local std::deque<FusionScratch<T>> levels;
+                static thread_local size_t depth;
+
+                FusionScratch<T> &scratch;
+
+                ScratchLevel() : scratch(acquire()) {}
+                ~ScratchLevel() { depth--; }
+
+                static FusionScratch<T> &acquire()
+                {
+                    if (levels.size() <= depth)
+                        levels.resize(depth + 1);
+                    return levels[depth++];
+                }
+            };
+
+            template <typename T>
+            thread_local std::deque<FusionScratch<T>> ScratchLevel<T>::levels;
+            template <typename T>
+            thread_local size_t ScratchLevel<T>::depth = 0;
+        }
+
+        FusedFilter::FusedFilter(BaseFilter *firstStage, BaseFilter *secondStage)
+            : first(firstStage), second(secondStage),
+              name(std::string(firstStage->getName()) + "+" + secondStage->getName())
+        {
+            LOG_INFO("Fused stage created (radius " << getRadius() << ")");
+        }
+
+        void FusedFilter::apply(pixel *input, pixel *output, int width, int height)
+        {
+            applyRows(input, output, width, height);
+        }
+
+        void FusedFilter::processRows(const RowBand &band)
+        {
+            processBand(band);
+        }
+
+        void FusedFilter::processRows(const GrayRowBand &band)
+        {
+            processBand(band);
+        }
+
+        template <typename T>
+        void FusedFilter::processBand(const BasicRowBand<T> &band)
+        {
+            int width = band.width;
+            int height = band.height;
+            int firstRadius = first->getRadius();
+            int secondRadius = second->getRadius();
+            int lines = 2 * secondRadius + 1;
+
+            // Padded bands: ring lines carry the second stage's column apron,
+            // and one extra line holds the constant border row
+            bool padded = band.padded();
+            int apron = padded ? secondRadius : 0;
+            int pitch = width + 2 * apron;
+
+            ScratchLevel<T> level;
+            FusionScratch<T> &scratch = level.scratch;
+            if (scratch.ring.size() < static_cast<size_t>(lines + 1) * pitch)
+                scratch.ring.resize(static_cast<size_t>(lines + 1) * pitch);
+            scratch.tags.assign(lines, -1);
+            scratch.window.resize(lines);
+
+            T *constantLine = scratch.ring.data() + static_cast<size_t>(lines) * pitch + apron;
+            if (band.border == BorderMode::CONSTANT)
+            {
+                T fill = borderSample<T>(band.borderConstant);
+                std::fill(constantLine - apron, constantLine - apron + pitch, fill);
+            }
+
+            // Input rows are addressed relative to the band's own halo
+            int inputBase = band.y0 - band.radius;
+
+            for (int y = band.y0; y < band.y1; y++)
+            {
+                for (int k = 0; k < lines; k++)
+                {
+                    // Intermediate rows outside the frame map as the second
+                    // stage would see them in a full frame: clamped to the
+                    // edge, or through the band's border mode
+                    int row = padded ? borderIndex(band.border, y - secondRadius + k, height)
+                                     : std::min(std::max(y - secondRadius + k, 0), height - 1);
+                    if (row < 0)
+                    {
+                        scratch.window[k] = constantLine;
+                        continue;
+                    }
+
+                    int slot = row % lines;
+                    T *line = scratch.ring.data() + static_cast<size_t>(slot) * pitch + apron;
+
+                    if (scratch.tags[slot] != row)
+                    {
+                        BasicRowBand<T> rowBand = {band.rows + (row - firstRadius - inputBase), line, width,
+                                                   row, row + 1, width, height, firstRadius, band.border,
+                                                   band.borderConstant};
+                        first->processRows(rowBand);
+                        if (padded)
+                        {
+                            fillRowApron(line, width, apron, band.border, band.borderConstant);
+                        }
+                        scratch.tags[slot] = row;
+                    }
+                    scratch.window[k] = line;
+                }
+
+                BasicRowBand<T> outBand = {scratch.window.data(), band.outputRow(y), band.outputStride,
+                                           y, y + 1, width, height, secondRadius, band.border,
+                                           band.borderConstant};
+                second->processRows(outBand);
+            }
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include "hw_model.h"
+
+#ifdef HW_SIMULATION
+
+#include <algorithm>
+#include <cmath>
+
+namespace hardware
+{
+    namespace simulation
+    {
+        namespace
+        {
+            // 18 Kbit block RAM in its 2K x 9 configuration: 2048 8-bit samples
+            constexpr int BRAM18_BYTES = 2048;
+
+            long long ceilDiv(double value)
+            {
+                return static_cast<long long>(std::ceil(value));
+            }
+        }
+
+        FrameEstimate estimateFrame(const std::vector<StageDescription> &stages, int width, int height,
+                                    int sourceBytesPerPixel, const HardwareParams &params)
+        {
+            FrameEstimate estimate = {};
+            estimate.width = width;
+            estimate.height = height;
+            if (width <= 0 || height <= 0)
+                return estimate;
+
+            // Frame transfers share one memory port, limited by the slower
+            // of the bus and the memory itself
+            double bytesPerCycle = std::min(params.memoryMBps / params.clockMHz, params.busBits / 8.0);
+            int resultBytesPerPixel = stages.empty() ? sourceBytesPerPixel : stages.back().bytesPerPixel;
+            long long readRow = ceilDiv(static_cast<double>(width) * sourceBytesPerPixel / bytesPerCycle);
+            long long writeRow = ceilDiv(static_cast<double>(width) * resultBytesPerPixel / bytesPerCycle);
+            long long computeRow = static_cast<long long>(width) * params.cyclesPerPixel;
+
+            // With back-pressure every stage settles at the slowest rate
+            long long rowInterval = std::max(readRow + writeRow, computeRow);
+            estimate.readCycles = readRow * height;
+            estimate.writeCycles = writeRow * height;
+            estimate.frameCycles = rowInterval * height;
+            estimate.framesPerSecond = params.clockMHz * 1e6 / estimate.frameCycles;
+            estimate.bottleneck = (readRow + writeRow > computeRow) ? "memory" : "datapath";
+
+            // Row completion times, starting with source rows arriving at
+            // the sustained rate (time 0 = first source pixel)
+            std::vector<long long> produced(height);
+            std::vector<long long> consumed(height);
+            for (int y = 0; y < height; y++)
+            {
+                produced[y] = (y + 1) * rowInterval;
+            }
+
+            for (const StageDescription &stage : stages)
+            {
+                StageEstimate result = {};
+                result.name = stage.name;
+                result.busyCycles = computeRow * height;
+
+                // Output pixel (y, x) needs input (y + r, x + r): the stage
+                // trails its producer by r pixels plus its register stages
+                long long trail = static_cast<long long>(stage.radius) * params.cyclesPerPixel + params.pipelineDepth;
+                result.fillCycles = (static_cast<long long>(stage.radius) * width + stage.radius) * params.cyclesPerPixel +
+                                    params.pipelineDepth;
+                estimate.fillCycles += result.fillCycles;
+
+                for (int y = 0; y < height; y++)
+                {
+                    long long ready = produced[std::min(y + stage.radius, height - 1)] + trail;
+                    consumed[y] = (y == 0) ? ready : std::max(ready, consumed[y - 1] + computeRow);
+                }
+
+                // Input row i can be dropped once output row i + r is done.
+                // Peak number of rows held, sampled as each input row lands:
+                int finished = 0;
+                int peak = 0;
+                for (int j = 0; j < height; j++)
+                {
+                    while (finished < height && consumed[finished] <= produced[j])
+                        finished++;
+                    int retired = (finished == height) ? height : std::max(0, finished - stage.radius);
+                    peak = std::max(peak, j + 1 - retired);
+                }
+
+                result.lineBufferRows = 2 * stage.radius;
+                result.fifoRows = std::max(0, peak - (2 * stage.radius + 1));
+
+                long long rowBytes = static_cast<long long>(width) * stage.bytesPerPixel;
+                int blocksPerRow = static_cast<int>((rowBytes + BRAM18_BYTES - 1) / BRAM18_BYTES);
+                result.bram18 = (result.lineBufferRows + result.fifoRows) * blocksPerRow;
+                result.dsp = static_cast<int>(ceilDiv(static_cast<double>(stage.multipliers) * stage.bytesPerPixel /
+                                                      params.cyclesPerPixel));
+
+                estimate.bram18 += result.bram18;
+                estimate.dsp += result.dsp;
+                estimate.stages.push_back(result);
+                produced.swap(consumed);
+            }
+
+            // Result rows stream out through the write side of the memory port
+            long long written = 0;
+            for (int y = 0; y < height; y++)
+            {
+                written = std::max(produced[y], written + writeRow);
+            }
+            estimate.latencyCycles = written;
+
+            return estimate;
+        }
+    }
+}
+
+#endif // HW_SIMULATION
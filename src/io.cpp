@@ -1,90 +1,1237 @@
 #include <iostream>
-#include <fstream>
 #include "io.h"
+#include "thread_pool.h"
+#include "config.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 namespace hardware
 {
     namespace pipeline
     {
         using namespace std;
+        using hardware::memory::FrameBuffer;
+
+        static_assert(sizeof(pixel) == 3, "P6 zero-copy loading requires packed RGB pixels");
+
+        namespace
+        {
+            struct PnmHeader
+            {
+                char kind; // '3', '5' or '6'
+                int width;
+                int height;
+                int maxVal;
+                size_t dataOffset;
+            };
+
+            // Skip whitespace and '#' comments between header fields
+            size_t skipSeparators(const char *data, size_t size, size_t pos)
+            {
+                while (pos < size)
+                {
+                    if (data[pos] == '#')
+                    {
+                        while (pos < size && data[pos] != '\n')
+                            pos++;
+                    }
+                    else if (isspace(static_cast<unsigned char>(data[pos])))
+                    {
+                        pos++;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+                return pos;
+            }
+
+            bool readHeaderInt(const char *data, size_t size, size_t &pos, int &value)
+            {
+                pos = skipSeparators(data, size, pos);
+                if (pos >= size || !isdigit(static_cast<unsigned char>(data[pos])))
+                    return false;
+
+                value = 0;
+                while (pos < size && isdigit(static_cast<unsigned char>(data[pos])))
+                {
+                    value = value * 10 + (data[pos] - '0');
+                    if (value > (1 << 24))
+                        return false;
+                    pos++;
+                }
+                return true;
+            }
+
+            bool parsePnmHeader(const char *data, size_t size, PnmHeader &header)
+            {
+                if (size < 2 || data[0] != 'P')
+                    return false;
+
+                header.kind = data[1];
+                size_t pos = 2;
+                if (!readHeaderInt(data, size, pos, header.width) ||
+                    !readHeaderInt(data, size, pos, header.height) ||
+                    !readHeaderInt(data, size, pos, header.maxVal))
+                    return false;
+
+                // Exactly one whitespace byte separates the header from binary data
+                if (pos >= size || !isspace(static_cast<unsigned char>(data[pos])))
+                    return false;
+
+                header.dataOffset = pos + 1;
+                return header.width > 0 && header.height > 0;
+            }
+
+            // Decoded frames come from the pool when one is supplied
+            FrameBuffer newFrame(int width, int height, hardware::memory::BufferPool *pool)
+            {
+                if (pool)
+                    return FrameBuffer(width, height, *pool);
+                return FrameBuffer(width, height);
+            }
+
+            // Issue the gathered write, resuming after short writes
+            bool writeFully(int fd, struct iovec *iov, int count)
+            {
+                while (count > 0)
+                {
+                    ssize_t written = writev(fd, iov, count);
+                    if (written < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        return false;
+                    }
+
+                    size_t remaining = static_cast<size_t>(written);
+                    while (count > 0 && remaining >= iov->iov_len)
+                    {
+                        remaining -= iov->iov_len;
+                        iov++;
+                        count--;
+                    }
+                    if (count > 0)
+                    {
+                        iov->iov_base = static_cast<char *>(iov->iov_base) + remaining;
+                        iov->iov_len -= remaining;
+                    }
+                }
+                return true;
+            }
+
+            // Header and payload go out in a single gathered write
+            bool writeBinaryImage(const char *filename, const char *magic, int width, int height,
+                                  const void *payload, size_t bytes)
+            {
+                char header[64];
+                int headerLength = snprintf(header, sizeof(header), "%s\n%d %d\n255\n", magic, width, height);
+
+                struct iovec iov[2];
+                iov[0].iov_base = header;
+                iov[0].iov_len = static_cast<size_t>(headerLength);
+                iov[1].iov_base = const_cast<void *>(payload);
+                iov[1].iov_len = bytes;
+
+                int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0)
+                {
+                    cerr << "Error: could not write to file " << filename << endl;
+                    return false;
+                }
+
+                bool ok = writeFully(fd, iov, 2);
+                if (close(fd) != 0)
+                    ok = false;
+
+                if (!ok)
+                {
+                    cerr << "Error: Failed to write to file " << filename << endl;
+                    return false;
+                }
+
+                return true;
+            }
+
+            // P3 payloads are split into chunks of at least this many bytes
+            // and decoded in parallel
+            constexpr size_t ASCII_CHUNK_BYTES = 1 << 20;
+            constexpr int MAX_DECODE_THREADS = 8;
+
+            // Character classes of a P3 payload
+            enum : uint8_t
+            {
+                CHAR_OTHER,
+                CHAR_DIGIT,
+                CHAR_SPACE,
+                CHAR_COMMENT
+            };
+
+            struct AsciiClasses
+            {
+                uint8_t of[256];
+
+                AsciiClasses()
+                {
+                    for (int c = 0; c < 256; c++)
+                    {
+                        of[c] = isdigit(c) ? CHAR_DIGIT : isspace(c) ? CHAR_SPACE : c == '#' ? CHAR_COMMENT : CHAR_OTHER;
+                    }
+                }
+            };
+
+            const AsciiClasses &asciiClasses()
+            {
+                static const AsciiClasses classes;
+                return classes;
+            }
+
+            // Decimal samples of [p, end): every one is stored to out[n] while
+            // n < capacity (out may be null to only count) and `count` gets
+            // the number found. '#' comments run to the end of their line.
+            // Fails on any other character or on a value above maxVal.
+            bool scanAsciiSamples(const char *p, const char *end, uint8_t *out, size_t capacity, int maxVal,
+                                  size_t &count)
+            {
+                const AsciiClasses &classes = asciiClasses();
+                size_t n = 0;
+                while (p < end)
+                {
+                    uint8_t kind = classes.of[static_cast<unsigned char>(*p)];
+                    if (kind == CHAR_SPACE)
+                    {
+                        p++;
+                    }
+                    else if (kind == CHAR_DIGIT)
+                    {
+                        int value = 0;
+                        do
+                        {
+                            value = value * 10 + (*p++ - '0');
+                            if (value > maxVal)
+                                return false;
+                        } while (p < end && classes.of[static_cast<unsigned char>(*p)] == CHAR_DIGIT);
+
+                        if (out && n < capacity)
+                            out[n] = static_cast<uint8_t>(value);
+                        n++;
+                    }
+                    else if (kind == CHAR_COMMENT)
+                    {
+                        const void *eol = memchr(p, '\n', end - p);
+                        p = eol ? static_cast<const char *>(eol) : end;
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+                count = n;
+                return true;
+            }
+
+            // Frames hold samples at maxval 255, which every writer emits:
+            // samples of a file with a smaller maxval are rescaled to it
+            // (rounded to nearest). Binary values above maxval saturate.
+            void rescaleSamples(uint8_t *samples, size_t count, int maxVal)
+            {
+                if (maxVal == 255)
+                    return;
+
+                uint8_t scaled[256];
+                for (int v = 0; v < 256; v++)
+                {
+                    scaled[v] = static_cast<uint8_t>(v >= maxVal ? 255 : (v * 255 + maxVal / 2) / maxVal);
+                }
+                for (size_t i = 0; i < count; i++)
+                {
+                    samples[i] = scaled[samples[i]];
+                }
+            }
+
+            // Shared by every P3 decode; a decode that finds it busy (batch
+            // I/O threads) runs on its own thread instead
+            ThreadPool *decodePool(std::unique_lock<std::mutex> &lock)
+            {
+                static std::mutex mutex;
+                static std::unique_ptr<ThreadPool> pool;
+
+                lock = std::unique_lock<std::mutex>(mutex, std::try_to_lock);
+                if (!lock.owns_lock())
+                    return nullptr;
+                if (!pool)
+                {
+                    int threads = static_cast<int>(std::thread::hardware_concurrency());
+                    pool.reset(new ThreadPool(std::min(std::max(threads, 1), MAX_DECODE_THREADS)));
+                }
+                return pool.get();
+            }
+
+            // Decode `samples` values from a mapped P3 payload. Chunks end
+            // just after a line break, so none starts inside a comment or
+            // a number: each is counted in parallel, the counts give every
+            // chunk's first sample, then each is decoded in parallel.
+            bool decodeAscii(const char *data, size_t size, uint8_t *out, size_t samples, int maxVal)
+            {
+                int chunks = static_cast<int>(std::min<size_t>(size / ASCII_CHUNK_BYTES + 1, 64));
+                std::unique_lock<std::mutex> lock;
+                ThreadPool *pool = chunks > 1 ? decodePool(lock) : nullptr;
+                if (!pool || pool->getThreadCount() == 1)
+                {
+                    size_t count = 0;
+                    return scanAsciiSamples(data, data + size, out, samples, maxVal, count) && count >= samples;
+                }
+
+                std::vector<size_t> bounds(chunks + 1, size);
+                bounds[0] = 0;
+                for (int i = 1; i < chunks; i++)
+                {
+                    size_t target = std::max(bounds[i - 1], size / chunks * i);
+                    const void *eol = memchr(data + target, '\n', size - target);
+                    bounds[i] = eol ? static_cast<const char *>(eol) - data + 1 : size;
+                }
+
+                std::vector<size_t> counts(chunks, 0);
+                std::vector<char> valid(chunks, 0);
+                pool->parallelFor(chunks, [&](int i) {
+                    valid[i] = scanAsciiSamples(data + bounds[i], data + bounds[i + 1], nullptr, 0, maxVal, counts[i]);
+                });
+
+                std::vector<size_t> first(chunks, 0);
+                size_t total = 0;
+                for (int i = 0; i < chunks; i++)
+                {
+                    if (!valid[i])
+                        return false;
+                    first[i] = total;
+                    total += counts[i];
+                }
+                if (total < samples)
+                    return false;
+
+                pool->parallelFor(chunks, [&](int i) {
+                    if (first[i] < samples)
+                    {
+                        size_t count = 0;
+                        scanAsciiSamples(data + bounds[i], data + bounds[i + 1], out + first[i], samples - first[i],
+                                         maxVal, count);
+                    }
+                });
+                return true;
+            }
+
+            // "0".."255" once, each padded to four bytes so a whole entry can
+            // be copied and the cursor advanced by its length
+            struct DecimalTable
+            {
+                char text[256][4];
+                uint8_t length[256];
+
+                DecimalTable()
+                {
+                    for (int v = 0; v < 256; v++)
+                    {
+                        length[v] = static_cast<uint8_t>(snprintf(text[v], sizeof(text[v]), "%d", v));
+                    }
+                }
+            };
+
+            bool writeAll(int fd, const char *data, size_t bytes)
+            {
+                struct iovec iov;
+                iov.iov_base = const_cast<char *>(data);
+                iov.iov_len = bytes;
+                return writeFully(fd, &iov, 1);
+            }
+
+            const DecimalTable &decimalTable()
+            {
+                static const DecimalTable table;
+                return table;
+            }
+
+            // P3 text of `count` pixels, one "r g b" line each; gray samples
+            // (`channels` 1) are repeated three times. Writes up to
+            // ASCII_PIXEL_BYTES per pixel plus three bytes of slack.
+            constexpr size_t ASCII_PIXEL_BYTES = 12;
+
+            char *formatAscii(char *p, const uint8_t *samples, int count, int channels)
+            {
+                const DecimalTable &decimal = decimalTable();
+                for (int i = 0; i < count; i++)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        uint8_t v = samples[i * channels + (channels == 3 ? c : 0)];
+                        memcpy(p, decimal.text[v], 4);
+                        p += decimal.length[v];
+                        *p++ = (c == 2) ? '\n' : ' ';
+                    }
+                }
+                return p;
+            }
+
+            // Formats coded row by row (P3, QOI) are written through a RowWriter
+            template <typename T>
+            bool writeRowImage(const char *filename, ImageFormat format, const T *rows, int width, int height)
+            {
+                RowWriter writer;
+                if (!writer.open(filename, format, width, height))
+                    return false;
+
+                for (int y = 0; y < height; y++)
+                {
+                    if (!writer.writeRow(rows + static_cast<size_t>(y) * width))
+                        break;
+                }
+                return writer.close();
+            }
+
+            // Row I/O buffers: bounded, independent of the frame size
+            constexpr size_t READ_BUFFER_BYTES = 1 << 16;
+            constexpr size_t WRITE_BUFFER_BYTES = 1 << 18;
+
+            bool isQoiFormat(ImageFormat format)
+            {
+                return format == ImageFormat::QOI || format == ImageFormat::QOI_GRAY;
+            }
+
+            bool isTiledFormat(ImageFormat format)
+            {
+                return format == ImageFormat::TILED || format == ImageFormat::TILED_GRAY;
+            }
+
+            // A whole tiled image gathered into a new frame
+            bool loadTiledImage(const char *filename, ImageFormat &format, FrameBuffer &frame,
+                                hardware::memory::BufferPool *pool)
+            {
+                TiledImage tiled;
+                if (!tiled.open(filename))
+                    return false;
+
+                format = tiled.getChannels() == 1 ? ImageFormat::TILED_GRAY : ImageFormat::TILED;
+                frame = newFrame(tiled.getWidth(), tiled.getHeight(), pool);
+                tiled.readRegion(0, 0, tiled.getWidth(), tiled.getHeight(), frame.getData(), tiled.getWidth());
+                return true;
+            }
+
+            // Whole QOI file, decoded row by row into a new frame
+            bool decodeQoiImage(const uint8_t *data, size_t size, ImageFormat &format, FrameBuffer &frame,
+                                hardware::memory::BufferPool *pool, const char *filename)
+            {
+                int width, height, channels;
+                if (!qoi::parseHeader(data, size, width, height, channels))
+                {
+                    cerr << "Error: Malformed or unsupported QOI header in " << filename << endl;
+                    return false;
+                }
+
+                format = channels == 1 ? ImageFormat::QOI_GRAY : ImageFormat::QOI;
+                frame = newFrame(width, height, pool);
+                qoi::Decoder decoder(channels);
+                const uint8_t *p = data + qoi::HEADER_BYTES;
+                for (int y = 0; y < height && p; y++)
+                {
+                    p = decoder.decode(p, data + size, frame.getData() + static_cast<size_t>(y) * width, width);
+                }
+                if (!p)
+                {
+                    cerr << "Error: Truncated or malformed QOI data in " << filename << endl;
+                    frame.reset();
+                    return false;
+                }
+                return true;
+            }
+        }
+
+        ImageFormat formatForPath(const char *filename, ImageFormat input, bool grayResult)
+        {
+            const char *dot = strrchr(filename, '.');
+            if (!dot || strchr(dot, '/'))
+                return input;
+
+            string extension(dot + 1);
+            for (char &c : extension)
+                c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+
+            bool gray = input == ImageFormat::P5 || input == ImageFormat::QOI_GRAY || input == ImageFormat::TILED_GRAY;
+            if (extension == "qoi")
+                return gray || grayResult ? ImageFormat::QOI_GRAY : ImageFormat::QOI;
+            if (extension == "tiles")
+                return gray || grayResult ? ImageFormat::TILED_GRAY : ImageFormat::TILED;
+            bool netpbm = input == ImageFormat::P3 || input == ImageFormat::P5 || input == ImageFormat::P6;
+            if (!netpbm && (extension == "ppm" || extension == "pgm" || extension == "pnm"))
+                return extension == "pgm" || (extension == "pnm" && gray) ? ImageFormat::P5 : ImageFormat::P6;
+            return input;
+        }
 
         // FrameReader implementation (same as before)
         pixel *FrameReader::loadImage(const char *filename, int &width, int &height)
         {
-            std::cout << "[DEBUG] Loading image: " << filename << "\n";
+            LOG_VERBOSE("Loading image: " << filename);
 
-            std::ifstream file(filename);
-            if (!file.is_open())
+            // Every format goes through the mapped loader
+            ImageFormat format;
+            FrameBuffer *frame = mapImage(filename, format);
+            if (!frame)
+                return nullptr;
+
+            width = frame->getWidth();
+            height = frame->getHeight();
+            pixel *buffer = new pixel[width * height];
+            frame->copyTo(buffer);
+            delete frame;
+
+            LOG_VERBOSE("Image loaded successfully");
+            return buffer;
+        }
+
+        FrameBuffer *FrameReader::mapImage(const char *filename, ImageFormat &format,
+                                          hardware::memory::BufferPool *pool)
+        {
+            FrameBuffer *frame = new FrameBuffer();
+            if (!mapImage(filename, format, *frame, pool))
             {
-                std::cerr << "[ERROR] Could not open file " << filename << std::endl;
+                delete frame;
                 return nullptr;
             }
+            return frame;
+        }
 
-            string magic;
-            file >> magic;
-            if (magic != "P3")
+        bool FrameReader::mapImage(const char *filename, ImageFormat &format, FrameBuffer &frame,
+                                   hardware::memory::BufferPool *pool)
+        {
+            LOG_VERBOSE("Mapping image: " << filename);
+
+            if (isTiledImage(filename))
             {
-                cerr << "Error: Unsupported format (" << magic << "). Expected P3." << endl;
-                return nullptr;
+                if (!loadTiledImage(filename, format, frame, pool))
+                    return false;
+                LOG_VERBOSE("Image loaded successfully");
+                return true;
+            }
+
+            int fd = open(filename, O_RDONLY);
+            if (fd < 0)
+            {
+                std::cerr << "[ERROR] Could not open file " << filename << std::endl;
+                return false;
             }
 
-            int maxVal;
-            file >> width >> height >> maxVal;
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size <= 0)
+            {
+                std::cerr << "[ERROR] Could not stat file " << filename << std::endl;
+                close(fd);
+                return false;
+            }
 
-            // Allocate memory for the image buffer
-            pixel *buffer = new pixel[width * height];
+            size_t length = static_cast<size_t>(info.st_size);
 
-            for (int i = 0; i < width * height; i++)
+            // Private writable mapping: stages may modify the frame in place
+            // without touching the file (pages are copied on first write only)
+            void *region = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (region == MAP_FAILED)
             {
-                int r, g, b;
-                file >> r >> g >> b;
-                buffer[i].r = static_cast<uint8_t>(r);
-                buffer[i].g = static_cast<uint8_t>(g);
-                buffer[i].b = static_cast<uint8_t>(b);
+                std::cerr << "[ERROR] Could not map file " << filename << std::endl;
+                return false;
             }
 
-            file.close();
-            std::cout << "[DEBUG] Image loaded successfully\n";
-            return buffer;
+            if (qoi::isQoi(static_cast<const uint8_t *>(region), length))
+            {
+                madvise(region, length, MADV_SEQUENTIAL);
+                bool decoded = decodeQoiImage(static_cast<const uint8_t *>(region), length, format, frame, pool, filename);
+                munmap(region, length);
+                if (decoded)
+                {
+                    LOG_VERBOSE("Image loaded successfully");
+                }
+                return decoded;
+            }
+
+            const char *data = static_cast<const char *>(region);
+            PnmHeader header;
+            if (!parsePnmHeader(data, length, header))
+            {
+                cerr << "Error: Malformed or unsupported image header in " << filename << endl;
+                munmap(region, length);
+                return false;
+            }
+
+            if (header.kind != '3' && header.kind != '5' && header.kind != '6')
+            {
+                cerr << "Error: Unsupported format (P" << header.kind << "). Expected P3, P5 or P6." << endl;
+                munmap(region, length);
+                return false;
+            }
+
+            if (header.maxVal <= 0 || header.maxVal > 255)
+            {
+                cerr << "Error: Unsupported maxval " << header.maxVal << " (only 8-bit samples)" << endl;
+                munmap(region, length);
+                return false;
+            }
+
+            if (header.kind == '3')
+            {
+                // ASCII samples decoded straight from the mapping
+                format = ImageFormat::P3;
+                madvise(region, length, MADV_SEQUENTIAL);
+                frame = newFrame(header.width, header.height, pool);
+                size_t samples = static_cast<size_t>(header.width) * header.height * 3;
+                bool decoded = decodeAscii(data + header.dataOffset, length - header.dataOffset,
+                                           reinterpret_cast<uint8_t *>(frame.getData()), samples, header.maxVal);
+                munmap(region, length);
+                if (!decoded)
+                {
+                    cerr << "Error: Failed to decode P3 image " << filename << endl;
+                    return false;
+                }
+                rescaleSamples(reinterpret_cast<uint8_t *>(frame.getData()), samples, header.maxVal);
+
+                LOG_VERBOSE("Image loaded successfully");
+                return true;
+            }
+
+            size_t channels = (header.kind == '6') ? 3 : 1;
+            size_t payload = static_cast<size_t>(header.width) * header.height * channels;
+            if (header.dataOffset + payload > length)
+            {
+                cerr << "Error: Truncated image data in " << filename << endl;
+                munmap(region, length);
+                return false;
+            }
+
+            unsigned char *samples = reinterpret_cast<unsigned char *>(const_cast<char *>(data) + header.dataOffset);
+            rescaleSamples(samples, payload, header.maxVal);
+
+            if (header.kind == '6')
+            {
+                // RGB triplets match the pixel layout: wrap the payload directly
+                format = ImageFormat::P6;
+                madvise(region, length, MADV_SEQUENTIAL);
+                pixel *payloadPixels = reinterpret_cast<pixel *>(samples);
+                LOG_VERBOSE("Image mapped successfully (zero-copy)");
+                frame = FrameBuffer(payloadPixels, header.width, header.height, region, length);
+                return true;
+            }
+
+            // P5: expand gray samples into RGB pixels
+            format = ImageFormat::P5;
+            frame = newFrame(header.width, header.height, pool);
+            pixel *dst = frame.getData();
+            for (size_t i = 0; i < payload; i++)
+            {
+                dst[i].r = dst[i].g = dst[i].b = samples[i];
+            }
+            munmap(region, length);
+
+            LOG_VERBOSE("Image loaded successfully");
+            return true;
         }
 
         // FrameWriter implementation - NOW RETURNS BOOL
         bool FrameWriter::saveImage(const char *filename, pixel *buffer, int width, int height)
         {
-            ofstream file(filename);
-            if (!file.is_open())
+            return writeRowImage(filename, ImageFormat::P3, buffer, width, height);
+        }
+
+        // Optional overload for std::string
+        bool FrameWriter::saveImage(const std::string &filename, pixel *buffer, int width, int height)
+        {
+            return saveImage(filename.c_str(), buffer, width, height);
+        }
+
+        bool FrameWriter::saveImage(const char *filename, const pixel *buffer, int width, int height, ImageFormat format)
+        {
+            if (format == ImageFormat::P3)
+            {
+                return saveImage(filename, const_cast<pixel *>(buffer), width, height);
+            }
+            if (isQoiFormat(format) || isTiledFormat(format))
+            {
+                return writeRowImage(filename, format, buffer, width, height);
+            }
+
+            size_t count = static_cast<size_t>(width) * height;
+            if (format == ImageFormat::P6)
+            {
+                return writeBinaryImage(filename, "P6", width, height, buffer, count * sizeof(pixel));
+            }
+
+            // Frames are grayscale after conversion: keep one channel.
+            // The staging line is reused so steady-state saves do not allocate.
+            thread_local vector<unsigned char> gray;
+            if (gray.size() < count)
+                gray.resize(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                gray[i] = buffer[i].r;
+            }
+            return writeBinaryImage(filename, "P5", width, height, gray.data(), count);
+        }
+
+        bool FrameWriter::saveImage(const char *filename, const uint8_t *plane, int width, int height, ImageFormat format)
+        {
+            size_t count = static_cast<size_t>(width) * height;
+
+            if (format == ImageFormat::P5)
+            {
+                // The plane already is the P5 payload
+                return writeBinaryImage(filename, "P5", width, height, plane, count);
+            }
+
+            if (format == ImageFormat::P6)
+            {
+                thread_local vector<pixel> rgb;
+                if (rgb.size() < count)
+                    rgb.resize(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    rgb[i].r = rgb[i].g = rgb[i].b = plane[i];
+                }
+                return writeBinaryImage(filename, "P6", width, height, rgb.data(), count * sizeof(pixel));
+            }
+
+            return writeRowImage(filename, format, plane, width, height);
+        }
+
+        RowReader::RowReader()
+            : fd(-1), format(ImageFormat::P3), width(0), height(0), maxVal(0), rowsRead(0),
+              begin(0), end(0), eof(false)
+        {
+        }
+
+        RowReader::~RowReader()
+        {
+            close();
+        }
+
+        bool RowReader::open(const char *filename)
+        {
+            close();
+            path = filename;
+            rowsRead = 0;
+
+            if (isTiledImage(filename))
+            {
+                if (!tiled.open(filename))
+                    return false;
+                format = tiled.getChannels() == 1 ? ImageFormat::TILED_GRAY : ImageFormat::TILED;
+                width = tiled.getWidth();
+                height = tiled.getHeight();
+                maxVal = 255;
+                buffer.resize(width);
+                return true;
+            }
+
+            fd = ::open(filename, O_RDONLY);
+            if (fd < 0)
+            {
+                std::cerr << "[ERROR] Could not open file " << filename << std::endl;
+                return false;
+            }
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            // The header has to fit the first buffer
+            buffer.resize(READ_BUFFER_BYTES);
+            begin = end = 0;
+            eof = false;
+            while (end < buffer.size() && fill())
+            {
+            }
+
+            const uint8_t *head = reinterpret_cast<const uint8_t *>(buffer.data());
+            if (qoi::isQoi(head, end))
+            {
+                int channels;
+                if (!qoi::parseHeader(head, end, width, height, channels))
+                {
+                    cerr << "Error: Malformed or unsupported QOI header in " << filename << endl;
+                    close();
+                    return false;
+                }
+
+                // Room for two rows at the worst case code size
+                size_t rowBytes = qoi::maxCodedBytes(width, 4);
+                if (buffer.size() < 2 * rowBytes)
+                    buffer.resize(2 * rowBytes);
+
+                format = channels == 1 ? ImageFormat::QOI_GRAY : ImageFormat::QOI;
+                decoder.reset(channels);
+                maxVal = 255;
+                rowsRead = 0;
+                begin = qoi::HEADER_BYTES;
+                return true;
+            }
+
+            PnmHeader header;
+            if (!parsePnmHeader(buffer.data(), end, header))
+            {
+                cerr << "Error: Malformed or unsupported image header in " << filename << endl;
+                close();
+                return false;
+            }
+            if (header.kind != '3' && header.kind != '5' && header.kind != '6')
+            {
+                cerr << "Error: Unsupported format (P" << header.kind << "). Expected P3, P5 or P6." << endl;
+                close();
+                return false;
+            }
+            if (header.maxVal <= 0 || header.maxVal > 255)
+            {
+                cerr << "Error: Unsupported maxval " << header.maxVal << " (only 8-bit samples)" << endl;
+                close();
+                return false;
+            }
+
+            format = header.kind == '3' ? ImageFormat::P3 : header.kind == '5' ? ImageFormat::P5 : ImageFormat::P6;
+            width = header.width;
+            height = header.height;
+            maxVal = header.maxVal;
+            rowsRead = 0;
+            begin = header.dataOffset;
+            return true;
+        }
+
+        void RowReader::close()
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+            tiled.close();
+        }
+
+        bool RowReader::fill()
+        {
+            if (eof || fd < 0)
+                return false;
+
+            memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+            while (end < buffer.size())
+            {
+                ssize_t got = read(fd, buffer.data() + end, buffer.size() - end);
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got <= 0)
+                {
+                    eof = true;
+                    return false;
+                }
+                end += static_cast<size_t>(got);
+                return true;
+            }
+            return true;
+        }
+
+        bool RowReader::readSample(int &value)
+        {
+            const AsciiClasses &classes = asciiClasses();
+            for (;;)
+            {
+                if (begin == end && !fill())
+                    return false;
+
+                uint8_t kind = classes.of[static_cast<unsigned char>(buffer[begin])];
+                if (kind == CHAR_SPACE)
+                {
+                    begin++;
+                }
+                else if (kind == CHAR_COMMENT)
+                {
+                    // The comment may run past the buffered bytes: skip up to its newline across refills
+                    for (;;)
+                    {
+                        const void *eol = memchr(buffer.data() + begin, '\n', end - begin);
+                        if (eol)
+                        {
+                            begin = static_cast<const char *>(eol) - buffer.data();
+                            break;
+                        }
+                        begin = end;
+                        if (!fill())
+                            return false;
+                    }
+                }
+                else if (kind == CHAR_DIGIT)
+                {
+                    break;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            // A number may continue past the buffered bytes
+            value = 0;
+            for (;;)
+            {
+                if (begin == end && !fill())
+                    return true;
+                if (classes.of[static_cast<unsigned char>(buffer[begin])] != CHAR_DIGIT)
+                    return classes.of[static_cast<unsigned char>(buffer[begin])] != CHAR_OTHER;
+
+                value = value * 10 + (buffer[begin++] - '0');
+                if (value > maxVal)
+                    return false;
+            }
+        }
+
+        bool RowReader::readRow(pixel *row)
+        {
+            if (tiled.isOpen())
+            {
+                if (rowsRead >= height)
+                    return false;
+
+                if (format == ImageFormat::TILED)
+                {
+                    tiled.readRow(rowsRead, reinterpret_cast<uint8_t *>(row));
+                }
+                else
+                {
+                    uint8_t *samples = reinterpret_cast<uint8_t *>(buffer.data());
+                    tiled.readRow(rowsRead, samples);
+                    for (int x = 0; x < width; x++)
+                    {
+                        row[x].r = row[x].g = row[x].b = samples[x];
+                    }
+                }
+
+                // Each row of tiles is read once, top to bottom
+                rowsRead++;
+                if (rowsRead % tiled.getTileSize() == 0)
+                    tiled.releaseTileRows(rowsRead / tiled.getTileSize() - 1, rowsRead / tiled.getTileSize());
+                return true;
+            }
+
+            if (fd < 0 || rowsRead >= height)
+                return false;
+
+            bool ok = true;
+            if (format == ImageFormat::P3)
+            {
+                // Numbers that end within the buffer are taken inline; a
+                // comment, a refill or bad data goes through readSample()
+                const AsciiClasses &classes = asciiClasses();
+                uint8_t *samples = reinterpret_cast<uint8_t *>(row);
+                for (int i = 0; i < 3 * width && ok; i++)
+                {
+                    const char *p = buffer.data() + begin;
+                    const char *last = buffer.data() + end;
+                    while (p < last && classes.of[static_cast<unsigned char>(*p)] == CHAR_SPACE)
+                        p++;
+
+                    const char *token = p;
+                    int value = 0;
+                    while (p < last && classes.of[static_cast<unsigned char>(*p)] == CHAR_DIGIT && value <= maxVal)
+                        value = value * 10 + (*p++ - '0');
+
+                    if (p > token && p < last && value <= maxVal &&
+                        classes.of[static_cast<unsigned char>(*p)] >= CHAR_SPACE)
+                    {
+                        begin = p - buffer.data();
+                    }
+                    else
+                    {
+                        begin = token - buffer.data();
+                        ok = readSample(value);
+                    }
+                    samples[i] = static_cast<uint8_t>(value);
+                }
+            }
+            else if (isQoiFormat(format))
+            {
+                // Top up until a whole row's worst case is buffered (or
+                // the file ends); the decoder carries runs across rows
+                size_t rowBytes = qoi::maxCodedBytes(width, 4);
+                while (end - begin < rowBytes && fill())
+                {
+                }
+                const uint8_t *data = reinterpret_cast<const uint8_t *>(buffer.data());
+                const uint8_t *next = decoder.decode(data + begin, data + end, row, width);
+                ok = next != nullptr;
+                if (ok)
+                    begin = next - data;
+            }
+            else
+            {
+                // Binary payload: copy (P6) or expand (P5) what is buffered
+                size_t channels = (format == ImageFormat::P6) ? 3 : 1;
+                size_t needed = static_cast<size_t>(width) * channels;
+                size_t done = 0;
+                while (done < needed && ok)
+                {
+                    if (begin == end && !fill())
+                    {
+                        ok = false;
+                        break;
+                    }
+                    size_t count = std::min(needed - done, end - begin);
+                    const unsigned char *src = reinterpret_cast<const unsigned char *>(buffer.data() + begin);
+                    if (channels == 3)
+                    {
+                        memcpy(reinterpret_cast<uint8_t *>(row) + done, src, count);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < count; i++)
+                        {
+                            row[done + i].r = row[done + i].g = row[done + i].b = src[i];
+                        }
+                    }
+                    begin += count;
+                    done += count;
+                }
+            }
+
+            if (!ok)
+            {
+                cerr << "Error: Truncated or malformed image data in " << path << " (row " << rowsRead << ")" << endl;
+                return false;
+            }
+            rescaleSamples(reinterpret_cast<uint8_t *>(row), static_cast<size_t>(width) * 3, maxVal);
+            rowsRead++;
+            return true;
+        }
+
+        RowWriter::RowWriter()
+            : fd(-1), format(ImageFormat::P3), width(0), used(0), failed(false), rowsWritten(0)
+        {
+        }
+
+        RowWriter::~RowWriter()
+        {
+            if (fd >= 0 || tiled.isOpen())
+                close();
+        }
+
+        bool RowWriter::open(const char *filename, ImageFormat outputFormat, int w, int h)
+        {
+            if (fd >= 0 || tiled.isOpen())
+                close();
+
+            path = filename;
+            format = outputFormat;
+            width = w;
+            used = 0;
+            failed = false;
+            rowsWritten = 0;
+            if (isTiledFormat(format))
+                return tiled.create(filename, w, h, format == ImageFormat::TILED_GRAY ? 1 : 3, DEFAULT_TILE_SIZE);
+
+            fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
             {
                 cerr << "Error: could not write to file " << filename << endl;
-                return false; // Return false on failure
+                return false;
+            }
+
+            if (buffer.size() < WRITE_BUFFER_BYTES)
+                buffer.resize(WRITE_BUFFER_BYTES);
+            if (isQoiFormat(format))
+            {
+                int channels = format == ImageFormat::QOI_GRAY ? 1 : 3;
+                encoder.reset(channels);
+                uint8_t *start = reinterpret_cast<uint8_t *>(buffer.data());
+                used = qoi::writeHeader(start, w, h, channels) - start;
+                return true;
             }
+            const char *magic = format == ImageFormat::P3 ? "P3" : format == ImageFormat::P5 ? "P5" : "P6";
+            used = static_cast<size_t>(snprintf(buffer.data(), 64, "%s\n%d %d\n255\n", magic, w, h));
+            return true;
+        }
 
-            file << "P3\n"
-                 << width << " " << height << "\n255\n";
+        bool RowWriter::flush()
+        {
+            if (used > 0 && !failed && !writeAll(fd, buffer.data(), used))
+                failed = true;
+            used = 0;
+            return !failed;
+        }
+
+        char *RowWriter::reserve(size_t bytes)
+        {
+            if (used + bytes > buffer.size())
+            {
+                flush();
+                if (bytes > buffer.size())
+                    buffer.resize(bytes);
+            }
+            return buffer.data() + used;
+        }
 
-            for (int i = 0; i < width * height; i++)
+        bool RowWriter::writeRow(const pixel *row)
+        {
+            if (tiled.isOpen())
             {
-                file << (int)buffer[i].r << " "
-                     << (int)buffer[i].g << " "
-                     << (int)buffer[i].b << "\n";
+                if (format == ImageFormat::TILED)
+                {
+                    return writeTiledRow(reinterpret_cast<const uint8_t *>(row));
+                }
+                line.resize(width);
+                for (int x = 0; x < width; x++)
+                {
+                    line[x] = row[x].r;
+                }
+                return writeTiledRow(line.data());
             }
 
-            file.close();
+            if (fd < 0 || failed)
+                return false;
 
-            // Check if write was successful
-            if (file.fail())
+            const uint8_t *samples = reinterpret_cast<const uint8_t *>(row);
+            if (format == ImageFormat::P3)
             {
-                cerr << "Error: Failed to write to file " << filename << endl;
+                char *start = reserve(width * ASCII_PIXEL_BYTES + 4);
+                used += formatAscii(start, samples, width, 3) - start;
+            }
+            else if (format == ImageFormat::P6)
+            {
+                memcpy(reserve(width * sizeof(pixel)), samples, width * sizeof(pixel));
+                used += width * sizeof(pixel);
+            }
+            else if (format == ImageFormat::QOI)
+            {
+                uint8_t *start = reinterpret_cast<uint8_t *>(reserve(qoi::maxCodedBytes(width, 3)));
+                used += encoder.encode(samples, width, start) - start;
+            }
+            else if (format == ImageFormat::QOI_GRAY)
+            {
+                line.resize(width);
+                for (int x = 0; x < width; x++)
+                {
+                    line[x] = row[x].r;
+                }
+                uint8_t *start = reinterpret_cast<uint8_t *>(reserve(qoi::maxCodedBytes(width, 1)));
+                used += encoder.encode(line.data(), width, start) - start;
+            }
+            else
+            {
+                // Frames are grayscale after conversion: keep one channel
+                uint8_t *dst = reinterpret_cast<uint8_t *>(reserve(width));
+                for (int x = 0; x < width; x++)
+                {
+                    dst[x] = row[x].r;
+                }
+                used += width;
+            }
+            return true;
+        }
+
+        bool RowWriter::writeRow(const uint8_t *row)
+        {
+            if (tiled.isOpen())
+            {
+                if (format == ImageFormat::TILED_GRAY)
+                {
+                    return writeTiledRow(row);
+                }
+                line.resize(width * 3);
+                for (int x = 0; x < width; x++)
+                {
+                    line[3 * x] = line[3 * x + 1] = line[3 * x + 2] = row[x];
+                }
+                return writeTiledRow(line.data());
+            }
+
+            if (fd < 0 || failed)
                 return false;
+
+            if (format == ImageFormat::P3)
+            {
+                char *start = reserve(width * ASCII_PIXEL_BYTES + 4);
+                used += formatAscii(start, row, width, 1) - start;
+            }
+            else if (format == ImageFormat::P6)
+            {
+                pixel *dst = reinterpret_cast<pixel *>(reserve(width * sizeof(pixel)));
+                for (int x = 0; x < width; x++)
+                {
+                    dst[x].r = dst[x].g = dst[x].b = row[x];
+                }
+                used += width * sizeof(pixel);
+            }
+            else if (format == ImageFormat::QOI)
+            {
+                line.resize(width * 3);
+                for (int x = 0; x < width; x++)
+                {
+                    line[3 * x] = line[3 * x + 1] = line[3 * x + 2] = row[x];
+                }
+                uint8_t *start = reinterpret_cast<uint8_t *>(reserve(qoi::maxCodedBytes(width, 3)));
+                used += encoder.encode(line.data(), width, start) - start;
+            }
+            else if (format == ImageFormat::QOI_GRAY)
+            {
+                uint8_t *start = reinterpret_cast<uint8_t *>(reserve(qoi::maxCodedBytes(width, 1)));
+                used += encoder.encode(row, width, start) - start;
+            }
+            else
+            {
+                memcpy(reserve(width), row, width);
+                used += width;
             }
+            return true;
+        }
 
-            return true; // Return true on success
+        bool RowWriter::writeTiledRow(const uint8_t *samples)
+        {
+            if (rowsWritten >= tiled.getHeight())
+                return false;
+
+            // A finished row of tiles leaves this process; the page cache
+            // writes it back
+            tiled.writeRow(rowsWritten++, samples);
+            if (rowsWritten % tiled.getTileSize() == 0)
+                tiled.releaseTileRows(rowsWritten / tiled.getTileSize() - 1, rowsWritten / tiled.getTileSize());
+            return true;
         }
 
-        // Optional overload for std::string
-        bool FrameWriter::saveImage(const std::string &filename, pixel *buffer, int width, int height)
+        bool RowWriter::close()
         {
-            return saveImage(filename.c_str(), buffer, width, height);
+            if (tiled.isOpen())
+                return tiled.close();
+            if (fd < 0)
+                return false;
+
+            if (isQoiFormat(format))
+            {
+                // A pending run and the end marker
+                uint8_t *start = reinterpret_cast<uint8_t *>(reserve(qoi::END_BYTES + 1));
+                used += encoder.finish(start) - start;
+            }
+            flush();
+            if (::close(fd) != 0)
+                failed = true;
+            fd = -1;
+
+            if (failed)
+            {
+                cerr << "Error: Failed to write to file " << path << endl;
+                return false;
+            }
+            return true;
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,331 @@
+#include "lazy_evaluator.h"
+#include "colour_converter.h"
+#include "config.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        namespace
+        {
+            uint64_t tileKey(int level, int tx, int ty)
+            {
+                return static_cast<uint64_t>(level) << 48 | static_cast<uint64_t>(ty) << 24 |
+                       static_cast<uint64_t>(tx);
+            }
+
+            // `area` grown by `reach` on every side, clipped to the frame
+            Region grow(const Region &area, int reach, int width, int height)
+            {
+                int x0 = std::max(0, area.x - reach);
+                int y0 = std::max(0, area.y - reach);
+                int x1 = std::min(width, area.x + area.width + reach);
+                int y1 = std::min(height, area.y + area.height + reach);
+                return {x0, y0, x1 - x0, y1 - y0};
+            }
+
+            // Copy the part of a packed `rect` that lies inside `target`
+            // into rows `stride` elements apart starting at target's origin
+            template <typename T>
+            void copyOverlap(const T *samples, const Region &rect, const Region &target, T *out, int stride)
+            {
+                int x0 = std::max(rect.x, target.x);
+                int y0 = std::max(rect.y, target.y);
+                int x1 = std::min(rect.x + rect.width, target.x + target.width);
+                int y1 = std::min(rect.y + rect.height, target.y + target.height);
+                for (int y = y0; y < y1; y++)
+                {
+                    memcpy(out + static_cast<size_t>(y - target.y) * stride + (x0 - target.x),
+                           samples + static_cast<size_t>(y - rect.y) * rect.width + (x0 - rect.x),
+                           static_cast<size_t>(x1 - x0) * sizeof(T));
+                }
+            }
+        }
+
+        LazyEvaluator::LazyEvaluator(Pipeline &target, int tile, size_t budget)
+            : pipeline(target),
+              tileSize(std::max(1, tile)),
+              cacheBytes(budget),
+              format(ImageFormat::P6),
+              width(0),
+              height(0),
+              gray(true),
+              border(filters::BorderMode::COPY),
+              borderConstant(0),
+              cachedBytes(0),
+              hits(0)
+        {
+        }
+
+        bool LazyEvaluator::open(const char *inputPath)
+        {
+            clear();
+            tiled.close();
+            frame = hardware::memory::FrameBuffer();
+
+            stages.clear();
+            gray = true;
+            for (int i = 0; i < pipeline.getStageCount(); i++)
+            {
+                stages.push_back(pipeline.getStage(i));
+                gray = gray && stages.back()->supportsFormat(filters::PixelFormat::GRAY8);
+            }
+            border = pipeline.getBorder();
+            borderConstant = pipeline.getBorderConstant();
+            computed.assign(stages.size() + 1, 0);
+            windows.resize(stages.size() + 1);
+
+            // Tiled images stay mapped and are read a tile at a time
+            if (isTiledImage(inputPath))
+            {
+                if (!tiled.open(inputPath))
+                    return false;
+                format = tiled.getChannels() == 1 ? ImageFormat::TILED_GRAY : ImageFormat::TILED;
+                width = tiled.getWidth();
+                height = tiled.getHeight();
+                return true;
+            }
+
+            FrameReader reader;
+            if (!reader.mapImage(inputPath, format, frame))
+                return false;
+            width = frame.getWidth();
+            height = frame.getHeight();
+            return true;
+        }
+
+        std::vector<Region> LazyEvaluator::footprint(const Region &area) const
+        {
+            std::vector<Region> levels(stages.size() + 1);
+            levels.back() = area;
+            for (size_t k = stages.size(); k > 0; k--)
+            {
+                levels[k - 1] = grow(levels[k], stages[k - 1]->getFootprint(), width, height);
+            }
+            return levels;
+        }
+
+        Region LazyEvaluator::tileRect(int tx, int ty) const
+        {
+            int x = tx * tileSize;
+            int y = ty * tileSize;
+            return {x, y, std::min(tileSize, width - x), std::min(tileSize, height - y)};
+        }
+
+        const uint8_t *LazyEvaluator::insert(int level, int tx, int ty, std::vector<uint8_t> &&samples)
+        {
+            uint64_t key = tileKey(level, tx, ty);
+            computed[level]++;
+            cachedBytes += samples.size();
+            tiles.push_front(Tile{key, std::move(samples)});
+            index[key] = tiles.begin();
+            evict();
+            return tiles.front().samples.data();
+        }
+
+        template <typename T>
+        const T *LazyEvaluator::fetch(int level, int tx, int ty)
+        {
+            auto found = index.find(tileKey(level, tx, ty));
+            if (found != index.end())
+            {
+                tiles.splice(tiles.begin(), tiles, found->second);
+                hits++;
+                return reinterpret_cast<const T *>(tiles.front().samples.data());
+            }
+            if (level > 0)
+                return computeStage<T>(level, tx, ty);
+
+            Region rect = tileRect(tx, ty);
+            std::vector<uint8_t> samples(static_cast<size_t>(rect.width) * rect.height * sizeof(T));
+            computeSource(rect, reinterpret_cast<T *>(samples.data()));
+            return reinterpret_cast<const T *>(insert(0, tx, ty, std::move(samples)));
+        }
+
+        template <typename T>
+        void LazyEvaluator::computeSource(const Region &rect, T *out)
+        {
+            if (tiled.isOpen())
+            {
+                sourceRows.resize(static_cast<size_t>(rect.width) * rect.height);
+                tiled.readRegion(rect.x, rect.y, rect.width, rect.height, sourceRows.data(), rect.width);
+                convertToGrayscale(sourceRows.data(), out, rect.width, rect.height);
+                return;
+            }
+
+            filters::ImageView source = frame.view(rect.x, rect.y, rect.width, rect.height);
+            for (int y = 0; y < rect.height; y++)
+            {
+                convertToGrayscale(source.row(y), out + static_cast<size_t>(y) * rect.width, rect.width, 1);
+            }
+        }
+
+        template <typename T>
+        const T *LazyEvaluator::computeStage(int level, int tx, int ty)
+        {
+            filters::BaseFilter *stage = stages[level - 1];
+            int radius = stage->getRadius();
+            int reach = stage->getFootprint();
+            int grain = stage->getRowGranularity();
+
+            // Block filters compute whole blocks: the span is every block
+            // the tile touches, and the window starts on a block boundary so
+            // the blocks fall where they do in a frame run
+            Region rect = tileRect(tx, ty);
+            Region span;
+            span.x = rect.x / grain * grain;
+            span.y = rect.y / grain * grain;
+            span.width = std::min(width, (rect.x + rect.width + grain - 1) / grain * grain) - span.x;
+            span.height = std::min(height, (rect.y + rect.height + grain - 1) / grain * grain) - span.y;
+            Region window;
+            window.x = std::max(0, span.x - reach) / grain * grain;
+            window.y = std::max(0, span.y - reach) / grain * grain;
+            window.width = std::min(width, span.x + span.width + reach) - window.x;
+            window.height = std::min(height, span.y + span.height + reach) - window.y;
+
+            // The window of the stage's input, inside an apron the border
+            // mode fills as it would around a frame
+            int apron = border == filters::BorderMode::COPY ? 0 : radius;
+            int stride = window.width + 2 * apron;
+            std::vector<uint8_t> &buffer = windows[level];
+            buffer.resize(static_cast<size_t>(stride) * (window.height + 2 * apron) * sizeof(T));
+            T *origin = reinterpret_cast<T *>(buffer.data()) + static_cast<size_t>(apron) * stride + apron;
+
+            int tx1 = (window.x + window.width - 1) / tileSize;
+            int ty1 = (window.y + window.height - 1) / tileSize;
+            for (int y = window.y / tileSize; y <= ty1; y++)
+            {
+                for (int x = window.x / tileSize; x <= tx1; x++)
+                {
+                    copyOverlap(fetch<T>(level - 1, x, y), tileRect(x, y), window, origin, stride);
+                }
+            }
+
+            std::vector<const T *> rows(window.height + 2 * radius);
+            if (apron)
+            {
+                filters::fillApron(origin, window.width, window.height, stride, apron, border, borderConstant);
+                filters::paddedRowPointers<T>(origin, stride, -radius, window.height + 2 * radius, rows.data());
+            }
+            else
+            {
+                filters::BasicImageView<const T> view = {origin, window.width, window.height, stride};
+                filters::clampedRowPointers(view, -radius, window.height + 2 * radius, rows.data());
+            }
+
+            // The window is the stage's frame: only the span's rows are computed
+            int y0 = span.y - window.y;
+            results.resize(static_cast<size_t>(window.width) * span.height * sizeof(T));
+            T *result = reinterpret_cast<T *>(results.data());
+            filters::BasicRowBand<T> band = {rows.data() + y0, result, window.width, y0, y0 + span.height,
+                                             window.width, window.height, radius, border, borderConstant};
+            stage->beginFrame();
+            stage->processRows(band);
+
+            // Cache every tile the span covers, the requested one last (most
+            // recent) so that inserting the others cannot evict it
+            auto store = [&](int x, int y) {
+                Region tile = tileRect(x, y);
+                std::vector<uint8_t> samples(static_cast<size_t>(tile.width) * tile.height * sizeof(T));
+                Region source = {window.x, span.y, window.width, span.height};
+                for (int row = 0; row < tile.height; row++)
+                {
+                    memcpy(samples.data() + static_cast<size_t>(row) * tile.width * sizeof(T),
+                           result + static_cast<size_t>(tile.y + row - source.y) * window.width +
+                               (tile.x - source.x),
+                           static_cast<size_t>(tile.width) * sizeof(T));
+                }
+                return reinterpret_cast<const T *>(insert(level, x, y, std::move(samples)));
+            };
+            for (int y = span.y / tileSize; y * tileSize < span.y + span.height; y++)
+            {
+                for (int x = span.x / tileSize; x * tileSize < span.x + span.width; x++)
+                {
+                    Region tile = tileRect(x, y);
+                    bool inside = tile.x >= span.x && tile.y >= span.y && tile.x + tile.width <= span.x + span.width &&
+                                  tile.y + tile.height <= span.y + span.height;
+                    if (inside && (x != tx || y != ty) && !index.count(tileKey(level, x, y)))
+                        store(x, y);
+                }
+            }
+            return store(tx, ty);
+        }
+
+        template <typename T>
+        bool LazyEvaluator::copyRegion(const Region &area, T *out, int stride)
+        {
+            if (width == 0)
+            {
+                std::cerr << "Error: No image open for lazy evaluation" << std::endl;
+                return false;
+            }
+            if (area.empty() || area.x < 0 || area.y < 0 || area.x + area.width > width ||
+                area.y + area.height > height)
+            {
+                std::cerr << "Error: Region " << area.width << "x" << area.height << "+" << area.x << "+" << area.y
+                          << " lies outside the " << width << "x" << height << " frame" << std::endl;
+                return false;
+            }
+
+            int level = static_cast<int>(stages.size());
+            int tx1 = (area.x + area.width - 1) / tileSize;
+            int ty1 = (area.y + area.height - 1) / tileSize;
+            for (int ty = area.y / tileSize; ty <= ty1; ty++)
+            {
+                for (int tx = area.x / tileSize; tx <= tx1; tx++)
+                {
+                    copyOverlap(fetch<T>(level, tx, ty), tileRect(tx, ty), area, out, stride);
+                }
+            }
+            return true;
+        }
+
+        bool LazyEvaluator::request(const Region &area, uint8_t *out, int stride)
+        {
+            if (!gray)
+            {
+                std::cerr << "Error: The pipeline's stages produce RGB frames, not gray planes" << std::endl;
+                return false;
+            }
+            return copyRegion(area, out, stride);
+        }
+
+        bool LazyEvaluator::request(const Region &area, pixel *out, int stride)
+        {
+            if (gray)
+            {
+                std::cerr << "Error: The pipeline's stages produce gray planes, not RGB frames" << std::endl;
+                return false;
+            }
+            return copyRegion(area, out, stride);
+        }
+
+        size_t LazyEvaluator::getTilesComputed(int level) const
+        {
+            return level >= 0 && level < static_cast<int>(computed.size()) ? computed[level] : 0;
+        }
+
+        void LazyEvaluator::evict()
+        {
+            // The newest tile stays even if it alone is over budget
+            while (cachedBytes > cacheBytes && tiles.size() > 1)
+            {
+                cachedBytes -= tiles.back().samples.size();
+                index.erase(tiles.back().key);
+                tiles.pop_back();
+            }
+        }
+
+        void LazyEvaluator::clear()
+        {
+            tiles.clear();
+            index.clear();
+            cachedBytes = 0;
+            hits = 0;
+            std::fill(computed.begin(), computed.end(), 0);
+        }
+    }
+}
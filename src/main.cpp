@@ -1,32 +1,239 @@
 #include "pipeline.h"
+#include "batch.h"
 #include "smoothing_filter.h"
 #include "edge_filter.h"
 #include "convolution.h"
+#include "static_kernel.h"
+#include "box_filter.h"
+#include "recursive_gaussian.h"
+#include "fft_convolution.h"
+#include "simd_kernels.h"
 #include "config.h"
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdlib>
 
 // Using declarations
 using hardware::pipeline::Pipeline;
 using hardware::filters::SmoothingFilter;
 using hardware::filters::EdgeFilter;
 using hardware::filters::ConvolutionFilter;
+using hardware::filters::SharpenFilter;
+using hardware::filters::BoxFilter;
+using hardware::filters::AdaptiveThresholdFilter;
+using hardware::pipeline::ExecutionMode;
+using hardware::pipeline::BatchRunner;
+using hardware::pipeline::BatchItem;
+using hardware::pipeline::StageStats;
+using hardware::pipeline::Region;
+using hardware::filters::BorderMode;
+
+// Batch settings shared by every pipeline run from main
+struct BatchOptions {
+    bool enabled = false;
+    int ioThreads = 1;
+    int queueDepth = 2;
+};
+
+// --profile: per-stage totals over every frame one pipeline processed.
+// Batch mode reports decode and encode from I/O threads, hence the lock.
+struct StageProfile {
+    struct Row {
+        std::string name;
+        int index;
+        int frames;
+        double wallSeconds;
+        double cpuSeconds;
+        size_t inputBytes;
+        size_t outputBytes;
+        double pixels;
+    };
+    
+    std::mutex mutex;
+    std::vector<Row> rows;
+};
+
+static void recordStage(const StageStats& stats, void* userData) {
+    StageProfile* profile = static_cast<StageProfile*>(userData);
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    
+    auto row = std::find_if(profile->rows.begin(), profile->rows.end(), [&](const StageProfile::Row& r) {
+        return r.index == stats.index && r.name == stats.name;
+    });
+    if (row == profile->rows.end()) {
+        profile->rows.push_back({stats.name, stats.index, 0, 0.0, 0.0, 0, 0, 0.0});
+        row = profile->rows.end() - 1;
+    }
+    row->frames++;
+    row->wallSeconds += stats.wallSeconds;
+    row->cpuSeconds += stats.cpuSeconds;
+    row->inputBytes += stats.inputBytes;
+    row->outputBytes += stats.outputBytes;
+    row->pixels += static_cast<double>(stats.width) * stats.height;
+}
+
+static void printProfile(const std::string& title, StageProfile& profile) {
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    std::stable_sort(profile.rows.begin(), profile.rows.end(),
+                     [](const StageProfile::Row& a, const StageProfile::Row& b) { return a.index < b.index; });
+    
+    std::cout << "\nProfile: " << title << "\n";
+    std::cout << std::left << std::setw(32) << "stage" << std::right << std::setw(7) << "frames"
+              << std::setw(11) << "wall ms" << std::setw(11) << "cpu ms" << std::setw(10) << "in MB"
+              << std::setw(10) << "out MB" << std::setw(10) << "Mpix/s" << "\n";
+    
+    double wall = 0.0;
+    double cpu = 0.0;
+    for (const StageProfile::Row& r : profile.rows) {
+        std::cout << std::left << std::setw(32) << r.name << std::right << std::setw(7) << r.frames
+                  << std::fixed << std::setprecision(3)
+                  << std::setw(11) << r.wallSeconds * 1e3 << std::setw(11) << r.cpuSeconds * 1e3
+                  << std::setprecision(2) << std::setw(10) << r.inputBytes / 1e6
+                  << std::setw(10) << r.outputBytes / 1e6 << std::setprecision(1)
+                  << std::setw(10) << (r.wallSeconds > 0.0 ? r.pixels / r.wallSeconds / 1e6 : 0.0) << "\n";
+        wall += r.wallSeconds;
+        cpu += r.cpuSeconds;
+    }
+    std::cout << std::left << std::setw(32) << "total" << std::right << std::setw(7) << ""
+              << std::setprecision(3) << std::setw(11) << wall * 1e3 << std::setw(11) << cpu * 1e3 << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+// Run one pipeline either on a single file or, in batch mode, on every image
+// of a directory/list. `suffix` tags outputs when several pipelines run.
+static bool execute(Pipeline& pipeline, const std::string& inputPath, const std::string& outputPath,
+                    const std::string& suffix, const BatchOptions& batch) {
+    if (!batch.enabled) {
+        // The suffix goes before the extension, which still selects the encoding
+        std::string out = outputPath;
+        if (!suffix.empty()) {
+            size_t dot = outputPath.find_last_of('.');
+            size_t slash = outputPath.find_last_of('/');
+            if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+                out = outputPath.substr(0, dot) + suffix + outputPath.substr(dot);
+            } else {
+                out = outputPath + suffix + ".ppm";
+            }
+        }
+        return pipeline.run(inputPath.c_str(), out.c_str());
+    }
+    
+    std::vector<BatchItem> items;
+    if (!BatchRunner::collectItems(inputPath, outputPath, suffix, items)) {
+        return false;
+    }
+    if (items.empty()) {
+        std::cerr << "Error: No images found in " << inputPath << "\n";
+        return false;
+    }
+    
+    BatchRunner runner(pipeline, batch.ioThreads, batch.queueDepth);
+    return runner.run(items) == 0;
+}
+
+// Parse a non-negative integer option value within [minValue, maxValue]
+static bool parseCount(const char* text, long minValue, long maxValue, int& result) {
+    char* end = nullptr;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < minValue || value > maxValue) {
+        return false;
+    }
+    result = static_cast<int>(value);
+    return true;
+}
+
+// Parse a decimal option value within [minValue, maxValue]
+static bool parseReal(const char* text, float minValue, float maxValue, float& result) {
+    char* end = nullptr;
+    float value = strtof(text, &end);
+    if (end == text || *end != '\0' || !(value >= minValue && value <= maxValue)) {
+        return false;
+    }
+    result = value;
+    return true;
+}
+
+// Parse a --border value: copy, replicate, mirror, constant or constant:V
+static bool parseBorder(const std::string& text, BorderMode& mode, int& constant) {
+    constant = 0;
+    if (text == "copy") {
+        mode = BorderMode::COPY;
+    } else if (text == "replicate") {
+        mode = BorderMode::REPLICATE;
+    } else if (text == "mirror") {
+        mode = BorderMode::MIRROR;
+    } else if (text == "constant") {
+        mode = BorderMode::CONSTANT;
+    } else if (text.compare(0, 9, "constant:") == 0) {
+        mode = BorderMode::CONSTANT;
+        return parseCount(text.c_str() + 9, 0, 255, constant);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Parse a --roi value: X,Y,W,H in pixels
+static bool parseRegion(const std::string& text, Region& region) {
+    int* fields[4] = {&region.x, &region.y, &region.width, &region.height};
+    size_t start = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t end = (i < 3) ? text.find(',', start) : text.size();
+        if (end == std::string::npos ||
+            !parseCount(text.substr(start, end - start).c_str(), i < 2 ? 0 : 1, 1L << 24, *fields[i])) {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
 
 void printUsage(const char* programName) {
     std::cout << "FPGA Image Processing Pipeline Simulator\n";
     std::cout << "=========================================\n";
     std::cout << "Usage: " << programName << " <input.ppm> <output.ppm> [options]\n";
+    std::cout << "       " << programName << " <input-dir|list.txt> <output-dir> --batch [options]\n";
+    std::cout << "\nFormats: P3/P6 (.ppm), P5 (.pgm), lossless QOI (.qoi) and memory-mapped tiles\n"
+              << "         (.tiles, run tile by tile); output keeps the input's encoding unless\n"
+              << "         its extension selects QOI, tiles or Netpbm\n";
     std::cout << "\nOptions:\n";
     std::cout << "  --mode=basic     : Smoothing -> Edge Detection (default)\n";
     std::cout << "  --mode=conv      : Gaussian Blur -> Sharpen\n";
+    std::cout << "  --mode=box       : Box mean of radius --radius (running sums)\n";
+    std::cout << "  --mode=threshold : Adaptive local-mean threshold over radius --radius\n";
+    std::cout << "  --mode=blur      : Gaussian blur of --sigma (recursive above sigma "
+              << hardware::filters::RECURSIVE_GAUSSIAN_MIN_SIGMA << ")\n";
+    std::cout << "  --mode=unsharp   : Unsharp mask of --sigma as one dense kernel (direct or FFT)\n";
     std::cout << "  --mode=all       : Run all pipelines\n";
+    std::cout << "  --radius=N       : Window radius for box/threshold, 1-" << hardware::filters::MAX_BOX_RADIUS
+              << " (default 15)\n";
+    std::cout << "  --sigma=S        : Blur/unsharp sigma, 0.5-" << hardware::filters::MAX_GAUSSIAN_SIGMA << " (default 8)\n";
+    std::cout << "  --exec=frame     : Materialize full frames between stages (default)\n";
+    std::cout << "  --exec=stream    : Stream rows through per-stage line buffers\n";
+    std::cout << "  --exec=lazy      : Compute only the stage tiles the output (or --roi) needs\n";
+    std::cout << "  --fuse=on|off    : Fuse adjacent frame stages into single passes (default on)\n";
+    std::cout << "  --threads=N      : Process each stage in row bands on N threads\n";
+    std::cout << "                     (0 = all hardware threads, default 1)\n";
+    std::cout << "  --border=MODE    : Edge pixels: copy (default, unfiltered), replicate, mirror,\n";
+    std::cout << "                     constant[:V] (intensity V, default 0)\n";
+    std::cout << "  --roi=X,Y,W,H    : Filter and write only the W x H rectangle at (X, Y)\n";
+    std::cout << "  --simd=LEVEL     : Convolution kernels: auto (default), scalar, sse4.1, avx2\n";
+    std::cout << "  --profile        : Print per-stage wall/CPU time, bytes and throughput\n";
+    std::cout << "  --batch          : Process every image of a directory or list file, overlapping\n";
+    std::cout << "                     decode, compute and encode of neighbouring images\n";
+    std::cout << "  --io-threads=N   : Batch decode and encode threads each (default 1)\n";
+    std::cout << "  --queue-depth=N  : Batch frames queued between stages (default 2)\n";
     std::cout << "  --help, -h       : Show this help\n";
     std::cout << "\nExamples:\n";
     std::cout << "  " << programName << " input.ppm output.ppm\n";
     std::cout << "  " << programName << " input.ppm output.ppm --mode=conv\n";
     std::cout << "  " << programName << " input.ppm output.ppm --mode=all\n";
+    std::cout << "  " << programName << " frames/ out/ --batch --threads=4\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -47,12 +254,109 @@ int main(int argc, char* argv[]) {
     
     std::string inputPath = argv[1];
     std::string outputPath = argv[2];
+    
+    // An option in a path position means a path was left out; don't
+    // write an image named after the option
+    if (inputPath.compare(0, 2, "--") == 0 || outputPath.compare(0, 2, "--") == 0) {
+        std::cerr << "Error: Expected input and output paths before options, got '"
+                  << (inputPath.compare(0, 2, "--") == 0 ? inputPath : outputPath) << "'\n\n";
+        printUsage(argv[0]);
+        return 1;
+    }
     std::string mode = "basic";
+    ExecutionMode execMode = ExecutionMode::FRAME;
+    int threadCount = 1;
+    bool fusion = true;
+    bool profile = false;
+    int radius = 15;
+    float sigma = 8.0f;
+    BorderMode border = BorderMode::COPY;
+    int borderConstant = 0;
+    Region region;
+    BatchOptions batch;
     
     // Parse additional arguments
     for (int i = 3; i < argc; i++) {
         if (strncmp(argv[i], "--mode=", 7) == 0) {
             mode = argv[i] + 7;
+        } else if (strncmp(argv[i], "--exec=", 7) == 0) {
+            std::string exec = argv[i] + 7;
+            if (exec == "stream") {
+                execMode = ExecutionMode::STREAMING;
+            } else if (exec == "frame") {
+                execMode = ExecutionMode::FRAME;
+            } else if (exec == "lazy") {
+                execMode = ExecutionMode::LAZY;
+            } else {
+                std::cerr << "Error: Unknown execution mode '" << exec << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--fuse=", 7) == 0) {
+            std::string fuse = argv[i] + 7;
+            if (fuse == "on") {
+                fusion = true;
+            } else if (fuse == "off") {
+                fusion = false;
+            } else {
+                std::cerr << "Error: Unknown fusion setting '" << fuse << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            if (!parseCount(argv[i] + 10, 0, 1024, threadCount)) {
+                std::cerr << "Error: Invalid thread count '" << (argv[i] + 10) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--radius=", 9) == 0) {
+            if (!parseCount(argv[i] + 9, 1, hardware::filters::MAX_BOX_RADIUS, radius)) {
+                std::cerr << "Error: Invalid radius '" << (argv[i] + 9) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--sigma=", 8) == 0) {
+            if (!parseReal(argv[i] + 8, 0.5f, hardware::filters::MAX_GAUSSIAN_SIGMA, sigma)) {
+                std::cerr << "Error: Invalid sigma '" << (argv[i] + 8) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--border=", 9) == 0) {
+            if (!parseBorder(argv[i] + 9, border, borderConstant)) {
+                std::cerr << "Error: Unknown border mode '" << (argv[i] + 9) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--roi=", 6) == 0) {
+            if (!parseRegion(argv[i] + 6, region)) {
+                std::cerr << "Error: Invalid region '" << (argv[i] + 6) << "' (expected X,Y,W,H)\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch.enabled = true;
+        } else if (strncmp(argv[i], "--io-threads=", 13) == 0) {
+            if (!parseCount(argv[i] + 13, 1, 64, batch.ioThreads)) {
+                std::cerr << "Error: Invalid I/O thread count '" << (argv[i] + 13) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--queue-depth=", 14) == 0) {
+            if (!parseCount(argv[i] + 14, 1, 256, batch.queueDepth)) {
+                std::cerr << "Error: Invalid queue depth '" << (argv[i] + 14) << "'\n";
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--simd=", 7) == 0) {
+            std::string level = argv[i] + 7;
+            bool selected = true;
+            if (level == "scalar") {
+                selected = hardware::filters::simd::selectIsa(hardware::filters::simd::IsaLevel::SCALAR);
+            } else if (level == "sse4.1") {
+                selected = hardware::filters::simd::selectIsa(hardware::filters::simd::IsaLevel::SSE41);
+            } else if (level == "avx2") {
+                selected = hardware::filters::simd::selectIsa(hardware::filters::simd::IsaLevel::AVX2);
+            } else if (level != "auto") {
+                std::cerr << "Error: Unknown SIMD level '" << level << "'\n";
+                return 1;
+            }
+            if (!selected) {
+                std::cerr << "Error: CPU does not support SIMD level '" << level << "'\n";
+                return 1;
+            }
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             // Already handled, but keep for consistency
             printUsage(argv[0]);
@@ -66,6 +370,11 @@ int main(int argc, char* argv[]) {
     LOG_INFO("Input: " << inputPath);
     LOG_INFO("Output: " << outputPath);
     LOG_INFO("Mode: " << mode);
+    LOG_INFO("Execution: " << (execMode == ExecutionMode::STREAMING ? "streaming"
+                               : execMode == ExecutionMode::LAZY ? "lazy" : "frame"));
+    if (batch.enabled) {
+        LOG_INFO("Batch: " << batch.ioThreads << " I/O thread(s), queue depth " << batch.queueDepth);
+    }
     
     bool success = false;
     int pipelinesCompleted = 0;
@@ -75,26 +384,29 @@ int main(int argc, char* argv[]) {
         LOG_INFO("Running: Smoothing -> Edge Detection");
         
         Pipeline pipeline1;
+        pipeline1.setExecutionMode(execMode);
+        pipeline1.setFusion(fusion);
+        pipeline1.setThreadCount(threadCount);
+        pipeline1.setBorder(border, static_cast<uint8_t>(borderConstant));
+        pipeline1.setRegion(region);
         pipeline1.addStage(new SmoothingFilter());
         pipeline1.addStage(new EdgeFilter());
         
-        std::string out1 = outputPath;
-        if (mode == "all") {
-            size_t dot = outputPath.find_last_of('.');
-            if (dot != std::string::npos) {
-                out1 = outputPath.substr(0, dot) + "_basic.ppm";
-            } else {
-                out1 = outputPath + "_basic.ppm";
-            }
+        StageProfile stats1;
+        if (profile) {
+            pipeline1.setStatsCallback(recordStage, &stats1);
         }
         
-        if (pipeline1.run(inputPath.c_str(), out1.c_str())) {
-            LOG_INFO("Basic pipeline complete: " << out1);
+        if (execute(pipeline1, inputPath, outputPath, mode == "all" ? "_basic" : "", batch)) {
+            LOG_INFO("Basic pipeline complete");
             pipelinesCompleted++;
             success = true;
         } else {
             LOG_ERROR("Basic pipeline failed");
         }
+        if (profile) {
+            printProfile("Smoothing -> Edge Detection", stats1);
+        }
     }
     
     // Convolution pipeline: Gaussian Blur -> Sharpen
@@ -102,31 +414,35 @@ int main(int argc, char* argv[]) {
         LOG_INFO("Running: Gaussian Blur -> Sharpen");
         
         Pipeline pipeline2;
+        pipeline2.setExecutionMode(execMode);
+        pipeline2.setFusion(fusion);
+        pipeline2.setThreadCount(threadCount);
+        pipeline2.setBorder(border, static_cast<uint8_t>(borderConstant));
+        pipeline2.setRegion(region);
+        
+        StageProfile stats2;
+        if (profile) {
+            pipeline2.setStatsCallback(recordStage, &stats2);
+        }
         
         // Check if convolution is available
         #ifdef HAS_CONVOLUTION
             auto gaussian = ConvolutionFilter::createGaussian(5, 1.0f);
-            auto sharpen = ConvolutionFilter::createSharpen();
+            // Integer weights: the compile-time kernel needs no multiplies
+            auto sharpen = new SharpenFilter();
             
             if (gaussian && sharpen) {
                 pipeline2.addStage(gaussian);
                 pipeline2.addStage(sharpen);
                 
-                std::string out2 = outputPath;
-                if (mode == "all") {
-                    size_t dot = outputPath.find_last_of('.');
-                    if (dot != std::string::npos) {
-                        out2 = outputPath.substr(0, dot) + "_conv.ppm";
-                    } else {
-                        out2 = outputPath + "_conv.ppm";
-                    }
-                }
-                
-                if (pipeline2.run(inputPath.c_str(), out2.c_str())) {
-                    LOG_INFO("Convolution pipeline complete: " << out2);
+                if (execute(pipeline2, inputPath, outputPath, mode == "all" ? "_conv" : "", batch)) {
+                    LOG_INFO("Convolution pipeline complete");
                     pipelinesCompleted++;
                     success = true;
                 }
+                if (profile) {
+                    printProfile("Gaussian Blur -> Sharpen", stats2);
+                }
                 
                 // Pipeline owns the filters, don't delete manually
             } else {
@@ -140,20 +456,106 @@ int main(int argc, char* argv[]) {
             pipeline2.addStage(new SmoothingFilter());
             pipeline2.addStage(new SmoothingFilter());  // Second smoothing as simple blur
             
-            std::string out2 = outputPath;
-            if (mode == "all") {
-                size_t dot = outputPath.find_last_of('.');
-                out2 = outputPath.substr(0, dot) + "_conv.ppm";
-            }
-            
-            if (pipeline2.run(inputPath.c_str(), out2.c_str())) {
-                LOG_INFO("Fallback convolution pipeline complete: " << out2);
+            if (execute(pipeline2, inputPath, outputPath, mode == "all" ? "_conv" : "", batch)) {
+                LOG_INFO("Fallback convolution pipeline complete");
                 pipelinesCompleted++;
                 success = true;
             }
+            if (profile) {
+                printProfile("Smoothing -> Smoothing", stats2);
+            }
         #endif
     }
     
+    // Running-sum pipelines: one window filter of the requested radius
+    if (mode == "box" || mode == "threshold") {
+        bool box = (mode == "box");
+        LOG_INFO("Running: " << (box ? "Box mean" : "Adaptive threshold") << ", radius " << radius);
+        
+        Pipeline pipeline3;
+        pipeline3.setExecutionMode(execMode);
+        pipeline3.setFusion(fusion);
+        pipeline3.setThreadCount(threadCount);
+        pipeline3.setBorder(border, static_cast<uint8_t>(borderConstant));
+        pipeline3.setRegion(region);
+        if (box) {
+            pipeline3.addStage(new BoxFilter(radius));
+        } else {
+            pipeline3.addStage(new AdaptiveThresholdFilter(radius));
+        }
+        
+        StageProfile stats3;
+        if (profile) {
+            pipeline3.setStatsCallback(recordStage, &stats3);
+        }
+        
+        if (execute(pipeline3, inputPath, outputPath, "", batch)) {
+            LOG_INFO("Running-sum pipeline complete");
+            pipelinesCompleted++;
+            success = true;
+        }
+        if (profile) {
+            printProfile(box ? "Box mean" : "Adaptive threshold", stats3);
+        }
+    }
+    
+    // Gaussian blur of any sigma; large ones run as the recursive filter
+    if (mode == "blur") {
+        LOG_INFO("Running: Gaussian blur, sigma " << sigma);
+        
+        Pipeline pipeline4;
+        pipeline4.setExecutionMode(execMode);
+        pipeline4.setFusion(fusion);
+        pipeline4.setThreadCount(threadCount);
+        pipeline4.setBorder(border, static_cast<uint8_t>(borderConstant));
+        pipeline4.setRegion(region);
+        pipeline4.addStage(hardware::filters::createGaussianBlur(sigma));
+        
+        StageProfile stats4;
+        if (profile) {
+            pipeline4.setStatsCallback(recordStage, &stats4);
+        }
+        
+        if (execute(pipeline4, inputPath, outputPath, "", batch)) {
+            LOG_INFO("Blur pipeline complete");
+            pipelinesCompleted++;
+            success = true;
+        }
+        if (profile) {
+            printProfile("Gaussian blur", stats4);
+        }
+    }
+    
+    // Unsharp mask: a dense, non-separable kernel of any size, run
+    // directly or by tiled FFT as planConvolution() decides
+    if (mode == "unsharp") {
+        int size = 0;
+        std::vector<float> kernel = hardware::filters::unsharpMaskKernel(sigma, 1.0f, size);
+        LOG_INFO("Running: Unsharp mask, sigma " << sigma << " (" << size << "x" << size << " kernel)");
+        
+        Pipeline pipeline5;
+        pipeline5.setExecutionMode(execMode);
+        pipeline5.setFusion(fusion);
+        pipeline5.setThreadCount(threadCount);
+        pipeline5.setBorder(border, static_cast<uint8_t>(borderConstant));
+        pipeline5.setRegion(region);
+        pipeline5.addStage(hardware::filters::createConvolution(kernel, size));
+        
+        StageProfile stats5;
+        if (profile) {
+            pipeline5.setStatsCallback(recordStage, &stats5);
+        }
+        
+        if (execute(pipeline5, inputPath, outputPath, "", batch)) {
+            LOG_INFO("Unsharp pipeline complete");
+            pipelinesCompleted++;
+            success = true;
+        }
+        if (profile) {
+            printProfile("Unsharp mask", stats5);
+        }
+    }
+    
     // Final status
     if (success && pipelinesCompleted > 0) {
         LOG_INFO("Successfully completed " << pipelinesCompleted << " pipeline(s)");
@@ -1,15 +1,237 @@
 #include "pipeline.h"
 #include "io.h"
+#include "lazy_evaluator.h"
 #include "colour_converter.h"
 #include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace hardware
 {
     namespace pipeline
     {
 
+        namespace
+        {
+            double wallClock()
+            {
+                return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            double cpuClock()
+            {
+                timespec ts;
+                clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+                return ts.tv_sec + ts.tv_nsec * 1e-9;
+            }
+
+            // Wall and CPU time summed over one or more intervals. Inert
+            // unless enabled, so an unprofiled run never reads a clock.
+            struct StageProbe
+            {
+                bool enabled;
+                double wall;
+                double cpu;
+                double wallStart;
+                double cpuStart;
+
+                explicit StageProbe(bool on = false)
+                    : enabled(on), wall(0.0), cpu(0.0), wallStart(0.0), cpuStart(0.0) {}
+
+                void start()
+                {
+                    if (enabled)
+                    {
+                        wallStart = wallClock();
+                        cpuStart = cpuClock();
+                    }
+                }
+
+                void stop()
+                {
+                    if (enabled)
+                    {
+                        wall += wallClock() - wallStart;
+                        cpu += cpuClock() - cpuStart;
+                    }
+                }
+            };
+
+            StageStats stageStats(const char *name, int index, const StageProbe &probe,
+                                  size_t inputBytes, size_t outputBytes, int width, int height)
+            {
+                return {name, index, probe.wall, probe.cpu, inputBytes, outputBytes, width, height};
+            }
+
+            size_t fileSize(const char *path)
+            {
+                struct stat info;
+                return (path && stat(path, &info) == 0) ? static_cast<size_t>(info.st_size) : 0;
+            }
+
+            // Per-stage state of the streaming engine: the stage's input line
+            // buffer and how many rows have entered and left it
+            template <typename T>
+            struct StreamStage
+            {
+                filters::BaseFilter *filter;
+                int radius;
+                memory::LineBuffer<T> lines;
+                int received;
+                int emitted;
+                std::vector<const T *> window;
+                StageProbe probe;
+                std::vector<T> constantRow;     // Window row outside the frame (CONSTANT border)
+            };
+
+            // Where the streaming engine puts the last stage's rows: a packed
+            // frame...
+            template <typename T>
+            struct FrameSink
+            {
+                T *frame;
+                int width;
+
+                T *row(int y) const { return frame + static_cast<size_t>(y) * width; }
+                bool done(int) const { return true; }
+            };
+
+            // ...or one row, handed to a RowWriter as soon as it is finished.
+            // Rows outside [first, last) and the `skip` samples on the left
+            // are a region's halo and are dropped.
+            template <typename T>
+            struct WriterSink
+            {
+                RowWriter *writer;
+                T *line;
+                StageProbe *probe;
+                int first;
+                int last;
+                int skip;
+
+                T *row(int) const { return line; }
+                bool done(int y) const
+                {
+                    if (y < first || y >= last)
+                        return true;
+                    probe->start();
+                    bool ok = writer->writeRow(line + skip);
+                    probe->stop();
+                    return ok;
+                }
+            };
+
+            // Emit every row the stage can produce with the lines it holds and
+            // push each one straight into the next stage; false if the sink
+            // failed to take a row
+            template <typename T, typename Sink>
+            bool drainStage(std::vector<StreamStage<T>> &chain, size_t index, const Sink &sink, int width, int height,
+                            filters::BorderMode border, uint8_t constant)
+            {
+                StreamStage<T> &stage = chain[index];
+                bool last = (index + 1 == chain.size());
+                bool padded = (border != filters::BorderMode::COPY);
+
+                while (stage.emitted < height &&
+                       (stage.emitted + stage.radius < stage.received || stage.received == height))
+                {
+                    int y = stage.emitted;
+                    int lineCount = 2 * stage.radius + 1;
+                    for (int i = 0; i < lineCount; i++)
+                    {
+                        // Rows past the edge map through the border mode; the
+                        // ones it needs are still held in the line buffer
+                        int row = padded ? filters::borderIndex(border, y - stage.radius + i, height)
+                                         : std::min(std::max(y - stage.radius + i, 0), height - 1);
+                        stage.window[i] = (row < 0) ? stage.constantRow.data() + stage.radius
+                                                    : stage.lines.line(row);
+                    }
+
+                    T *dest = last ? sink.row(y) : chain[index + 1].lines.line(y);
+                    filters::BasicRowBand<T> band = {stage.window.data(), dest, width, y, y + 1,
+                                                     width, height, stage.radius, border, constant};
+                    stage.probe.start();
+                    stage.filter->processRows(band);
+                    stage.probe.stop();
+                    stage.emitted++;
+
+                    if (last)
+                    {
+                        if (!sink.done(y))
+                            return false;
+                    }
+                    else
+                    {
+                        if (padded)
+                            filters::fillRowApron(dest, width, chain[index + 1].radius, border, constant);
+                        chain[index + 1].received = y + 1;
+                        if (!drainStage(chain, index + 1, sink, width, height, border, constant))
+                            return false;
+                    }
+                }
+                return true;
+            }
+
+            // Grayscale rows [y0, y1) of a view into rows `stride` elements apart
+            template <typename T>
+            void convertRows(const filters::ImageView &source, T *output, int stride, int y0, int y1)
+            {
+                if (source.packed() && stride == source.width)
+                {
+                    convertToGrayscale(source.row(y0), output + static_cast<size_t>(y0) * stride, source.width,
+                                       y1 - y0);
+                    return;
+                }
+                for (int y = y0; y < y1; y++)
+                {
+                    convertToGrayscale(source.row(y), output + static_cast<size_t>(y) * stride, source.width, 1);
+                }
+            }
+
+            // Move the w x h rectangle at (x, y) of a packed frame to its
+            // start, packed; rows only move toward the front
+            template <typename T>
+            void cropInPlace(T *frame, int width, int x, int y, int w, int h)
+            {
+                for (int i = 0; i < h; i++)
+                {
+                    memmove(frame + static_cast<size_t>(i) * w, frame + static_cast<size_t>(y + i) * width + x,
+                            static_cast<size_t>(w) * sizeof(T));
+                }
+            }
+
+            // Whole-frame stage invocation for the serial path
+            void applyStage(filters::BaseFilter *stage, pixel *input, pixel *output, int width, int height)
+            {
+                stage->apply(input, output, width, height);
+            }
+
+            void applyStage(filters::BaseFilter *stage, uint8_t *input, uint8_t *output, int width, int height)
+            {
+                stage->applyGray(input, output, width, height);
+            }
+        }
+
         Pipeline::Pipeline()
+            : stageCallback(nullptr), callbackUserData(nullptr),
+              statsCallback(nullptr), statsUserData(nullptr),
+              executionMode(ExecutionMode::FRAME),
+              borderMode(filters::BorderMode::COPY), borderConstant(0),
+              bufferPool(std::make_shared<hardware::memory::BufferPool>()),
+              fusionEnabled(true)
         {
+#ifdef HW_SIMULATION
+            simulatedCycles = 0;
+            modelWidth = IMAGE_WIDTH;
+            modelHeight = IMAGE_HEIGHT;
+#endif
             LOG_INFO("Pipeline constructor");
         }
 
@@ -35,6 +257,10 @@ namespace hardware
         void Pipeline::clearStages()
         {
             LOG_INFO("Clearing " << stages.size() << " stages");
+            framePlan.clear();
+            planStages.clear();
+            planRadii.clear();
+            fusedStages.clear();
             for (size_t i = 0; i < stages.size(); i++)
             {
                 if (stages[i])
@@ -48,49 +274,1068 @@ namespace hardware
             LOG_INFO("All stages cleared");
         }
 
+        void Pipeline::setBufferPool(std::shared_ptr<hardware::memory::BufferPool> pool)
+        {
+            if (pool)
+            {
+                bufferPool = std::move(pool);
+            }
+            else
+            {
+                LOG_ERROR("Attempted to set null buffer pool");
+            }
+        }
+
+        void Pipeline::setThreadCount(int count)
+        {
+            if (count <= 0)
+            {
+                count = static_cast<int>(std::thread::hardware_concurrency());
+            }
+
+            if (count <= 1)
+            {
+                threadPool.reset();
+            }
+            else if (getThreadCount() != count)
+            {
+                threadPool.reset(new ThreadPool(count));
+            }
+            LOG_INFO("Pipeline using " << getThreadCount() << " thread(s)");
+        }
+
+        template <typename Body>
+        void Pipeline::forEachBand(int height, const Body &body, int granularity)
+        {
+            if (!threadPool)
+            {
+                body(0, height);
+                return;
+            }
+
+            // A few bands per thread keeps the load balanced across stages.
+            // Band edges fall on multiples of the granularity. The task
+            // captures a single reference so std::function never has to
+            // allocate for it.
+            int units = (height + granularity - 1) / granularity;
+            struct Split
+            {
+                int height;
+                int units;
+                int granularity;
+                int bands;
+                const Body *body;
+            } split = {height, units, granularity, std::min(units, threadPool->getThreadCount() * 4), &body};
+
+            threadPool->parallelFor(split.bands, [&split](int band) {
+                long long u0 = static_cast<long long>(split.units) * band / split.bands;
+                long long u1 = static_cast<long long>(split.units) * (band + 1) / split.bands;
+                int y0 = static_cast<int>(std::min<long long>(u0 * split.granularity, split.height));
+                int y1 = static_cast<int>(std::min<long long>(u1 * split.granularity, split.height));
+                (*split.body)(y0, y1);
+            });
+        }
+
+        bool Pipeline::grayChain() const
+        {
+            for (auto stage : stages)
+            {
+                if (!stage->supportsFormat(filters::PixelFormat::GRAY8))
+                    return false;
+            }
+            return true;
+        }
+
+        const std::vector<filters::BaseFilter *> &Pipeline::frameStages()
+        {
+            if (!fusionEnabled)
+                return stages;
+
+            bool current = (planStages == stages);
+            for (size_t i = 0; current && i < stages.size(); i++)
+            {
+                current = planRadii[i] == stages[i]->getRadius();
+            }
+            if (current)
+                return framePlan;
+
+            framePlan.clear();
+            fusedStages.clear();
+            planStages = stages;
+            planRadii.clear();
+            for (auto stage : stages)
+            {
+                planRadii.push_back(stage->getRadius());
+            }
+
+            // Greedily grow each group while its combined footprint stays
+            // small enough that the rolling ring stays in cache
+            for (size_t i = 0; i < stages.size();)
+            {
+                filters::BaseFilter *group = stages[i];
+                int radius = planRadii[i];
+                size_t next = i + 1;
+                while (next < stages.size() && radius + planRadii[next] <= MAX_FUSED_RADIUS)
+                {
+                    fusedStages.emplace_back(new filters::FusedFilter(group, stages[next]));
+                    group = fusedStages.back().get();
+                    radius += planRadii[next];
+                    next++;
+                }
+                framePlan.push_back(group);
+                i = next;
+            }
+
+            LOG_INFO("Frame plan: " << stages.size() << " stage(s) in " << framePlan.size() << " pass(es)");
+            return framePlan;
+        }
+
+        bool Pipeline::regionWindow(int width, int height, Region &area, Region &window) const
+        {
+            area = {0, 0, width, height};
+            window = area;
+            if (region.empty())
+                return true;
+
+            int x0 = std::max(region.x, 0);
+            int y0 = std::max(region.y, 0);
+            int x1 = std::min(region.x + region.width, width);
+            int y1 = std::min(region.y + region.height, height);
+            if (x0 >= x1 || y0 >= y1)
+            {
+                std::cerr << "Error: Region " << region.width << "x" << region.height << "+" << region.x << "+"
+                          << region.y << " lies outside the " << width << "x" << height << " frame" << std::endl;
+                return false;
+            }
+            area = {x0, y0, x1 - x0, y1 - y0};
+
+            // Every output sample depends on input within the chain's summed
+            // radius; the window starts on the block filters' grid, as in
+            // runTiled, and spans whole rows if any stage needs them
+            int halo = 0;
+            int grain = 1;
+            bool wholeRows = false;
+            for (auto stage : stages)
+            {
+                halo += stage->getRadius();
+                grain = std::lcm(grain, stage->getRowGranularity());
+                wholeRows = wholeRows || stage->needsWholeRows();
+            }
+            if (wholeRows)
+            {
+                x0 = 0;
+                x1 = width;
+            }
+            window.x = std::max(0, x0 - halo) / grain * grain;
+            window.y = std::max(0, y0 - halo) / grain * grain;
+            window.width = std::min(width, x1 + halo) - window.x;
+            window.height = std::min(height, y1 + halo) - window.y;
+            return true;
+        }
+
+        bool Pipeline::allocateBuffers(FrameJob &job, bool gray, const filters::ImageView &input)
+        {
+            int width = input.width;
+            int height = input.height;
+
+            // Padded frame mode: stage inputs live in apron-padded buffers
+            // (one unless the plan has intermediates) and only the result is packed
+            bool frameMode = executionMode != ExecutionMode::STREAMING;
+            int paddedCount = 0;
+            int apron = 0;
+            if (frameMode && borderMode != filters::BorderMode::COPY)
+            {
+                const std::vector<filters::BaseFilter *> &plan = frameStages();
+                paddedCount = std::min(static_cast<int>(plan.size()), 2);
+                for (auto stage : plan)
+                {
+                    apron = std::max(apron, stage->getRadius());
+                }
+            }
+
+            if (gray)
+            {
+                job.plane = hardware::memory::GrayPlane(width, height, *bufferPool);
+                if (frameMode && !paddedCount)
+                    job.scratch = hardware::memory::GrayPlane(width, height, *bufferPool);
+                for (int i = 0; i < paddedCount; i++)
+                {
+                    job.paddedPlanes[i] = hardware::memory::GrayPlane(width, height, apron, *bufferPool, true);
+                    if (!job.paddedPlanes[i].getData())
+                        return false;
+                }
+                return job.plane.getData() &&
+                       (!frameMode || paddedCount || job.scratch.getData());
+            }
+
+            job.output = hardware::memory::FrameBuffer(width, height, *bufferPool);
+            for (int i = 0; i < paddedCount; i++)
+            {
+                job.paddedFrames[i] = hardware::memory::FrameBuffer(width, height, apron, *bufferPool, true);
+                if (!job.paddedFrames[i].getData())
+                    return false;
+            }
+
+            // Unpadded frame runs convert in place, which a strided region can't
+            if (frameMode && !paddedCount && !input.packed())
+            {
+                job.window = hardware::memory::FrameBuffer(width, height, *bufferPool);
+                if (!job.window.getData())
+                    return false;
+            }
+            return job.output.getData() != nullptr;
+        }
+
         bool Pipeline::run(const char *inputPath, const char *outputPath)
         {
             LOG_INFO("Pipeline run started");
 
+            // Streaming runs never hold a whole frame: rows go from the
+            // reader through the stages' line buffers to the writer
+            if (executionMode == ExecutionMode::STREAMING)
+                return streamFile(inputPath, outputPath);
+            if (executionMode == ExecutionMode::LAZY)
+                return runLazy(inputPath, outputPath);
+
+            // Tiled images may not fit in memory: frame mode runs per tile
+            if (isTiledImage(inputPath))
+            {
+                if (!region.empty())
+                {
+                    std::cerr << "Error: Regions of interest of tiled images need --exec=lazy" << std::endl;
+                    return false;
+                }
+                return runTiled(inputPath, outputPath);
+            }
+
+            FrameJob job(inputPath, outputPath);
+            if (!decode(job))
+                return false;
+
+#ifdef HW_SIMULATION
+            double start = wallClock();
+            if (!process(job))
+                return false;
+            reportHardwareModel(wallClock() - start);
+#else
+            if (!process(job))
+                return false;
+#endif
+
+            return encode(job);
+        }
+
+        bool Pipeline::decode(FrameJob &job)
+        {
             FrameReader reader;
+            StageProbe probe(isProfiling());
+
+            notifyStage("decode");
+            probe.start();
+            if (!reader.mapImage(job.inputPath, job.format, job.source, bufferPool.get()))
+            {
+                LOG_ERROR("Failed to load image");
+                return false;
+            }
+            probe.stop();
+
+            int width = job.source.getWidth();
+            int height = job.source.getHeight();
+            if (probe.enabled)
+            {
+                reportStage(stageStats("decode", 0, probe, fileSize(job.inputPath),
+                                       static_cast<size_t>(width) * height * sizeof(pixel), width, height));
+            }
+
+            LOG_INFO("Image loaded: " << width << "x" << height);
+            return true;
+        }
+
+        bool Pipeline::process(FrameJob &job)
+        {
+            // Stages read the window (the region and its halo) where it lies
+            // in the decoded frame
+            Region area, window;
+            if (!regionWindow(job.source.getWidth(), job.source.getHeight(), area, window))
+            {
+                job.release();
+                return false;
+            }
+            filters::ImageView input = job.source.view(window.x, window.y, window.width, window.height);
+            if (!region.empty())
+            {
+                LOG_INFO("Region " << area.width << "x" << area.height << "+" << area.x << "+" << area.y
+                                   << ", window " << window.width << "x" << window.height);
+            }
+
+#ifdef HW_SIMULATION
+            modelWidth = window.width;
+            modelHeight = window.height;
+#endif
+
+            if (grayChain())
+            {
+                // Everything after grayscale conversion carries one byte per pixel
+                LOG_INFO("Running " << stages.size() << " stage(s) on a gray plane");
+                if (!allocateBuffers(job, true, input))
+                {
+                    LOG_ERROR("Failed to allocate gray planes");
+                    job.release();
+                    return false;
+                }
+
+                if (executionMode == ExecutionMode::STREAMING)
+                    job.grayResult = runStreaming(input, job.plane.getData());
+                else if (borderMode != filters::BorderMode::COPY)
+                    job.grayResult = runFramePadded(input, job.paddedPlanes, job.plane.getData());
+                else
+                    job.grayResult = runFrame(input, job.plane.getData(), job.scratch.getData());
+            }
+            else
+            {
+                if (!allocateBuffers(job, false, input))
+                {
+                    LOG_ERROR("Failed to allocate output buffer");
+                    job.release();
+                    return false;
+                }
+
+                pixel *frame = input.packed() ? input.data : job.window.getData();
+                if (executionMode == ExecutionMode::STREAMING)
+                    job.rgbResult = runStreaming(input, job.output.getData());
+                else if (borderMode != filters::BorderMode::COPY)
+                    job.rgbResult = runFramePadded(input, job.paddedFrames, job.output.getData());
+                else
+                    job.rgbResult = runFrame(input, frame, job.output.getData());
+            }
+
+            // The region's pixels are the window's minus the halo
+            if (area.width != window.width || area.height != window.height)
+            {
+                int left = area.x - window.x;
+                int top = area.y - window.y;
+                if (job.grayResult)
+                    cropInPlace(job.grayResult, window.width, left, top, area.width, area.height);
+                else
+                    cropInPlace(job.rgbResult, window.width, left, top, area.width, area.height);
+            }
+            job.resultWidth = area.width;
+            job.resultHeight = area.height;
+
+            job.stagesRun = static_cast<int>(executionMode == ExecutionMode::STREAMING ? stages.size()
+                                                                                      : frameStages().size());
+            return true;
+        }
+
+        bool Pipeline::encode(FrameJob &job)
+        {
             FrameWriter writer;
+            int width = job.resultWidth;
+            int height = job.resultHeight;
+            StageProbe probe(isProfiling());
 
-            int width = 0, height = 0;
-            pixel *frame = reader.loadImage(inputPath, width, height);
+            // Output keeps the input's encoding unless its extension asks
+            // for another (see formatForPath)
+            ImageFormat format = formatForPath(job.outputPath, job.format, job.grayResult != nullptr);
+            notifyStage("encode");
+            probe.start();
+            bool saveSuccess = false;
+            size_t resultBytes = 0;
+            if (job.grayResult)
+            {
+                saveSuccess = writer.saveImage(job.outputPath, job.grayResult, width, height, format);
+                resultBytes = static_cast<size_t>(width) * height;
+            }
+            else if (job.rgbResult)
+            {
+                saveSuccess = writer.saveImage(job.outputPath, job.rgbResult, width, height, format);
+                resultBytes = static_cast<size_t>(width) * height * sizeof(pixel);
+            }
+            else
+            {
+                LOG_ERROR("Nothing to encode for " << job.outputPath);
+            }
+            probe.stop();
+
+            if (probe.enabled && saveSuccess)
+            {
+                reportStage(stageStats("encode", job.stagesRun + 2, probe, resultBytes,
+                                       fileSize(job.outputPath), width, height));
+            }
+
+            job.release();
+            return saveSuccess;
+        }
+
+        template <typename T>
+        T *Pipeline::runFrame(const filters::ImageView &source, T *frame, T *scratch)
+        {
+            int width = source.width;
+            int height = source.height;
+            T *input = frame;
+            T *output = scratch;
+            const std::vector<filters::BaseFilter *> &plan = frameStages();
+            size_t sourceBytes = static_cast<size_t>(width) * height * sizeof(pixel);
+            size_t frameBytes = static_cast<size_t>(width) * height * sizeof(T);
+
+            StageProbe probe(isProfiling());
+            notifyStage("grayscale");
+            probe.start();
+            if (!threadPool)
+            {
+                convertRows(source, frame, width, 0, height);
+            }
+            else
+            {
+                forEachBand(height, [&](int y0, int y1) {
+                    convertRows(source, frame, width, y0, y1);
+                });
+            }
+            probe.stop();
+            if (probe.enabled)
+                reportStage(stageStats("grayscale", 1, probe, sourceBytes, frameBytes, width, height));
+
+            if (!threadPool)
+            {
+                for (size_t i = 0; i < plan.size(); i++)
+                {
+                    probe = StageProbe(probe.enabled);
+                    notifyStage(plan[i]->getName());
+                    probe.start();
+                    applyStage(plan[i], input, output, width, height);
+                    probe.stop();
+                    if (probe.enabled)
+                        reportStage(stageStats(plan[i]->getName(), static_cast<int>(i) + 2, probe,
+                                               frameBytes, frameBytes, width, height));
+                    std::swap(input, output);
+                }
+
+                return input;
+            }
+
+            // Each band reads its halo rows straight from the shared input frame
+            thread_local std::vector<const T *> rows;
+            for (size_t i = 0; i < plan.size(); i++)
+            {
+                filters::BaseFilter *stage = plan[i];
+                probe = StageProbe(probe.enabled);
+                notifyStage(stage->getName());
+                probe.start();
+
+                stage->beginFrame();
+                int radius = stage->getRadius();
+                rows.resize(height + 2 * radius);
+                filters::clampedRowPointers<T>(input, width, height, -radius, height + 2 * radius, rows.data());
+
+                // Workers see their own thread_local instance: hand them the caller's table
+                const T *const *table = rows.data();
+                forEachBand(height, [&](int y0, int y1) {
+                    filters::BasicRowBand<T> band = {table + y0, output + y0 * width, width,
+                                                     y0, y1, width, height, radius};
+                    stage->processRows(band);
+                }, stage->getRowGranularity());
+
+                probe.stop();
+                if (probe.enabled)
+                    reportStage(stageStats(stage->getName(), static_cast<int>(i) + 2, probe,
+                                           frameBytes, frameBytes, width, height));
+                std::swap(input, output);
+            }
+
+            return input;
+        }
+
+        template <typename T, typename Buffer>
+        T *Pipeline::runFramePadded(const filters::ImageView &source, Buffer (&padded)[2], T *result)
+        {
+            int width = source.width;
+            int height = source.height;
+            const std::vector<filters::BaseFilter *> &plan = frameStages();
+            size_t sourceBytes = static_cast<size_t>(width) * height * sizeof(pixel);
+            size_t frameBytes = static_cast<size_t>(width) * height * sizeof(T);
+
+            // With no stages the converted frame is the result
+            T *converted = plan.empty() ? result : padded[0].getData();
+            int convertedStride = plan.empty() ? width : padded[0].getStride();
+
+            StageProbe probe(isProfiling());
+            notifyStage("grayscale");
+            probe.start();
+            forEachBand(height, [&](int y0, int y1) {
+                convertRows(source, converted, convertedStride, y0, y1);
+            });
+            probe.stop();
+            if (probe.enabled)
+                reportStage(stageStats("grayscale", 1, probe, sourceBytes, frameBytes, width, height));
+
+            thread_local std::vector<const T *> rows;
+            for (size_t i = 0; i < plan.size(); i++)
+            {
+                filters::BaseFilter *stage = plan[i];
+                Buffer &input = padded[i % 2];
+                bool last = (i + 1 == plan.size());
+                T *output = last ? result : padded[(i + 1) % 2].getData();
+                int outputStride = last ? width : padded[(i + 1) % 2].getStride();
+
+                probe = StageProbe(probe.enabled);
+                notifyStage(stage->getName());
+                probe.start();
+
+                stage->beginFrame();
+
+                // The apron is filled once per stage; the kernels then read
+                // up to `radius` pixels past every edge without bounds checks
+                int radius = stage->getRadius();
+                input.fillBorder(radius, borderMode, borderConstant);
+                rows.resize(height + 2 * radius);
+                filters::paddedRowPointers<T>(input.getData(), input.getStride(), -radius, height + 2 * radius,
+                                              rows.data());
+
+                const T *const *table = rows.data();
+                forEachBand(height, [&](int y0, int y1) {
+                    filters::BasicRowBand<T> band = {table + y0, output + static_cast<long>(y0) * outputStride,
+                                                     outputStride, y0, y1, width, height, radius,
+                                                     borderMode, borderConstant};
+                    stage->processRows(band);
+                }, stage->getRowGranularity());
+
+                probe.stop();
+                if (probe.enabled)
+                    reportStage(stageStats(stage->getName(), static_cast<int>(i) + 2, probe,
+                                           frameBytes, frameBytes, width, height));
+            }
+
+            return result;
+        }
+
+        template <typename T>
+        T *Pipeline::runStreaming(const filters::ImageView &source, T *output)
+        {
+            notifyStage("grayscale");
+            streamRows<T>(source.width, source.height, [&source](int y) { return source.row(y); },
+                          FrameSink<T>{output, source.width});
+            return output;
+        }
+
+        template <typename T, typename Source, typename Sink>
+        bool Pipeline::streamRows(int width, int height, const Source &source, const Sink &sink)
+        {
+            // Line buffers are kept between runs and only rebuilt when the
+            // frame width, a stage radius or the need for aprons changes
+            thread_local std::vector<StreamStage<T>> chain;
+            bool padded = (borderMode != filters::BorderMode::COPY);
+
+            bool reusable = (chain.size() == stages.size());
+            for (size_t i = 0; reusable && i < stages.size(); i++)
+            {
+                reusable = chain[i].radius == stages[i]->getRadius() &&
+                           chain[i].lines.getWidth() == width &&
+                           chain[i].lines.getApron() == (padded ? chain[i].radius : 0);
+            }
+            if (!reusable)
+            {
+                chain.clear();
+                chain.reserve(stages.size());
+                for (auto stage : stages)
+                {
+                    int radius = stage->getRadius();
+                    chain.push_back({stage, radius,
+                                     memory::LineBuffer<T>(width, 2 * radius + 1, padded ? radius : 0),
+                                     0, 0, std::vector<const T *>(2 * radius + 1), StageProbe(),
+                                     std::vector<T>()});
+                }
+            }
+
+            // Every stage is active at once: announce them all up front
+            size_t lineBytes = 0;
+            for (size_t i = 0; i < chain.size(); i++)
+            {
+                chain[i].filter = stages[i];
+                chain[i].received = 0;
+                chain[i].emitted = 0;
+                chain[i].probe = StageProbe(isProfiling());
+                chain[i].filter->beginFrame();
+                if (borderMode == filters::BorderMode::CONSTANT)
+                {
+                    chain[i].constantRow.assign(width + 2 * chain[i].radius,
+                                                filters::borderSample<T>(borderConstant));
+                }
+                lineBytes += chain[i].lines.getCapacity();
+                notifyStage(stages[i]->getName());
+            }
+
+            LOG_INFO("Streaming " << height << " rows through " << chain.size()
+                                  << " stage(s), line buffers: " << lineBytes << " bytes");
+
+            // Rows enter grayscale-converted into the first stage's line buffer
+            StageProbe convert(isProfiling());
+            for (int y = 0; y < height; y++)
+            {
+                const pixel *input = source(y);
+                if (!input)
+                    return false;
+
+                T *dest = chain.empty() ? sink.row(y) : chain[0].lines.line(y);
+                convert.start();
+                convertToGrayscale(input, dest, width, 1);
+                convert.stop();
+
+                if (chain.empty())
+                {
+                    if (!sink.done(y))
+                        return false;
+                    continue;
+                }
+
+                if (padded)
+                    filters::fillRowApron(dest, width, chain[0].radius, borderMode, borderConstant);
+                chain[0].received = y + 1;
+                if (!drainStage(chain, 0, sink, width, height, borderMode, borderConstant))
+                    return false;
+            }
+
+            // Stages interleave row by row; each one's time is the sum over its rows
+            if (convert.enabled)
+            {
+                size_t frameBytes = static_cast<size_t>(width) * height * sizeof(T);
+                reportStage(stageStats("grayscale", 1, convert, static_cast<size_t>(width) * height * sizeof(pixel),
+                                       frameBytes, width, height));
+                for (size_t i = 0; i < chain.size(); i++)
+                {
+                    reportStage(stageStats(chain[i].filter->getName(), static_cast<int>(i) + 2, chain[i].probe,
+                                           frameBytes, frameBytes, width, height));
+                }
+            }
+
+            return true;
+        }
+
+        bool Pipeline::streamFile(const char *inputPath, const char *outputPath)
+        {
+            RowReader reader;
+            RowWriter writer;
+            StageProbe decodeProbe(isProfiling());
+            StageProbe encodeProbe(isProfiling());
 
-            if (!frame)
+            notifyStage("decode");
+            decodeProbe.start();
+            bool opened = reader.open(inputPath);
+            decodeProbe.stop();
+            if (!opened)
             {
                 LOG_ERROR("Failed to load image");
                 return false;
             }
 
-            LOG_INFO("Image loaded: " << width << "x" << height);
+            // With a region the stages see only its window; rows above it
+            // are read and dropped, rows below it are never read
+            Region area, window;
+            if (!regionWindow(reader.getWidth(), reader.getHeight(), area, window))
+                return false;
+            int width = window.width;
+            int height = window.height;
+            LOG_INFO("Streaming image: " << reader.getWidth() << "x" << reader.getHeight());
+#ifdef HW_SIMULATION
+            modelWidth = width;
+            modelHeight = height;
+            double start = wallClock();
+#endif
+
+            bool gray = grayChain();
+            notifyStage("encode");
+            if (!writer.open(outputPath, formatForPath(outputPath, reader.getFormat(), gray), area.width, area.height))
+                return false;
+
+            // One decoded row and one finished row: the stages' line
+            // buffers hold everything else
+            std::vector<pixel> sourceRow(reader.getWidth());
+            int rowsRead = 0;
+            auto source = [&](int y) -> const pixel * {
+                decodeProbe.start();
+                bool ok = true;
+                while (ok && rowsRead <= window.y + y)
+                {
+                    ok = reader.readRow(sourceRow.data());
+                    rowsRead++;
+                }
+                decodeProbe.stop();
+                return ok ? sourceRow.data() + window.x : nullptr;
+            };
+            int first = area.y - window.y;
+            int last = first + area.height;
+            int skip = area.x - window.x;
+
+            notifyStage("grayscale");
+            bool streamed;
+            if (gray)
+            {
+                std::vector<uint8_t> line(width);
+                streamed = streamRows<uint8_t>(width, height, source,
+                                               WriterSink<uint8_t>{&writer, line.data(), &encodeProbe, first, last,
+                                                                   skip});
+            }
+            else
+            {
+                std::vector<pixel> line(width);
+                streamed = streamRows<pixel>(width, height, source,
+                                             WriterSink<pixel>{&writer, line.data(), &encodeProbe, first, last, skip});
+            }
+
+            encodeProbe.start();
+            bool written = writer.close();
+            encodeProbe.stop();
+            if (!streamed || !written)
+            {
+                // No partial image is left behind, as in frame mode
+                unlink(outputPath);
+                LOG_ERROR("Streaming run failed");
+                return false;
+            }
+
+#ifdef HW_SIMULATION
+            reportHardwareModel(wallClock() - start);
+#endif
 
-            convertToGrayscale(frame, width, height);
+            if (decodeProbe.enabled)
+            {
+                size_t resultBytes = static_cast<size_t>(area.width) * area.height * (gray ? 1 : sizeof(pixel));
+                reportStage(stageStats("decode", 0, decodeProbe, fileSize(inputPath),
+                                       static_cast<size_t>(reader.getWidth()) * reader.getHeight() * sizeof(pixel),
+                                       reader.getWidth(), reader.getHeight()));
+                reportStage(stageStats("encode", static_cast<int>(stages.size()) + 2, encodeProbe, resultBytes,
+                                       fileSize(outputPath), area.width, area.height));
+            }
+            return true;
+        }
 
-            pixel *input = frame;
-            pixel *output = new pixel[width * height];
+        bool Pipeline::runTiled(const char *inputPath, const char *outputPath)
+        {
+            TiledImage input;
+            StageProbe decodeProbe(isProfiling());
+            StageProbe encodeProbe(isProfiling());
 
-            if (!output)
+            notifyStage("decode");
+            if (!input.open(inputPath))
             {
-                LOG_ERROR("Failed to allocate output buffer");
-                delete[] frame;
+                LOG_ERROR("Failed to load image");
                 return false;
             }
 
+            int width = input.getWidth();
+            int height = input.getHeight();
+            int tile = input.getTileSize();
+            bool gray = grayChain();
+            size_t sampleBytes = gray ? 1 : sizeof(pixel);
+
+            // Every output sample depends on input within the chain's summed
+            // radius. Block filters compute whole blocks on a grid from the
+            // frame origin: windows start on a multiple of every stage's
+            // granularity, as LazyEvaluator's do, so the blocks fall where
+            // they do in a whole-frame run.
+            int halo = 0;
+            int grain = 1;
             for (auto stage : stages)
             {
-                stage->apply(input, output, width, height);
-                std::swap(input, output);
+                halo += stage->getRadius();
+                grain = std::lcm(grain, stage->getRowGranularity());
             }
+            LOG_INFO("Tiled image: " << width << "x" << height << " in " << input.getTilesAcross() << "x"
+                                     << input.getTilesDown() << " tiles of " << tile << ", halo " << halo);
+#ifdef HW_SIMULATION
+            double start = wallClock();
+#endif
 
-            bool saveSuccess = writer.saveImage(outputPath, input, width, height);
+            ImageFormat inputFormat = input.getChannels() == 1 ? ImageFormat::TILED_GRAY : ImageFormat::TILED;
+            RowWriter writer;
+            notifyStage("encode");
+            if (!writer.open(outputPath, formatForPath(outputPath, inputFormat, gray), width, height))
+                return false;
 
-            delete[] frame;
-            delete[] output;
+            // One row of finished tiles at a time; windows come from the pool
+            std::vector<uint8_t> band(static_cast<size_t>(width) * tile * sampleBytes);
+            FrameJob job(inputPath, outputPath);
+            int released = 0;
+            bool ok = true;
+            for (int ty = 0; ty < input.getTilesDown() && ok; ty++)
+            {
+                int y0 = ty * tile;
+                int y1 = std::min(height, y0 + tile);
+                int windowTop = std::max(0, y0 - halo) / grain * grain;
+                int windowBottom = std::min(height, y1 + halo);
 
-            return saveSuccess;
+                for (int tx = 0; tx < input.getTilesAcross() && ok; tx++)
+                {
+                    int x0 = tx * tile;
+                    int x1 = std::min(width, x0 + tile);
+                    int windowLeft = std::max(0, x0 - halo) / grain * grain;
+                    int windowWidth = std::min(width, x1 + halo) - windowLeft;
+                    int windowHeight = windowBottom - windowTop;
+
+                    // The tile and its halo, gathered from the neighbouring tiles
+                    decodeProbe.start();
+                    job.source = hardware::memory::FrameBuffer(windowWidth, windowHeight, *bufferPool);
+                    ok = job.source.getData() != nullptr;
+                    if (ok)
+                        input.readRegion(windowLeft, windowTop, windowWidth, windowHeight, job.source.getData(),
+                                         windowWidth);
+                    decodeProbe.stop();
+                    if (!ok || !process(job))
+                    {
+                        ok = false;
+                        break;
+                    }
+
+                    const uint8_t *result = job.grayResult ? job.grayResult
+                                                           : reinterpret_cast<const uint8_t *>(job.rgbResult);
+                    for (int y = y0; y < y1; y++)
+                    {
+                        const uint8_t *src = result + (static_cast<size_t>(y - windowTop) * windowWidth +
+                                                       (x0 - windowLeft)) * sampleBytes;
+                        memcpy(band.data() + (static_cast<size_t>(y - y0) * width + x0) * sampleBytes, src,
+                               static_cast<size_t>(x1 - x0) * sampleBytes);
+                    }
+                    job.release();
+                }
+
+                encodeProbe.start();
+                for (int y = y0; y < y1 && ok; y++)
+                {
+                    const uint8_t *row = band.data() + static_cast<size_t>(y - y0) * width * sampleBytes;
+                    ok = gray ? writer.writeRow(row) : writer.writeRow(reinterpret_cast<const pixel *>(row));
+                }
+                encodeProbe.stop();
+
+                // Input rows above the next windows are not read again
+                int needed = std::max(0, y1 - halo) / grain * grain / tile;
+                input.releaseTileRows(released, needed);
+                released = std::max(released, needed);
+            }
+
+            encodeProbe.start();
+            bool written = writer.close();
+            encodeProbe.stop();
+            if (!ok || !written)
+            {
+                unlink(outputPath);
+                LOG_ERROR("Tiled run failed");
+                return false;
+            }
+
+#ifdef HW_SIMULATION
+            modelWidth = width;
+            modelHeight = height;
+            reportHardwareModel(wallClock() - start);
+#endif
+
+            if (decodeProbe.enabled)
+            {
+                reportStage(stageStats("decode", 0, decodeProbe, fileSize(inputPath),
+                                       static_cast<size_t>(width) * height * sizeof(pixel), width, height));
+                reportStage(stageStats("encode", static_cast<int>(frameStages().size()) + 2, encodeProbe,
+                                       static_cast<size_t>(width) * height * sampleBytes, fileSize(outputPath),
+                                       width, height));
+            }
+            return true;
+        }
+
+        bool Pipeline::runLazy(const char *inputPath, const char *outputPath)
+        {
+            LazyEvaluator evaluator(*this);
+            notifyStage("decode");
+            if (!evaluator.open(inputPath))
+            {
+                LOG_ERROR("Failed to load image");
+                return false;
+            }
+
+            Region area, window;
+            if (!regionWindow(evaluator.getWidth(), evaluator.getHeight(), area, window))
+                return false;
+            std::vector<Region> levels = evaluator.footprint(area);
+            LOG_INFO("Lazy evaluation: " << area.width << "x" << area.height << "+" << area.x << "+" << area.y
+                                         << " of " << evaluator.getWidth() << "x" << evaluator.getHeight()
+                                         << ", input needed " << levels[0].width << "x" << levels[0].height << "+"
+                                         << levels[0].x << "+" << levels[0].y);
+#ifdef HW_SIMULATION
+            double start = wallClock();
+#endif
+
+            bool gray = evaluator.isGray();
+            RowWriter writer;
+            notifyStage("encode");
+            if (!writer.open(outputPath, formatForPath(outputPath, evaluator.getFormat(), gray), area.width,
+                             area.height))
+                return false;
+
+            // One strip of result tiles at a time, written as it is finished
+            int strip = evaluator.getTileSize();
+            size_t sampleBytes = gray ? 1 : sizeof(pixel);
+            std::vector<uint8_t> rows(static_cast<size_t>(area.width) * strip * sampleBytes);
+            bool ok = true;
+            for (int y0 = area.y; y0 < area.y + area.height && ok; y0 += strip)
+            {
+                Region band = {area.x, y0, area.width, std::min(strip, area.y + area.height - y0)};
+                ok = gray ? evaluator.request(band, rows.data(), area.width)
+                          : evaluator.request(band, reinterpret_cast<pixel *>(rows.data()), area.width);
+                for (int y = 0; y < band.height && ok; y++)
+                {
+                    const uint8_t *row = rows.data() + static_cast<size_t>(y) * area.width * sampleBytes;
+                    ok = gray ? writer.writeRow(row) : writer.writeRow(reinterpret_cast<const pixel *>(row));
+                }
+            }
+
+            bool written = writer.close();
+            if (!ok || !written)
+            {
+                unlink(outputPath);
+                LOG_ERROR("Lazy run failed");
+                return false;
+            }
+
+            for (int level = 0; level <= static_cast<int>(stages.size()); level++)
+            {
+                LOG_INFO("Lazy level " << level << " (" << (level ? stages[level - 1]->getName() : "grayscale")
+                                       << "): " << evaluator.getTilesComputed(level) << " tile(s) computed");
+            }
+            LOG_INFO("Lazy tile cache: " << evaluator.getCacheHits() << " hit(s), " << evaluator.getCachedBytes()
+                                         << " bytes held");
+
+#ifdef HW_SIMULATION
+            modelWidth = area.width;
+            modelHeight = area.height;
+            reportHardwareModel(wallClock() - start);
+#endif
+            return true;
+        }
+
+#ifdef HW_SIMULATION
+        simulation::FrameEstimate Pipeline::estimateHardware() const
+        {
+            // Grayscale conversion is the datapath's first stage; the
+            // filters follow unfused, one hardware stage each
+            int bytesPerPixel = grayChain() ? 1 : static_cast<int>(sizeof(pixel));
+            std::vector<simulation::StageDescription> model;
+            model.push_back({"grayscale", 0, 3, bytesPerPixel});
+            for (auto stage : stages)
+            {
+                model.push_back({stage->getName(), stage->getRadius(), stage->getMultiplierCount(), bytesPerPixel});
+            }
+
+            return simulation::estimateFrame(model, modelWidth, modelHeight, sizeof(pixel));
+        }
+
+        void Pipeline::simulateClockCycles(int cycles)
+        {
+            if (cycles <= 0)
+            {
+                LOG_WARNING("Ignoring non-positive cycle count " << cycles);
+                return;
+            }
+            simulatedCycles += cycles;
+
+            // Frames leave one latency after the first pixel, then one per frame interval
+            simulation::FrameEstimate estimate = estimateHardware();
+            long long frames = 0;
+            long long rows = 0;
+            if (simulatedCycles >= estimate.latencyCycles)
+            {
+                long long since = simulatedCycles - estimate.latencyCycles;
+                frames = 1 + since / estimate.frameCycles;
+                rows = (since % estimate.frameCycles) * estimate.height / estimate.frameCycles;
+            }
+
+            std::cout << "[HW] Clock at cycle " << simulatedCycles << " (+" << cycles << "): "
+                      << frames << " frame(s) out, " << rows << "/" << estimate.height
+                      << " rows of the next" << std::endl;
+        }
+
+        void Pipeline::dumpPipelineRegisters() const
+        {
+            simulation::FrameEstimate estimate = estimateHardware();
+
+            // REGISTER_WIDTH-bit registers, first NUM_HW_REGISTERS of them
+            struct Register
+            {
+                std::string name;
+                long long value;
+            };
+            std::vector<Register> registers = {
+                {"CYCLE_COUNT", simulatedCycles},
+                {"STAGE_COUNT", static_cast<long long>(estimate.stages.size())},
+                {"FRAME_WIDTH", estimate.width},
+                {"FRAME_HEIGHT", estimate.height},
+                {"FRAME_CYCLES", estimate.frameCycles},
+                {"FILL_CYCLES", estimate.fillCycles},
+                {"LATENCY_CYCLES", estimate.latencyCycles},
+                {"BRAM18_BLOCKS", estimate.bram18},
+                {"DSP_SLICES", estimate.dsp},
+            };
+            for (size_t i = 0; i < estimate.stages.size(); i++)
+            {
+                registers.push_back({"STAGE" + std::to_string(i) + "_FIFO_ROWS", estimate.stages[i].fifoRows});
+            }
+
+            const unsigned long long mask = (1ULL << REGISTER_WIDTH) - 1;
+            std::cout << "[HW] Pipeline registers:" << std::endl;
+            for (size_t i = 0; i < registers.size() && i < static_cast<size_t>(NUM_HW_REGISTERS); i++)
+            {
+                std::cout << "[HW]   R" << std::setw(2) << std::left << i << std::right << " "
+                          << std::setw(24) << std::left << registers[i].name << std::right
+                          << " = 0x" << std::hex << std::setw(REGISTER_WIDTH / 4) << std::setfill('0')
+                          << (static_cast<unsigned long long>(registers[i].value) & mask)
+                          << std::dec << std::setfill(' ') << std::endl;
+            }
+        }
+
+        int Pipeline::estimateResourceUsage() const
+        {
+            simulation::FrameEstimate estimate = estimateHardware();
+
+            std::cout << "[HW] Resources at " << estimate.width << "x" << estimate.height << ":" << std::endl;
+            for (const simulation::StageEstimate &stage : estimate.stages)
+            {
+                std::cout << "[HW]   " << std::setw(20) << std::left << stage.name << std::right
+                          << " line rows " << std::setw(2) << stage.lineBufferRows
+                          << "  fifo rows " << std::setw(2) << stage.fifoRows
+                          << "  BRAM18 " << std::setw(4) << stage.bram18
+                          << "  DSP " << std::setw(3) << stage.dsp << std::endl;
+            }
+            std::cout << "[HW]   total: " << estimate.bram18 << " BRAM18, " << estimate.dsp << " DSP" << std::endl;
+            return estimate.bram18;
+        }
+
+        void Pipeline::reportHardwareModel(double softwareSeconds) const
+        {
+            simulation::HardwareParams params;
+            simulation::FrameEstimate estimate = estimateHardware();
+
+            std::cout << "[HW] Modelled datapath at " << params.clockMHz << " MHz, "
+                      << params.cyclesPerPixel << " cycles/pixel, " << estimate.width << "x" << estimate.height
+                      << std::endl;
+            for (const simulation::StageEstimate &stage : estimate.stages)
+            {
+                std::cout << "[HW]   " << std::setw(20) << std::left << stage.name << std::right
+                          << " busy " << std::setw(10) << stage.busyCycles
+                          << "  fill " << std::setw(8) << stage.fillCycles
+                          << "  fifo rows " << stage.fifoRows
+                          << "  BRAM18 " << stage.bram18 << "  DSP " << stage.dsp << std::endl;
+            }
+            std::cout << std::fixed << std::setprecision(3)
+                      << "[HW]   frame " << estimate.frameCycles << " cycles ("
+                      << estimate.cyclesToMs(estimate.frameCycles, params) << " ms, "
+                      << std::setprecision(1) << estimate.framesPerSecond << " fps, " << estimate.bottleneck
+                      << " bound)" << std::setprecision(3)
+                      << ", fill " << estimate.cyclesToMs(estimate.fillCycles, params) << " ms"
+                      << ", latency " << estimate.cyclesToMs(estimate.latencyCycles, params) << " ms"
+                      << std::endl;
+            std::cout << "[HW]   software " << softwareSeconds * 1e3 << " ms for the same frame ("
+                      << std::setprecision(2)
+                      << (estimate.frameCycles > 0 ? softwareSeconds * 1e3 / estimate.cyclesToMs(estimate.frameCycles, params) : 0.0)
+                      << "x the modelled frame time)" << std::endl;
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout << std::setprecision(6);
         }
+#endif
 
     } // namespace pipeline
 } // namespace hardware
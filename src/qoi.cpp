@@ -0,0 +1,409 @@
+#include "qoi.h"
+#include <algorithm>
+#include <cstring>
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        namespace qoi
+        {
+            namespace
+            {
+                enum : uint8_t
+                {
+                    OP_INDEX = 0x00,    // 00iiiiii
+                    OP_DIFF = 0x40,     // 01rrggbb, each -2..1
+                    OP_LUMA = 0x80,     // 10gggggg rrrrbbbb
+                    OP_RUN = 0xc0,      // 11rrrrrr
+                    OP_RGB = 0xfe,
+                    OP_RGBA = 0xff,
+
+                    GRAY_PAIR = 0x40,   // 01aaabbb, two differences of -4..3
+                    GRAY_DIFF = 0x80,   // 10dddddd, -32..31
+                };
+
+                const uint32_t OPAQUE_BLACK = 0xff000000u;
+
+                inline int slotOf(uint32_t px)
+                {
+                    return ((px & 0xff) * 3 + ((px >> 8) & 0xff) * 5 + ((px >> 16) & 0xff) * 7 + (px >> 24) * 11) & 63;
+                }
+
+                // The slot of the RGB pixel (v, v, v, 255)
+                inline int graySlotOf(uint32_t v)
+                {
+                    return (v * 15 + 255 * 11) & 63;
+                }
+
+                inline uint32_t pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+                {
+                    return (r & 0xff) | (g & 0xff) << 8 | (b & 0xff) << 16 | a << 24;
+                }
+
+                inline void putBigEndian(uint8_t *out, uint32_t value)
+                {
+                    out[0] = static_cast<uint8_t>(value >> 24);
+                    out[1] = static_cast<uint8_t>(value >> 16);
+                    out[2] = static_cast<uint8_t>(value >> 8);
+                    out[3] = static_cast<uint8_t>(value);
+                }
+
+                inline uint32_t getBigEndian(const uint8_t *data)
+                {
+                    return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+                }
+
+                inline void store(pixel *out, uint32_t px)
+                {
+                    out->r = static_cast<uint8_t>(px);
+                    out->g = static_cast<uint8_t>(px >> 8);
+                    out->b = static_cast<uint8_t>(px >> 16);
+                }
+            }
+
+            bool isQoi(const uint8_t *data, size_t size)
+            {
+                return size >= 4 && memcmp(data, "qoif", 4) == 0;
+            }
+
+            bool parseHeader(const uint8_t *data, size_t size, int &width, int &height, int &channels)
+            {
+                if (size < HEADER_BYTES || !isQoi(data, size))
+                    return false;
+
+                uint32_t w = getBigEndian(data + 4);
+                uint32_t h = getBigEndian(data + 8);
+                if (w == 0 || h == 0 || w > (1u << 24) || h > (1u << 24))
+                    return false;
+
+                channels = data[12];
+                if (channels != 1 && channels != 3 && channels != 4)
+                    return false;
+
+                width = static_cast<int>(w);
+                height = static_cast<int>(h);
+                return true;
+            }
+
+            uint8_t *writeHeader(uint8_t *out, int width, int height, int channels)
+            {
+                memcpy(out, "qoif", 4);
+                putBigEndian(out + 4, static_cast<uint32_t>(width));
+                putBigEndian(out + 8, static_cast<uint32_t>(height));
+                out[12] = static_cast<uint8_t>(channels);
+                out[13] = 0;    // sRGB
+                return out + HEADER_BYTES;
+            }
+
+            Encoder::Encoder(int channelCount)
+            {
+                reset(channelCount);
+            }
+
+            void Encoder::reset(int channelCount)
+            {
+                channels = channelCount;
+                run = 0;
+                previous = channels == 1 ? 0 : OPAQUE_BLACK;
+                std::fill(table, table + 64, 0u);
+            }
+
+            uint8_t *Encoder::encode(const uint8_t *samples, int count, uint8_t *out)
+            {
+                return channels == 1 ? encodeGray(samples, count, out) : encodeRgb(samples, count, out);
+            }
+
+            uint8_t *Encoder::encodeRgb(const uint8_t *samples, int count, uint8_t *out)
+            {
+                uint32_t prev = previous;
+                for (int i = 0; i < count; i++, samples += 3)
+                {
+                    uint32_t px = pack(samples[0], samples[1], samples[2], 0xff);
+                    if (px == prev)
+                    {
+                        if (++run == MAX_RUN)
+                        {
+                            *out++ = OP_RUN | (run - 1);
+                            run = 0;
+                        }
+                        continue;
+                    }
+                    if (run > 0)
+                    {
+                        *out++ = OP_RUN | (run - 1);
+                        run = 0;
+                    }
+
+                    int slot = slotOf(px);
+                    if (table[slot] == px)
+                    {
+                        *out++ = OP_INDEX | slot;
+                    }
+                    else
+                    {
+                        table[slot] = px;
+                        int dr = static_cast<int8_t>(samples[0] - (prev & 0xff));
+                        int dg = static_cast<int8_t>(samples[1] - ((prev >> 8) & 0xff));
+                        int db = static_cast<int8_t>(samples[2] - ((prev >> 16) & 0xff));
+                        int drg = dr - dg;
+                        int dbg = db - dg;
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                        {
+                            *out++ = OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+                        }
+                        else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+                        {
+                            *out++ = OP_LUMA | (dg + 32);
+                            *out++ = static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8));
+                        }
+                        else
+                        {
+                            *out++ = OP_RGB;
+                            *out++ = samples[0];
+                            *out++ = samples[1];
+                            *out++ = samples[2];
+                        }
+                    }
+                    prev = px;
+                }
+                previous = prev;
+                return out;
+            }
+
+            uint8_t *Encoder::encodeGray(const uint8_t *samples, int count, uint8_t *out)
+            {
+                uint32_t prev = previous;
+                for (int i = 0; i < count; i++)
+                {
+                    // A repeat starts a run only if the next one repeats too;
+                    // alone it is cheaper as half of a pair
+                    uint32_t v = samples[i];
+                    if (v == prev && (run > 0 || i + 1 == count || samples[i + 1] == v))
+                    {
+                        if (++run == MAX_RUN)
+                        {
+                            *out++ = OP_RUN | (run - 1);
+                            run = 0;
+                        }
+                        continue;
+                    }
+                    if (run > 0)
+                    {
+                        *out++ = OP_RUN | (run - 1);
+                        run = 0;
+                    }
+
+                    // Two small steps in one byte, when the next sample is
+                    // part of this call
+                    int d = static_cast<int8_t>(v - prev);
+                    if (d >= -4 && d <= 3 && i + 1 < count)
+                    {
+                        uint32_t next = samples[i + 1];
+                        int e = static_cast<int8_t>(next - v);
+                        if (e >= -4 && e <= 3)
+                        {
+                            *out++ = static_cast<uint8_t>(GRAY_PAIR | (d + 4) << 3 | (e + 4));
+                            table[graySlotOf(v)] = v;
+                            table[graySlotOf(next)] = next;
+                            prev = next;
+                            i++;
+                            continue;
+                        }
+                    }
+
+                    int slot = graySlotOf(v);
+                    if (table[slot] == v)
+                    {
+                        *out++ = OP_INDEX | slot;
+                    }
+                    else
+                    {
+                        table[slot] = v;
+                        if (d >= -32 && d <= 31)
+                        {
+                            *out++ = static_cast<uint8_t>(GRAY_DIFF | (d + 32));
+                        }
+                        else
+                        {
+                            *out++ = OP_RGB;
+                            *out++ = static_cast<uint8_t>(v);
+                        }
+                    }
+                    prev = v;
+                }
+                previous = prev;
+                return out;
+            }
+
+            uint8_t *Encoder::finish(uint8_t *out)
+            {
+                if (run > 0)
+                {
+                    *out++ = OP_RUN | (run - 1);
+                    run = 0;
+                }
+                memset(out, 0, END_BYTES - 1);
+                out[END_BYTES - 1] = 1;
+                return out + END_BYTES;
+            }
+
+            Decoder::Decoder(int channelCount)
+            {
+                reset(channelCount);
+            }
+
+            void Decoder::reset(int channelCount)
+            {
+                channels = channelCount;
+                run = 0;
+                pending = false;
+                previous = channels == 1 ? 0 : OPAQUE_BLACK;
+                std::fill(table, table + 64, 0u);
+            }
+
+            const uint8_t *Decoder::decode(const uint8_t *p, const uint8_t *end, pixel *out, int count)
+            {
+                return channels == 1 ? decodeGray(p, end, out, count) : decodeRgb(p, end, out, count);
+            }
+
+            const uint8_t *Decoder::decodeRgb(const uint8_t *p, const uint8_t *end, pixel *out, int count)
+            {
+                uint32_t px = previous;
+                int i = 0;
+                while (i < count)
+                {
+                    // Pixels still owed by a run
+                    if (run > 0)
+                    {
+                        int n = std::min(run, count - i);
+                        pixel value;
+                        store(&value, px);
+                        std::fill(out + i, out + i + n, value);
+                        run -= n;
+                        i += n;
+                        continue;
+                    }
+
+                    if (p >= end)
+                        return nullptr;
+                    uint8_t op = *p++;
+                    if (op == OP_RGB)
+                    {
+                        if (end - p < 3)
+                            return nullptr;
+                        px = pack(p[0], p[1], p[2], px >> 24);
+                        p += 3;
+                    }
+                    else if (op == OP_RGBA)
+                    {
+                        if (end - p < 4)
+                            return nullptr;
+                        px = pack(p[0], p[1], p[2], p[3]);
+                        p += 4;
+                    }
+                    else if (op < OP_DIFF)
+                    {
+                        px = table[op];
+                    }
+                    else if (op < OP_LUMA)
+                    {
+                        px = pack((px & 0xff) + ((op >> 4) & 3) - 2, ((px >> 8) & 0xff) + ((op >> 2) & 3) - 2,
+                                  ((px >> 16) & 0xff) + (op & 3) - 2, px >> 24);
+                    }
+                    else if (op < OP_RUN)
+                    {
+                        if (p >= end)
+                            return nullptr;
+                        int dg = (op & 63) - 32;
+                        int dr = dg + (*p >> 4) - 8;
+                        int db = dg + (*p & 15) - 8;
+                        p++;
+                        px = pack((px & 0xff) + dr, ((px >> 8) & 0xff) + dg, ((px >> 16) & 0xff) + db, px >> 24);
+                    }
+                    else
+                    {
+                        run = (op & 63) + 1;
+                        continue;
+                    }
+                    table[slotOf(px)] = px;
+                    store(out + i, px);
+                    i++;
+                }
+                previous = px;
+                return p;
+            }
+
+            const uint8_t *Decoder::decodeGray(const uint8_t *p, const uint8_t *end, pixel *out, int count)
+            {
+                uint32_t px = previous;
+                int i = 0;
+                if (pending && count > 0)
+                {
+                    out[i].r = out[i].g = out[i].b = static_cast<uint8_t>(px);
+                    pending = false;
+                    i++;
+                }
+                while (i < count)
+                {
+                    if (run > 0)
+                    {
+                        int n = std::min(run, count - i);
+                        pixel value;
+                        value.r = value.g = value.b = static_cast<uint8_t>(px);
+                        std::fill(out + i, out + i + n, value);
+                        run -= n;
+                        i += n;
+                        continue;
+                    }
+
+                    if (p >= end)
+                        return nullptr;
+                    uint8_t op = *p++;
+                    if (op < GRAY_PAIR)
+                    {
+                        px = table[op];
+                    }
+                    else if (op < GRAY_DIFF)
+                    {
+                        // The first sample here, the second below
+                        px = (px + ((op >> 3) & 7) - 4) & 0xff;
+                        table[graySlotOf(px)] = px;
+                        out[i].r = out[i].g = out[i].b = static_cast<uint8_t>(px);
+                        px = (px + (op & 7) - 4) & 0xff;
+                        if (++i == count)
+                        {
+                            table[graySlotOf(px)] = px;
+                            pending = true;
+                            break;
+                        }
+                    }
+                    else if (op < OP_RUN)
+                    {
+                        px = (px + (op & 63) - 32) & 0xff;
+                    }
+                    else if (op == OP_RGB)
+                    {
+                        if (p >= end)
+                            return nullptr;
+                        px = *p++;
+                    }
+                    else if (op == OP_RGBA)
+                    {
+                        return nullptr;
+                    }
+                    else
+                    {
+                        run = (op & 63) + 1;
+                        continue;
+                    }
+                    table[graySlotOf(px)] = px;
+                    out[i].r = out[i].g = out[i].b = static_cast<uint8_t>(px);
+                    i++;
+                }
+                previous = px;
+                return p;
+            }
+        }
+    }
+}
@@ -0,0 +1,338 @@
+#include "recursive_gaussian.h"
+#include "convolution.h"
+#include "fixed_point.h"
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace
+        {
+            // Smallest column block; blocks grow to twice the warm-up so
+            // the rows run per block stay under twice the rows kept
+            constexpr int MIN_BLOCK_ROWS = 64;
+
+
+            // Warm-up ends once the rest of the impulse response is this small
+            constexpr double WARMUP_TAIL = 1.0 / 1024;
+
+#ifdef USE_FIXED_POINT
+            typedef int32_t Sample;     // Q15.16
+            constexpr int SAMPLE_FRAC = 16;
+            constexpr int COEFF_FRAC = 24;
+
+            inline Sample toSample(uint8_t v) { return static_cast<Sample>(v) << SAMPLE_FRAC; }
+            inline uint8_t toPixel(Sample v) { return fixed::roundToPixel<SAMPLE_FRAC>(v); }
+
+            // w[n] = gain * x[n] + f1 * w[n-1] + f2 * w[n-2] + f3 * w[n-3],
+            // summed oldest first so only the last multiply-add waits on w[n-1]
+            struct Recursion
+            {
+                int64_t gain, f1, f2, f3;
+
+                Sample operator()(Sample x, Sample a, Sample b, Sample c) const
+                {
+                    int64_t acc = gain * x + f3 * c + f2 * b + f1 * a;
+                    return static_cast<Sample>((acc + (int64_t(1) << (COEFF_FRAC - 1))) >> COEFF_FRAC);
+                }
+            };
+#else
+            typedef float Sample;
+
+            inline Sample toSample(uint8_t v) { return v; }
+            inline uint8_t toPixel(Sample v)
+            {
+                return v <= 0.0f ? 0 : v >= 255.0f ? 255 : static_cast<uint8_t>(v + 0.5f);
+            }
+
+            struct Recursion
+            {
+                float gain, f1, f2, f3;
+
+                Sample operator()(Sample x, Sample a, Sample b, Sample c) const
+                {
+                    return gain * x + f3 * c + f2 * b + f1 * a;
+                }
+            };
+#endif
+
+            // Causal then anti-causal pass down the columns [begin, end) of
+            // rows first - warmup .. last - 1 + warmup. Each row of `result`
+            // holds `lineSamples` samples with column 0 at `apron`; rows
+            // first .. last - 1 end up filtered.
+            template <typename T>
+            void columnPass(const BasicRowBand<T> &band, Recursion recursion, int first, int last, int warmup,
+                            int begin, int end, int apron, int lineSamples, Sample *result)
+            {
+                thread_local std::vector<Sample> stateLines;
+                if (static_cast<int>(stateLines.size()) < 3 * lineSamples)
+                {
+                    stateLines.resize(3 * lineSamples);
+                }
+                Sample *s1 = stateLines.data() + apron;
+                Sample *s2 = s1 + lineSamples;
+                Sample *s3 = s2 + lineSamples;
+
+                // Start from the steady state of the first row
+                const uint8_t *top = reinterpret_cast<const uint8_t *>(band.inputRow(first - warmup));
+                for (int j = begin; j < end; j++)
+                {
+                    s1[j] = s2[j] = s3[j] = toSample(top[j]);
+                }
+
+                for (int n = first - warmup; n < last + warmup; n++)
+                {
+                    const uint8_t *x = reinterpret_cast<const uint8_t *>(band.inputRow(n));
+                    for (int j = begin; j < end; j++)
+                    {
+                        s3[j] = recursion(toSample(x[j]), s1[j], s2[j], s3[j]);
+                    }
+                    if (n >= first)
+                    {
+                        memcpy(result + static_cast<size_t>(n - first) * lineSamples + apron + begin, s3 + begin,
+                               (end - begin) * sizeof(Sample));
+                    }
+                    std::swap(s1, s3);  // (s1, s2, s3) <- (new, s1, s2)
+                    std::swap(s2, s3);
+                }
+
+                int rows = last - first + warmup;
+                Sample *bottom = result + static_cast<size_t>(rows - 1) * lineSamples + apron;
+                for (int j = begin; j < end; j++)
+                {
+                    s1[j] = s2[j] = s3[j] = bottom[j];
+                }
+
+                for (int i = rows - 1; i >= 0; i--)
+                {
+                    Sample *w = result + static_cast<size_t>(i) * lineSamples + apron;
+                    for (int j = begin; j < end; j++)
+                    {
+                        w[j] = s3[j] = recursion(w[j], s1[j], s2[j], s3[j]);
+                    }
+                    std::swap(s1, s3);
+                    std::swap(s2, s3);
+                }
+            }
+
+            // Causal then anti-causal pass along `count` lines of `width`
+            // pixels of STEP interleaved lanes, in place, from `warmup`
+            // pixels before to `warmup` pixels after them (lines[-warmup *
+            // STEP] must be valid). Rows are `lineSamples` apart; finished
+            // rows go to `pixels`. The rows' recursions are independent, so
+            // they form the inner loop and run side by side in vector lanes.
+            template <int STEP>
+            void rowPass(Sample *lines, int count, int lineSamples, Recursion recursion, int width, int warmup,
+                         uint8_t *pixels)
+            {
+                thread_local std::vector<Sample> stateLines;
+                int lanes = STEP * count;
+                if (static_cast<int>(stateLines.size()) < 3 * lanes)
+                {
+                    stateLines.resize(3 * lanes);
+                }
+                Sample *s1 = stateLines.data();
+                Sample *s2 = s1 + lanes;
+                Sample *s3 = s2 + lanes;
+
+                for (int c = 0; c < STEP; c++)
+                {
+                    for (int r = 0; r < count; r++)
+                    {
+                        int lane = c * count + r;
+                        s1[lane] = s2[lane] = s3[lane] = lines[r * lineSamples - warmup * STEP + c];
+                    }
+                }
+                for (int p = -warmup; p < width + warmup; p++)
+                {
+                    for (int c = 0; c < STEP; c++)
+                    {
+                        Sample *x = lines + p * STEP + c;
+                        int lane = c * count;
+                        for (int r = 0; r < count; r++)
+                        {
+                            x[r * lineSamples] = s3[lane + r] =
+                                recursion(x[r * lineSamples], s1[lane + r], s2[lane + r], s3[lane + r]);
+                        }
+                    }
+                    std::swap(s1, s3);  // (s1, s2, s3) <- (new, s1, s2)
+                    std::swap(s2, s3);
+                }
+
+                for (int c = 0; c < STEP; c++)
+                {
+                    for (int r = 0; r < count; r++)
+                    {
+                        int lane = c * count + r;
+                        s1[lane] = s2[lane] = s3[lane] = lines[r * lineSamples + (width + warmup - 1) * STEP + c];
+                    }
+                }
+                int pitch = width * STEP;
+                for (int p = width + warmup - 1; p >= 0; p--)
+                {
+                    for (int c = 0; c < STEP; c++)
+                    {
+                        Sample *x = lines + p * STEP + c;
+                        int lane = c * count;
+                        for (int r = 0; r < count; r++)
+                        {
+                            s3[lane + r] = recursion(x[r * lineSamples], s1[lane + r], s2[lane + r], s3[lane + r]);
+                        }
+                        if (p < width)
+                        {
+                            for (int r = 0; r < count; r++)
+                            {
+                                pixels[r * pitch + p * STEP + c] = toPixel(s3[lane + r]);
+                            }
+                        }
+                    }
+                    std::swap(s1, s3);
+                    std::swap(s2, s3);
+                }
+            }
+        }
+
+        RecursiveGaussianFilter::RecursiveGaussianFilter(float s)
+            : sigma(std::min(std::max(s, 0.5f), MAX_GAUSSIAN_SIGMA))
+        {
+            if (sigma != s)
+            {
+                std::cerr << "[IIR] WARNING: Sigma " << s << " out of range, using " << sigma << "\n";
+            }
+
+            // Young & van Vliet (1995): pole placement from q(sigma)
+            double q = sigma >= 2.5f ? 0.98711 * sigma - 0.96330
+                                     : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+            double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+            double b1 = 2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q;
+            double b2 = -(1.4281 * q * q + 1.26661 * q * q * q);
+            double b3 = 0.422205 * q * q * q;
+            double f[3] = {b1 / b0, b2 / b0, b3 / b0};
+
+            // Unit DC gain: the gain absorbs the rounding of the feedback taps
+#ifdef USE_FIXED_POINT
+            int32_t one = int32_t(1) << COEFF_FRAC;
+            gain = one;
+            for (int i = 0; i < 3; i++)
+            {
+                feedback[i] = static_cast<int32_t>(std::lround(f[i] * one));
+                gain -= feedback[i];
+            }
+#else
+            gain = 1.0f;
+            for (int i = 0; i < 3; i++)
+            {
+                feedback[i] = static_cast<float>(f[i]);
+                gain -= feedback[i];
+            }
+#endif
+
+            // Warm-up: where the tail of the causal impulse response drops
+            // below WARMUP_TAIL, so a wrong starting state is forgotten
+            int length = static_cast<int>(std::ceil(16.0 * sigma)) + 64;
+            std::vector<double> response(length);
+            double g = 1.0 - f[0] - f[1] - f[2];
+            for (int n = 0; n < length; n++)
+            {
+                double h = (n == 0) ? g : 0.0;
+                for (int k = 1; k <= 3 && n - k >= 0; k++)
+                {
+                    h += f[k - 1] * response[n - k];
+                }
+                response[n] = h;
+            }
+            double tail = 0.0;
+            warmup = length;
+            for (int n = length - 1; n >= 0 && tail + std::fabs(response[n]) < WARMUP_TAIL; n--)
+            {
+                tail += std::fabs(response[n]);
+                warmup = n;
+            }
+            blockRows = std::max(MIN_BLOCK_ROWS, 2 * warmup);
+
+            LOG_INFO("Recursive Gaussian sigma " << sigma << ": warm-up " << warmup
+                                                 << ", column blocks of " << blockRows << " rows");
+        }
+
+        void RecursiveGaussianFilter::apply(pixel *input, pixel *output, int width, int height)
+        {
+#ifdef DEBUG
+            std::cout << "[IIR] Applying recursive Gaussian, sigma " << sigma << "\n";
+            std::cout << "[IIR] Warm-up " << warmup << ", block rows " << blockRows << "\n";
+#endif
+
+            applyRows(input, output, width, height);
+        }
+
+        void RecursiveGaussianFilter::filterBlock(const RowBand &band, int first, int last, pixel *out)
+        {
+            filterRows(band, first, last, out);
+        }
+
+        void RecursiveGaussianFilter::filterBlock(const GrayRowBand &band, int first, int last, uint8_t *out)
+        {
+            filterRows(band, first, last, out);
+        }
+
+        template <typename T>
+        void RecursiveGaussianFilter::filterRows(const BasicRowBand<T> &band, int first, int last, T *out)
+        {
+            const int step = sizeof(T);
+            int width = band.width;
+            bool padded = band.padded();
+            int count = last - first;
+
+            // Block rows carry a warm-up-wide apron for the row pass; padded
+            // bands fill it from their own apron columns, COPY bands by
+            // repeating the edge pixels afterwards
+            int apron = warmup * step;
+            int lineSamples = width * step + 2 * apron;
+            int begin = padded ? -apron : 0;
+            int end = padded ? width * step + apron : width * step;
+
+            thread_local std::vector<Sample> blockSamples;
+            size_t samples = static_cast<size_t>(count + warmup) * lineSamples;
+            if (blockSamples.size() < samples)
+            {
+                blockSamples.resize(samples);
+            }
+
+            Recursion recursion = {gain, feedback[0], feedback[1], feedback[2]};
+            columnPass(band, recursion, first, last, warmup, begin, end, apron, lineSamples, blockSamples.data());
+
+            Sample *lines = blockSamples.data() + apron;
+            if (!padded)
+            {
+                for (int r = 0; r < count; r++)
+                {
+                    Sample *line = lines + static_cast<size_t>(r) * lineSamples;
+                    for (int i = 1; i <= warmup; i++)
+                    {
+                        for (int c = 0; c < step; c++)
+                        {
+                            line[-i * step + c] = line[c];
+                            line[(width - 1 + i) * step + c] = line[(width - 1) * step + c];
+                        }
+                    }
+                }
+            }
+            rowPass<sizeof(T)>(lines, count, lineSamples, recursion, width, warmup, reinterpret_cast<uint8_t *>(out));
+        }
+
+        BaseFilter *createGaussianBlur(float sigma)
+        {
+            if (sigma > RECURSIVE_GAUSSIAN_MIN_SIGMA)
+            {
+                return new RecursiveGaussianFilter(sigma);
+            }
+            int radius = static_cast<int>(std::ceil(3.0f * sigma));
+            return ConvolutionFilter::createGaussian(2 * radius + 1, sigma);
+        }
+    }
+}
@@ -0,0 +1,600 @@
+#include "simd_kernels.h"
+#include "config.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef USE_FIXED_POINT
+static_assert(KernelTap::FRAC_BITS == 8 && sizeof(KernelTap) == 2,
+              "SIMD fixed-point kernels assume Q7.8 taps in 16-bit lanes");
+#endif
+
+namespace hardware
+{
+    namespace filters
+    {
+        namespace simd
+        {
+            namespace
+            {
+                // ------------------------------------------------------------
+                // Scalar reference kernels (also used for line tails)
+                // ------------------------------------------------------------
+
+#ifdef USE_FIXED_POINT
+                // Fraction bits of the sums: sample x tap, and (sample x tap) x tap
+                constexpr int DENSE_FRAC = KernelTap::FRAC_BITS;
+                constexpr int SEPARABLE_FRAC = 2 * KernelTap::FRAC_BITS;
+
+                inline uint8_t convertBack(Fixed sum, int frac)
+                {
+                    return frac == DENSE_FRAC ? hardware::fixed::roundToPixel<DENSE_FRAC>(sum)
+                                              : hardware::fixed::roundToPixel<SEPARABLE_FRAC>(sum);
+                }
+#else
+                constexpr int DENSE_FRAC = 0;
+                constexpr int SEPARABLE_FRAC = 0;
+
+                inline uint8_t convertBack(Fixed sum, int)
+                {
+                    return static_cast<uint8_t>(std::max(0.0f, std::min(sum, 255.0f)));
+                }
+#endif
+
+                void denseRowScalar(const uint8_t *const *rows, const KernelTap *taps, int size,
+                                    int step, uint8_t *dst, int begin, int end)
+                {
+                    int radius = size / 2;
+                    for (int j = begin; j < end; j++)
+                    {
+                        Fixed sum = 0;
+                        for (int ky = 0; ky < size; ky++)
+                        {
+                            const uint8_t *row = rows[ky] + j - radius * step;
+                            for (int kx = 0; kx < size; kx++)
+                            {
+                                sum += row[kx * step] * TAP_WEIGHT(taps[ky * size + kx]);
+                            }
+                        }
+                        dst[j] = convertBack(sum, DENSE_FRAC);
+                    }
+                }
+
+                void verticalPassScalar(const uint8_t *const *rows, const KernelTap *taps, int size,
+                                        Fixed *line, int begin, int end)
+                {
+                    std::fill(line + begin, line + end, Fixed(0));
+                    for (int k = 0; k < size; k++)
+                    {
+                        Fixed weight = TAP_WEIGHT(taps[k]);
+                        if (weight == 0)
+                            continue;
+
+                        const uint8_t *src = rows[k];
+                        for (int j = begin; j < end; j++)
+                        {
+                            line[j] += src[j] * weight;
+                        }
+                    }
+                }
+
+                void horizontalPassScalar(const Fixed *line, const KernelTap *taps, int size,
+                                          int step, uint8_t *dst, int begin, int end)
+                {
+                    int radius = size / 2;
+                    for (int j = begin; j < end; j++)
+                    {
+                        const Fixed *src = line + j - radius * step;
+                        Fixed sum = 0;
+                        for (int k = 0; k < size; k++)
+                        {
+                            sum += src[k * step] * TAP_WEIGHT(taps[k]);
+                        }
+                        dst[j] = convertBack(sum, SEPARABLE_FRAC);
+                    }
+                }
+
+#ifdef SIMD_X86
+#ifdef USE_FIXED_POINT
+                // Fixed point maps onto 16-bit lanes: two 8-bit samples a, b
+                // are interleaved and widened, and one pmaddwd forms
+                // a*t0 + b*t1 in each 32-bit lane. A kernel's taps are
+                // consumed in pairs (the odd one out pairs with a zero tap).
+
+                inline int32_t tapPair(KernelTap first, KernelTap second)
+                {
+                    return static_cast<int32_t>(static_cast<uint16_t>(first.raw) |
+                                                (static_cast<uint32_t>(static_cast<uint16_t>(second.raw)) << 16));
+                }
+
+                // A dense kernel flattened into tap pairs: the rows each pair
+                // reads (relative to output sample 0) and its packed taps. An
+                // odd tap count pairs the last tap with itself at weight 0.
+                struct DensePairs
+                {
+                    std::vector<const uint8_t *> first;
+                    std::vector<const uint8_t *> second;
+                    std::vector<int32_t> taps;
+                };
+
+                inline const DensePairs &densePairs(const uint8_t *const *rows, const KernelTap *taps, int size, int step)
+                {
+                    thread_local DensePairs pairs;
+                    int count = size * size;
+                    int pairCount = (count + 1) / 2;
+                    pairs.first.resize(pairCount);
+                    pairs.second.resize(pairCount);
+                    pairs.taps.resize(pairCount);
+
+                    int radius = size / 2;
+                    for (int p = 0; p < pairCount; p++)
+                    {
+                        int t = 2 * p;
+                        int u = (t + 1 < count) ? t + 1 : t;
+                        pairs.first[p] = rows[t / size] + (t % size - radius) * step;
+                        pairs.second[p] = rows[u / size] + (u % size - radius) * step;
+                        pairs.taps[p] = tapPair(taps[t], u != t ? taps[u] : KernelTap{0});
+                    }
+                    return pairs;
+                }
+
+                inline bool symmetricTaps(const KernelTap *taps, int size)
+                {
+                    for (int k = 0; k < size / 2; k++)
+                    {
+                        if (taps[k].raw != taps[size - 1 - k].raw)
+                            return false;
+                    }
+                    return true;
+                }
+#endif
+
+                // ------------------------------------------------------------
+                // SSE4.1: 16 samples per iteration
+                // ------------------------------------------------------------
+
+#ifdef USE_FIXED_POINT
+                typedef __m128i Acc128;
+
+                __attribute__((target("sse4.1"))) inline Acc128 zero128() { return _mm_setzero_si128(); }
+
+                // acc[0..3] += a * t0 + b * t1 for 16 samples
+                __attribute__((target("sse4.1"))) inline void maddPair128(Acc128 acc[4], __m128i a, __m128i b, __m128i taps)
+                {
+                    __m128i zero = _mm_setzero_si128();
+                    __m128i lo = _mm_unpacklo_epi8(a, b);
+                    __m128i hi = _mm_unpackhi_epi8(a, b);
+                    acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), taps));
+                    acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), taps));
+                    acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), taps));
+                    acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), taps));
+                }
+
+                // Round half up; the saturating packs in store128 clamp to [0, 255]
+                __attribute__((target("sse4.1"))) inline __m128i finish128(Acc128 v, int frac)
+                {
+                    return _mm_sra_epi32(_mm_add_epi32(v, _mm_set1_epi32(1 << (frac - 1))), _mm_cvtsi32_si128(frac));
+                }
+#else
+                typedef __m128 Acc128;
+
+                __attribute__((target("sse4.1"))) inline Acc128 zero128() { return _mm_setzero_ps(); }
+
+                __attribute__((target("sse4.1"))) inline Acc128 widen128(__m128i bytes)
+                {
+                    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes));
+                }
+
+                __attribute__((target("sse4.1"))) inline Acc128 madd128(Acc128 acc, Acc128 value, Fixed weight)
+                {
+                    return _mm_add_ps(acc, _mm_mul_ps(value, _mm_set1_ps(weight)));
+                }
+
+                __attribute__((target("sse4.1"))) inline __m128i finish128(Acc128 v, int)
+                {
+                    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+                    return _mm_cvttps_epi32(v);
+                }
+#endif
+
+                __attribute__((target("sse4.1"))) inline void store128(uint8_t *dst, const Acc128 acc[4], int frac)
+                {
+                    __m128i ab = _mm_packus_epi32(finish128(acc[0], frac), finish128(acc[1], frac));
+                    __m128i cd = _mm_packus_epi32(finish128(acc[2], frac), finish128(acc[3], frac));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(ab, cd));
+                }
+
+                __attribute__((target("sse4.1"))) void denseRowSse41(const uint8_t *const *rows, const KernelTap *taps, int size,
+                                                                     int step, uint8_t *dst, int begin, int end)
+                {
+                    int j = begin;
+#ifdef USE_FIXED_POINT
+                    const DensePairs &pairs = densePairs(rows, taps, size, step);
+                    int pairCount = static_cast<int>(pairs.taps.size());
+                    for (; j + 16 <= end; j += 16)
+                    {
+                        Acc128 acc[4] = {zero128(), zero128(), zero128(), zero128()};
+                        for (int p = 0; p < pairCount; p++)
+                        {
+                            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pairs.first[p] + j));
+                            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pairs.second[p] + j));
+                            maddPair128(acc, a, b, _mm_set1_epi32(pairs.taps[p]));
+                        }
+                        store128(dst + j, acc, DENSE_FRAC);
+                    }
+#else
+                    int radius = size / 2;
+                    for (; j + 16 <= end; j += 16)
+                    {
+                        Acc128 acc[4] = {zero128(), zero128(), zero128(), zero128()};
+                        for (int ky = 0; ky < size; ky++)
+                        {
+                            const uint8_t *row = rows[ky] + j - radius * step;
+                            for (int kx = 0; kx < size; kx++)
+                            {
+                                Fixed weight = taps[ky * size + kx];
+                                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + kx * step));
+                                acc[0] = madd128(acc[0], widen128(v), weight);
+                                acc[1] = madd128(acc[1], widen128(_mm_srli_si128(v, 4)), weight);
+                                acc[2] = madd128(acc[2], widen128(_mm_srli_si128(v, 8)), weight);
+                                acc[3] = madd128(acc[3], widen128(_mm_srli_si128(v, 12)), weight);
+                            }
+                        }
+                        store128(dst + j, acc, DENSE_FRAC);
+                    }
+#endif
+                    denseRowScalar(rows, taps, size, step, dst, j, end);
+                }
+
+                __attribute__((target("sse4.1"))) void verticalPassSse41(const uint8_t *const *rows, const KernelTap *taps, int size,
+                                                                         Fixed *line, int begin, int end)
+                {
+                    int j = begin;
+                    for (; j + 16 <= end; j += 16)
+                    {
+                        Acc128 acc[4] = {zero128(), zero128(), zero128(), zero128()};
+#ifdef USE_FIXED_POINT
+                        for (int k = 0; k < size; k += 2)
+                        {
+                            int u = (k + 1 < size) ? k + 1 : k;
+                            KernelTap second = (u != k) ? taps[u] : KernelTap{0};
+                            if (taps[k].raw == 0 && second.raw == 0)
+                                continue;
+
+                            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + j));
+                            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[u] + j));
+                            maddPair128(acc, a, b, _mm_set1_epi32(tapPair(taps[k], second)));
+                        }
+                        __m128i *out = reinterpret_cast<__m128i *>(line + j);
+                        for (int q = 0; q < 4; q++)
+                        {
+                            _mm_storeu_si128(out + q, acc[q]);
+                        }
+#else
+                        for (int k = 0; k < size; k++)
+                        {
+                            Fixed weight = taps[k];
+                            if (weight == 0)
+                                continue;
+
+                            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + j));
+                            acc[0] = madd128(acc[0], widen128(v), weight);
+                            acc[1] = madd128(acc[1], widen128(_mm_srli_si128(v, 4)), weight);
+                            acc[2] = madd128(acc[2], widen128(_mm_srli_si128(v, 8)), weight);
+                            acc[3] = madd128(acc[3], widen128(_mm_srli_si128(v, 12)), weight);
+                        }
+                        for (int q = 0; q < 4; q++)
+                        {
+                            _mm_storeu_ps(line + j + q * 4, acc[q]);
+                        }
+#endif
+                    }
+                    verticalPassScalar(rows, taps, size, line, j, end);
+                }
+
+                __attribute__((target("sse4.1"))) void horizontalPassSse41(const Fixed *line, const KernelTap *taps, int size,
+                                                                           int step, uint8_t *dst, int begin, int end)
+                {
+                    int radius = size / 2;
+                    int j = begin;
+#ifdef USE_FIXED_POINT
+                    // Symmetric taps share one multiply per pair (the DSP pre-adder)
+                    bool symmetric = symmetricTaps(taps, size);
+                    int lastTap = symmetric ? radius + 1 : size;
+#endif
+                    for (; j + 16 <= end; j += 16)
+                    {
+                        Acc128 acc[4] = {zero128(), zero128(), zero128(), zero128()};
+                        const Fixed *src = line + j - radius * step;
+#ifdef USE_FIXED_POINT
+                        // Q.8 line x Q7.8 tap: the sum stays exact in 32 bits
+                        for (int k = 0; k < lastTap; k++)
+                        {
+                            __m128i weight = _mm_set1_epi32(taps[k].raw);
+                            for (int q = 0; q < 4; q++)
+                            {
+                                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + k * step + q * 4));
+                                if (symmetric && k != radius)
+                                {
+                                    v = _mm_add_epi32(v, _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + (size - 1 - k) * step + q * 4)));
+                                }
+                                acc[q] = _mm_add_epi32(acc[q], _mm_mullo_epi32(v, weight));
+                            }
+                        }
+#else
+                        for (int k = 0; k < size; k++)
+                        {
+                            for (int q = 0; q < 4; q++)
+                            {
+                                __m128 v = _mm_loadu_ps(src + k * step + q * 4);
+                                acc[q] = madd128(acc[q], v, taps[k]);
+                            }
+                        }
+#endif
+                        store128(dst + j, acc, SEPARABLE_FRAC);
+                    }
+                    horizontalPassScalar(line, taps, size, step, dst, j, end);
+                }
+
+                // ------------------------------------------------------------
+                // AVX2: 32 samples per iteration
+                // ------------------------------------------------------------
+
+#ifdef USE_FIXED_POINT
+                typedef __m256i Acc256;
+
+                __attribute__((target("avx2"))) inline Acc256 zero256() { return _mm256_setzero_si256(); }
+
+                // acc[0..3] += a * t0 + b * t1 for 32 samples. Interleaving
+                // within 128 bits before widening keeps samples in order.
+                __attribute__((target("avx2"))) inline void maddPair256(Acc256 acc[4], const uint8_t *a, const uint8_t *b,
+                                                                        __m256i taps)
+                {
+                    for (int half = 0; half < 2; half++)
+                    {
+                        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + half * 16));
+                        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + half * 16));
+                        __m256i lo = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(va, vb));
+                        __m256i hi = _mm256_cvtepu8_epi16(_mm_unpackhi_epi8(va, vb));
+                        acc[2 * half] = _mm256_add_epi32(acc[2 * half], _mm256_madd_epi16(lo, taps));
+                        acc[2 * half + 1] = _mm256_add_epi32(acc[2 * half + 1], _mm256_madd_epi16(hi, taps));
+                    }
+                }
+
+                __attribute__((target("avx2"))) inline __m256i finish256(Acc256 v, int frac)
+                {
+                    return _mm256_sra_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(1 << (frac - 1))), _mm_cvtsi32_si128(frac));
+                }
+#else
+                typedef __m256 Acc256;
+
+                __attribute__((target("avx2"))) inline Acc256 zero256() { return _mm256_setzero_ps(); }
+
+                __attribute__((target("avx2"))) inline Acc256 widen256(__m128i bytes)
+                {
+                    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+                }
+
+                // Separate multiply and add (no FMA) to round exactly like the scalar loop
+                __attribute__((target("avx2"))) inline Acc256 madd256(Acc256 acc, Acc256 value, Fixed weight)
+                {
+                    return _mm256_add_ps(acc, _mm256_mul_ps(value, _mm256_set1_ps(weight)));
+                }
+
+                __attribute__((target("avx2"))) inline __m256i finish256(Acc256 v, int)
+                {
+                    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+                    return _mm256_cvttps_epi32(v);
+                }
+#endif
+
+                __attribute__((target("avx2"))) inline void store256(uint8_t *dst, const Acc256 acc[4], int frac)
+                {
+                    // Packs work per 128-bit lane; the permute restores sample order
+                    __m256i ab = _mm256_packus_epi32(finish256(acc[0], frac), finish256(acc[1], frac));
+                    __m256i cd = _mm256_packus_epi32(finish256(acc[2], frac), finish256(acc[3], frac));
+                    __m256i bytes = _mm256_packus_epi16(ab, cd);
+                    bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), bytes);
+                }
+
+                __attribute__((target("avx2"))) void denseRowAvx2(const uint8_t *const *rows, const KernelTap *taps, int size,
+                                                                  int step, uint8_t *dst, int begin, int end)
+                {
+                    int j = begin;
+#ifdef USE_FIXED_POINT
+                    const DensePairs &pairs = densePairs(rows, taps, size, step);
+                    int pairCount = static_cast<int>(pairs.taps.size());
+                    for (; j + 32 <= end; j += 32)
+                    {
+                        Acc256 acc[4] = {zero256(), zero256(), zero256(), zero256()};
+                        for (int p = 0; p < pairCount; p++)
+                        {
+                            maddPair256(acc, pairs.first[p] + j, pairs.second[p] + j, _mm256_set1_epi32(pairs.taps[p]));
+                        }
+                        store256(dst + j, acc, DENSE_FRAC);
+                    }
+#else
+                    int radius = size / 2;
+                    for (; j + 32 <= end; j += 32)
+                    {
+                        Acc256 acc[4] = {zero256(), zero256(), zero256(), zero256()};
+                        for (int ky = 0; ky < size; ky++)
+                        {
+                            const uint8_t *row = rows[ky] + j - radius * step;
+                            for (int kx = 0; kx < size; kx++)
+                            {
+                                Fixed weight = taps[ky * size + kx];
+                                const uint8_t *p = row + kx * step;
+                                __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                                __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+                                acc[0] = madd256(acc[0], widen256(lo), weight);
+                                acc[1] = madd256(acc[1], widen256(_mm_srli_si128(lo, 8)), weight);
+                                acc[2] = madd256(acc[2], widen256(hi), weight);
+                                acc[3] = madd256(acc[3], widen256(_mm_srli_si128(hi, 8)), weight);
+                            }
+                        }
+                        store256(dst + j, acc, DENSE_FRAC);
+                    }
+#endif
+                    denseRowSse41(rows, taps, size, step, dst, j, end);
+                }
+
+                __attribute__((target("avx2"))) void verticalPassAvx2(const uint8_t *const *rows, const KernelTap *taps, int size,
+                                                                      Fixed *line, int begin, int end)
+                {
+                    int j = begin;
+                    for (; j + 32 <= end; j += 32)
+                    {
+                        Acc256 acc[4] = {zero256(), zero256(), zero256(), zero256()};
+#ifdef USE_FIXED_POINT
+                        for (int k = 0; k < size; k += 2)
+                        {
+                            int u = (k + 1 < size) ? k + 1 : k;
+                            KernelTap second = (u != k) ? taps[u] : KernelTap{0};
+                            if (taps[k].raw == 0 && second.raw == 0)
+                                continue;
+
+                            maddPair256(acc, rows[k] + j, rows[u] + j, _mm256_set1_epi32(tapPair(taps[k], second)));
+                        }
+                        __m256i *out = reinterpret_cast<__m256i *>(line + j);
+                        for (int q = 0; q < 4; q++)
+                        {
+                            _mm256_storeu_si256(out + q, acc[q]);
+                        }
+#else
+                        for (int k = 0; k < size; k++)
+                        {
+                            Fixed weight = taps[k];
+                            if (weight == 0)
+                                continue;
+
+                            const uint8_t *p = rows[k] + j;
+                            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+                            acc[0] = madd256(acc[0], widen256(lo), weight);
+                            acc[1] = madd256(acc[1], widen256(_mm_srli_si128(lo, 8)), weight);
+                            acc[2] = madd256(acc[2], widen256(hi), weight);
+                            acc[3] = madd256(acc[3], widen256(_mm_srli_si128(hi, 8)), weight);
+                        }
+                        for (int q = 0; q < 4; q++)
+                        {
+                            _mm256_storeu_ps(line + j + q * 8, acc[q]);
+                        }
+#endif
+                    }
+                    verticalPassSse41(rows, taps, size, line, j, end);
+                }
+
+                __attribute__((target("avx2"))) void horizontalPassAvx2(const Fixed *line, const KernelTap *taps, int size,
+                                                                        int step, uint8_t *dst, int begin, int end)
+                {
+                    int radius = size / 2;
+                    int j = begin;
+#ifdef USE_FIXED_POINT
+                    // Symmetric taps share one multiply per pair (the DSP pre-adder)
+                    bool symmetric = symmetricTaps(taps, size);
+                    int lastTap = symmetric ? radius + 1 : size;
+#endif
+                    for (; j + 32 <= end; j += 32)
+                    {
+                        Acc256 acc[4] = {zero256(), zero256(), zero256(), zero256()};
+                        const Fixed *src = line + j - radius * step;
+#ifdef USE_FIXED_POINT
+                        for (int k = 0; k < lastTap; k++)
+                        {
+                            __m256i weight = _mm256_set1_epi32(taps[k].raw);
+                            for (int q = 0; q < 4; q++)
+                            {
+                                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + k * step + q * 8));
+                                if (symmetric && k != radius)
+                                {
+                                    v = _mm256_add_epi32(v, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + (size - 1 - k) * step + q * 8)));
+                                }
+                                acc[q] = _mm256_add_epi32(acc[q], _mm256_mullo_epi32(v, weight));
+                            }
+                        }
+#else
+                        for (int k = 0; k < size; k++)
+                        {
+                            for (int q = 0; q < 4; q++)
+                            {
+                                __m256 v = _mm256_loadu_ps(src + k * step + q * 8);
+                                acc[q] = madd256(acc[q], v, taps[k]);
+                            }
+                        }
+#endif
+                        store256(dst + j, acc, SEPARABLE_FRAC);
+                    }
+                    horizontalPassSse41(line, taps, size, step, dst, j, end);
+                }
+#endif // SIMD_X86
+
+                const KernelTable scalarTable = {IsaLevel::SCALAR, "scalar",
+                                                 denseRowScalar, verticalPassScalar, horizontalPassScalar};
+#ifdef SIMD_X86
+                const KernelTable sse41Table = {IsaLevel::SSE41, "sse4.1",
+                                                denseRowSse41, verticalPassSse41, horizontalPassSse41};
+                const KernelTable avx2Table = {IsaLevel::AVX2, "avx2",
+                                               denseRowAvx2, verticalPassAvx2, horizontalPassAvx2};
+#endif
+
+                const KernelTable *tableFor(IsaLevel level)
+                {
+                    switch (level)
+                    {
+#ifdef SIMD_X86
+                    case IsaLevel::AVX2:
+                        return &avx2Table;
+                    case IsaLevel::SSE41:
+                        return &sse41Table;
+#endif
+                    default:
+                        return &scalarTable;
+                    }
+                }
+
+                std::atomic<const KernelTable *> activeTable(nullptr);
+            }
+
+            IsaLevel detectIsa()
+            {
+#ifdef SIMD_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2"))
+                    return IsaLevel::AVX2;
+                if (__builtin_cpu_supports("sse4.1"))
+                    return IsaLevel::SSE41;
+#endif
+                return IsaLevel::SCALAR;
+            }
+
+            const KernelTable &kernels()
+            {
+                const KernelTable *table = activeTable.load(std::memory_order_acquire);
+                if (!table)
+                {
+                    table = tableFor(detectIsa());
+                    activeTable.store(table, std::memory_order_release);
+                    LOG_INFO("Convolution kernels: " << table->name);
+                }
+                return *table;
+            }
+
+            bool selectIsa(IsaLevel level)
+            {
+                if (level > detectIsa())
+                    return false;
+
+                activeTable.store(tableFor(level), std::memory_order_release);
+                LOG_INFO("Convolution kernels forced to " << tableFor(level)->name);
+                return true;
+            }
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include "smoothing_filter.h"
 #include "fixed_point.h"
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 
 namespace hardware
@@ -31,87 +32,85 @@ namespace hardware
 
             std::cout << "[SMOOTH] Processing interior pixels..." << std::endl;
 
-            for (int y = 1; y < height - 1; y++)
+            applyRows(input, output, width, height);
+
+            std::cout << "[SMOOTH] Filter applied successfully." << std::endl;
+        }
+
+        namespace
+        {
+            // Shared by RGB frames and gray planes: reads and writes intensities only
+            template <typename T>
+            void smoothRows(const BasicRowBand<T> &band)
             {
-                for (int x = 1; x < width - 1; x++)
+                int width = band.width;
+                int height = band.height;
+                bool padded = band.padded();
+
+                // Padded rows have their borders filled in: filter every column
+                int x0 = padded ? 0 : 1;
+                int x1 = padded ? width : width - 1;
+
+                for (int y = band.y0; y < band.y1; y++)
                 {
-#ifdef USE_FIXED_POINT
-                    Fixed sum = 0;
-                    for (int dy = -1; dy <= 1; dy++)
+                    const T *center = band.inputRow(y);
+                    T *out = band.outputRow(y);
+
+                    // Top/bottom borders (and frames too small to filter) pass through
+                    if (!padded && (y < 1 || y >= height - 1 || width <= 2 || height <= 2))
                     {
-                        for (int dx = -1; dx <= 1; dx++)
+                        memcpy(out, center, width * sizeof(T));
+                        continue;
+                    }
+
+                    const T *window[3] = {band.inputRow(y - 1), center, band.inputRow(y + 1)};
+
+                    for (int x = x0; x < x1; x++)
+                    {
+#ifdef USE_FIXED_POINT
+                        Fixed sum = 0;
+                        for (int dy = 0; dy < 3; dy++)
                         {
-                            int idx = (y + dy) * width + (x + dx);
-                            // Debug bounds check
-                            if (idx < 0 || idx >= width * height)
+                            for (int dx = -1; dx <= 1; dx++)
                             {
-                                std::cerr << "[SMOOTH] ERROR: Index out of bounds! idx=" << idx
-                                          << " max=" << (width * height - 1) << std::endl;
-                                continue;
+                                sum += TO_FIXED(intensity(window[dy][x + dx]));
                             }
-                            sum += TO_FIXED(input[idx].r);
                         }
-                    }
-                    // For fixed point: sum is scaled by FP_SCALE, divide by 9 to get average
-                    uint8_t avg = FROM_FIXED(sum / 9);
+                        // For fixed point: sum is scaled by FP_SCALE, divide by 9 to get average
+                        uint8_t avg = FROM_FIXED(sum / 9);
 #else
-                    float sum = 0.0f;
-                    for (int dy = -1; dy <= 1; dy++)
-                    {
-                        for (int dx = -1; dx <= 1; dx++)
+                        float sum = 0.0f;
+                        for (int dy = 0; dy < 3; dy++)
                         {
-                            int idx = (y + dy) * width + (x + dx);
-                            // Debug bounds check
-                            if (idx < 0 || idx >= width * height)
+                            for (int dx = -1; dx <= 1; dx++)
                             {
-                                std::cerr << "[SMOOTH] ERROR: Index out of bounds! idx=" << idx
-                                          << " max=" << (width * height - 1) << std::endl;
-                                continue;
+                                sum += intensity(window[dy][x + dx]);
                             }
-                            sum += input[idx].r;
                         }
-                    }
-                    uint8_t avg = (uint8_t)(sum / 9.0f);
+                        uint8_t avg = (uint8_t)(sum / 9.0f);
 #endif
 
-                    int idx = y * width + x;
+                        setIntensity(out[x], avg);
+                    }
 
-                    // Debug bounds check for output
-                    if (idx < 0 || idx >= width * height)
+                    // Left/right borders
+                    if (!padded)
                     {
-                        std::cerr << "[SMOOTH] ERROR: Output index out of bounds!" << std::endl;
-                        continue;
+                        out[0] = center[0];
+                        out[width - 1] = center[width - 1];
                     }
-
-                    output[idx].r = output[idx].g = output[idx].b = avg;
-                }
-            }
-
-            std::cout << "[SMOOTH] Copying borders..." << std::endl;
-
-            // Borders - top and bottom
-            for (int x = 0; x < width; x++)
-            {
-                if (x < width * height)
-                    output[x] = input[x];
-                if ((height - 1) * width + x < width * height)
-                {
-                    output[(height - 1) * width + x] = input[(height - 1) * width + x];
                 }
             }
+        }
 
-            // Borders - left and right
-            for (int y = 0; y < height; y++)
-            {
-                if (y * width < width * height)
-                    output[y * width] = input[y * width];
-                if (y * width + width - 1 < width * height)
-                {
-                    output[y * width + width - 1] = input[y * width + width - 1];
-                }
-            }
+        void SmoothingFilter::processRows(const RowBand &band)
+        {
+            smoothRows(band);
+        }
 
-            std::cout << "[SMOOTH] Filter applied successfully." << std::endl;
+        void SmoothingFilter::processRows(const GrayRowBand &band)
+        {
+            smoothRows(band);
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+#include "config.h"
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        ThreadPool::ThreadPool(int threadCount)
+            : job(nullptr), jobCount(0), nextTask(0), pendingWorkers(0),
+              generation(0), stopping(false)
+        {
+            for (int i = 1; i < threadCount; i++)
+            {
+                workers.emplace_back(&ThreadPool::workerLoop, this);
+            }
+            LOG_INFO("ThreadPool created with " << getThreadCount() << " thread(s)");
+        }
+
+        ThreadPool::~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        void ThreadPool::runTasks()
+        {
+            int task;
+            while ((task = nextTask.fetch_add(1)) < jobCount)
+            {
+                (*job)(task);
+            }
+        }
+
+        void ThreadPool::workerLoop()
+        {
+            unsigned seen = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping)
+                        return;
+                    seen = generation;
+                }
+
+                runTasks();
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pendingWorkers == 0)
+                    done.notify_one();
+            }
+        }
+
+        void ThreadPool::parallelFor(int count, const std::function<void(int)> &task)
+        {
+            if (workers.empty() || count <= 1)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    task(i);
+                }
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = &task;
+                jobCount = count;
+                nextTask = 0;
+                pendingWorkers = static_cast<int>(workers.size());
+                generation++;
+            }
+            wake.notify_all();
+
+            runTasks();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return pendingWorkers == 0; });
+            job = nullptr;
+        }
+    }
+}
@@ -0,0 +1,263 @@
+#include "tiled_image.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace hardware
+{
+    namespace pipeline
+    {
+        using namespace std;
+
+        namespace
+        {
+            const char MAGIC[8] = {'H', 'W', 'T', 'I', 'L', 'E', 'S', '1'};
+            constexpr size_t FIELDS_BYTES = 8 + 4 * sizeof(uint32_t);
+            constexpr size_t PAGE_BYTES = 4096;
+
+            size_t roundUp(size_t bytes, size_t unit)
+            {
+                return (bytes + unit - 1) / unit * unit;
+            }
+        }
+
+        TiledImage::TiledImage()
+            : base(nullptr), length(0), writable(false), width(0), height(0), tileSize(0), channels(0),
+              tilesAcross(0), tilesDown(0), index(nullptr)
+        {
+        }
+
+        TiledImage::~TiledImage()
+        {
+            close();
+        }
+
+        bool TiledImage::open(const char *filename)
+        {
+            close();
+            path = filename;
+
+            int fd = ::open(filename, O_RDONLY);
+            if (fd < 0)
+            {
+                cerr << "[ERROR] Could not open file " << filename << endl;
+                return false;
+            }
+
+            struct stat info;
+            if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < FIELDS_BYTES)
+            {
+                cerr << "Error: Malformed tiled image header in " << filename << endl;
+                ::close(fd);
+                return false;
+            }
+
+            length = static_cast<size_t>(info.st_size);
+            void *region = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (region == MAP_FAILED)
+            {
+                cerr << "[ERROR] Could not map file " << filename << endl;
+                length = 0;
+                return false;
+            }
+            base = static_cast<uint8_t *>(region);
+
+            uint32_t fields[4];
+            memcpy(fields, base + 8, sizeof(fields));
+            width = static_cast<int>(fields[0]);
+            height = static_cast<int>(fields[1]);
+            tileSize = static_cast<int>(fields[2]);
+            channels = static_cast<int>(fields[3]);
+            bool valid = memcmp(base, MAGIC, sizeof(MAGIC)) == 0 &&
+                         fields[0] > 0 && fields[0] <= (1u << 24) && fields[1] > 0 && fields[1] <= (1u << 24) &&
+                         fields[2] > 0 && fields[2] <= (1u << 14) && (fields[3] == 1 || fields[3] == 3);
+            if (valid)
+            {
+                tilesAcross = (width + tileSize - 1) / tileSize;
+                tilesDown = (height + tileSize - 1) / tileSize;
+                size_t count = static_cast<size_t>(tilesAcross) * tilesDown;
+                valid = FIELDS_BYTES + count * sizeof(uint64_t) <= length;
+
+                // Every tile has to lie inside the file
+                index = reinterpret_cast<const uint64_t *>(base + FIELDS_BYTES);
+                for (size_t i = 0; i < count && valid; i++)
+                {
+                    valid = index[i] >= FIELDS_BYTES && index[i] <= length && length - index[i] >= tileBytes();
+                }
+            }
+
+            if (!valid)
+            {
+                cerr << "Error: Malformed or truncated tiled image " << filename << endl;
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        bool TiledImage::create(const char *filename, int w, int h, int channelCount, int size)
+        {
+            close();
+            path = filename;
+            width = w;
+            height = h;
+            tileSize = size;
+            channels = channelCount;
+            tilesAcross = (width + tileSize - 1) / tileSize;
+            tilesDown = (height + tileSize - 1) / tileSize;
+
+            size_t count = static_cast<size_t>(tilesAcross) * tilesDown;
+            size_t firstTile = roundUp(FIELDS_BYTES + count * sizeof(uint64_t), PAGE_BYTES);
+            size_t stride = roundUp(tileBytes(), PAGE_BYTES);
+            length = firstTile + count * stride;
+
+            int fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+            {
+                cerr << "Error: could not write to file " << filename << endl;
+                return false;
+            }
+
+            // Reserve the blocks now: running out of space while writing
+            // through the mapping would fault instead of failing a call
+            int reserved = posix_fallocate(fd, 0, static_cast<off_t>(length));
+            if (reserved != 0 && reserved != EOPNOTSUPP && reserved != EINVAL)
+            {
+                cerr << "Error: Could not reserve " << length << " bytes for " << filename << endl;
+                ::close(fd);
+                return false;
+            }
+            if (reserved != 0 && ftruncate(fd, static_cast<off_t>(length)) != 0)
+            {
+                cerr << "Error: Failed to write to file " << filename << endl;
+                ::close(fd);
+                return false;
+            }
+
+            void *region = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (region == MAP_FAILED)
+            {
+                cerr << "[ERROR] Could not map file " << filename << endl;
+                length = 0;
+                return false;
+            }
+            base = static_cast<uint8_t *>(region);
+            writable = true;
+
+            uint32_t fields[4] = {static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+                                  static_cast<uint32_t>(tileSize), static_cast<uint32_t>(channels)};
+            memcpy(base, MAGIC, sizeof(MAGIC));
+            memcpy(base + 8, fields, sizeof(fields));
+            uint64_t *offsets = reinterpret_cast<uint64_t *>(base + FIELDS_BYTES);
+            for (size_t i = 0; i < count; i++)
+            {
+                offsets[i] = firstTile + i * stride;
+            }
+            index = offsets;
+            return true;
+        }
+
+        bool TiledImage::close()
+        {
+            if (!base)
+                return false;
+
+            bool ok = !writable || msync(base, length, MS_SYNC) == 0;
+            munmap(base, length);
+            base = nullptr;
+            index = nullptr;
+            length = 0;
+            writable = false;
+            if (!ok)
+            {
+                cerr << "Error: Failed to write to file " << path << endl;
+            }
+            return ok;
+        }
+
+        void TiledImage::readRegion(int x0, int y0, int w, int h, pixel *out, size_t stride) const
+        {
+            for (int y = y0; y < y0 + h; y++)
+            {
+                pixel *dst = out + static_cast<size_t>(y - y0) * stride;
+                int x = x0;
+                while (x < x0 + w)
+                {
+                    // The run of this row inside one tile
+                    int tx = x / tileSize;
+                    int count = std::min(x0 + w, (tx + 1) * tileSize) - x;
+                    const uint8_t *src = tileRow(tx, y) + static_cast<size_t>(x - tx * tileSize) * channels;
+                    if (channels == 3)
+                    {
+                        memcpy(dst, src, static_cast<size_t>(count) * sizeof(pixel));
+                    }
+                    else
+                    {
+                        for (int i = 0; i < count; i++)
+                        {
+                            dst[i].r = dst[i].g = dst[i].b = src[i];
+                        }
+                    }
+                    dst += count;
+                    x += count;
+                }
+            }
+        }
+
+        void TiledImage::readRow(int y, uint8_t *samples) const
+        {
+            for (int tx = 0; tx < tilesAcross; tx++)
+            {
+                int count = std::min(tileSize, width - tx * tileSize);
+                memcpy(samples + static_cast<size_t>(tx) * tileSize * channels, tileRow(tx, y),
+                       static_cast<size_t>(count) * channels);
+            }
+        }
+
+        void TiledImage::writeRow(int y, const uint8_t *samples)
+        {
+            for (int tx = 0; tx < tilesAcross; tx++)
+            {
+                int count = std::min(tileSize, width - tx * tileSize);
+                memcpy(tileRow(tx, y), samples + static_cast<size_t>(tx) * tileSize * channels,
+                       static_cast<size_t>(count) * channels);
+            }
+        }
+
+        void TiledImage::releaseTileRows(int first, int last) const
+        {
+            // Whole pages inside each tile; written pages stay dirty in the
+            // page cache and are written back from there
+            for (int ty = std::max(first, 0); ty < std::min(last, tilesDown); ty++)
+            {
+                for (int tx = 0; tx < tilesAcross; tx++)
+                {
+                    size_t offset = index[static_cast<size_t>(ty) * tilesAcross + tx];
+                    size_t begin = roundUp(offset, PAGE_BYTES);
+                    size_t end = (offset + tileBytes()) / PAGE_BYTES * PAGE_BYTES;
+                    if (begin < end)
+                        madvise(base + begin, end - begin, MADV_DONTNEED);
+                }
+            }
+        }
+
+        bool isTiledImage(const char *filename)
+        {
+            char magic[sizeof(MAGIC)];
+            int fd = ::open(filename, O_RDONLY);
+            if (fd < 0)
+                return false;
+            bool tiled = read(fd, magic, sizeof(magic)) == static_cast<ssize_t>(sizeof(magic)) &&
+                         memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+            ::close(fd);
+            return tiled;
+        }
+    }
+}
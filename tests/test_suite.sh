@@ -163,6 +163,225 @@ else
     TOTAL=$((TOTAL - 1))
 fi
 
+echo ""
+echo "Phase 4b: Binary Formats"
+echo "------------------------"
+
+mkdir -p output/binary
+
+# Binary RGB (P6) and grayscale (P5) versions of a 4x4 image
+{ printf 'P6\n# binary rgb\n4 4\n255\n'; head -c 48 /dev/urandom; } > output/binary/simple_p6.ppm
+{ printf 'P5\n4 4\n255\n'; head -c 16 /dev/urandom; } > output/binary/simple_p5.pgm
+
+safe_run "P6 input" "./bin/pipeline_sim output/binary/simple_p6.ppm output/binary/p6.ppm" 0 5
+if head -c 2 output/binary/p6.ppm 2>/dev/null | grep -q "P6"; then
+    echo -e "  ${GREEN}✓${NC} P6 output written"
+else
+    echo -e "  ${RED}✗${NC} P6 output missing"
+fi
+
+safe_run "P5 input" "./bin/pipeline_sim output/binary/simple_p5.pgm output/binary/p5.pgm --mode=conv" 0 5
+# Gray planes are written as-is: 11 header bytes + one byte per pixel
+safe_run "P5 output is one byte per pixel" "test \$(wc -c < output/binary/p5.pgm) -eq 27" 0 2
+safe_run "Truncated P6 rejected" "printf 'P6\n4 4\n255\n' > output/binary/bad.ppm && ./bin/pipeline_sim output/binary/bad.ppm output/binary/bad_out.ppm" 1 5
+
+# ASCII payloads: comments anywhere, malformed samples rejected
+printf 'P3\n2 2\n255\n10 20 30 40 50 60\n70 80 90 100 110 120\n' > output/binary/plain_p3.ppm
+printf 'P3\n# header\n2 2\n255\n10 20 30 # first\n40 50 60\n# whole line\n70 80 90\t100 110 120' > output/binary/comment_p3.ppm
+./bin/pipeline_sim output/binary/plain_p3.ppm output/binary/plain_out.ppm > /dev/null 2>&1
+safe_run "P3 comments in payload" "./bin/pipeline_sim output/binary/comment_p3.ppm output/binary/comment_out.ppm && cmp -s output/binary/plain_out.ppm output/binary/comment_out.ppm" 0 5
+safe_run "Truncated P3 rejected" "printf 'P3\n2 2\n255\n1 2 3 4 5 6 7 8 9 10 11\n' > output/binary/bad.ppm && ./bin/pipeline_sim output/binary/bad.ppm output/binary/bad_out.ppm" 1 5
+safe_run "Malformed P3 sample rejected" "printf 'P3\n2 2\n255\n1 2 3 4 5 6 7 8 9 10 11 x12\n' > output/binary/bad.ppm && ./bin/pipeline_sim output/binary/bad.ppm output/binary/bad_out.ppm" 1 5
+safe_run "P3 sample above maxval rejected" "printf 'P3\n2 2\n100\n1 2 3 4 5 6 7 8 9 10 11 101\n' > output/binary/bad.ppm && ./bin/pipeline_sim output/binary/bad.ppm output/binary/bad_out.ppm" 1 5
+
+# Samples of a smaller maxval are rescaled to 255, which the writers emit
+printf 'P5\n2 2\n15\n\0\5\12\17' > output/binary/max15_p5.pgm
+printf 'P5\n2 2\n255\n\0\125\252\377' > output/binary/max255_p5.pgm
+printf 'P6\n2 2\n100\n\0\12\24\36\50\62\74\106\120\132\144\144' > output/binary/max100_p6.ppm
+printf 'P6\n2 2\n255\n\0\32\63\115\146\200\231\263\314\346\377\377' > output/binary/max255_p6.ppm
+printf 'P3\n2 2\n100\n0 10 20 30 40 50\n60 70 80 90 100 100\n' > output/binary/max100_p3.ppm
+printf 'P3\n2 2\n255\n0 26 51 77 102 128\n153 179 204 230 255 255\n' > output/binary/max255_p3.ppm
+for f in max255_p5.pgm max255_p6.ppm max255_p3.ppm; do
+    ./bin/pipeline_sim output/binary/$f output/binary/out_$f --mode=conv > /dev/null 2>&1
+done
+safe_run "P5 maxval 15 rescaled" "./bin/pipeline_sim output/binary/max15_p5.pgm output/binary/out_max15_p5.pgm --mode=conv && cmp -s output/binary/out_max255_p5.pgm output/binary/out_max15_p5.pgm" 0 5
+safe_run "P6 maxval 100 rescaled" "./bin/pipeline_sim output/binary/max100_p6.ppm output/binary/out_max100_p6.ppm --mode=conv && cmp -s output/binary/out_max255_p6.ppm output/binary/out_max100_p6.ppm" 0 5
+safe_run "P3 maxval 100 rescaled" "./bin/pipeline_sim output/binary/max100_p3.ppm output/binary/out_max100_p3.ppm --mode=conv && cmp -s output/binary/out_max255_p3.ppm output/binary/out_max100_p3.ppm" 0 5
+for f in max15_p5.pgm max100_p6.ppm max100_p3.ppm; do
+    safe_run "Streaming rescales $f" "./bin/pipeline_sim output/binary/$f output/binary/stream_$f --mode=conv --exec=stream && cmp -s output/binary/out_$f output/binary/stream_$f" 0 5
+done
+
+# QOI, selected by the .qoi extension; gray results use the one-channel variant
+./bin/pipeline_sim assets/gradient.ppm output/binary/gradient.qoi --mode=conv > /dev/null 2>&1
+./bin/pipeline_sim assets/gradient.ppm output/binary/gradient_conv.ppm --mode=conv > /dev/null 2>&1
+safe_run "QOI output" "head -c 4 output/binary/gradient.qoi | grep -q qoif" 0 2
+safe_run "--mode=all keeps the output extension" "./bin/pipeline_sim assets/simple.ppm output/binary/all.qoi --mode=all && head -c 4 output/binary/all_basic.qoi | grep -q qoif && head -c 4 output/binary/all_conv.qoi | grep -q qoif && test ! -e output/binary/all_basic.ppm" 0 20
+safe_run "QOI gray variant for gray results" "test \$(od -An -tu1 -j12 -N1 output/binary/gradient.qoi) -eq 1" 0 2
+safe_run "QOI smaller than P3" "test \$(wc -c < output/binary/gradient.qoi) -lt \$(( \$(wc -c < output/binary/gradient_conv.ppm) / 4 ))" 0 2
+safe_run "QOI round trip is lossless" "./bin/pipeline_sim output/binary/gradient.qoi output/binary/twice_qoi.qoi --mode=conv && ./bin/pipeline_sim output/binary/gradient_conv.ppm output/binary/twice_ppm.qoi --mode=conv && cmp -s output/binary/twice_qoi.qoi output/binary/twice_ppm.qoi" 0 5
+safe_run "QOI streaming matches frame" "./bin/pipeline_sim output/binary/gradient.qoi output/binary/twice_stream.qoi --mode=conv --exec=stream && cmp -s output/binary/twice_qoi.qoi output/binary/twice_stream.qoi" 0 5
+# 2x2 RGB by hand: RGB, DIFF, LUMA and INDEX ops, then the end marker
+printf 'qoif\0\0\0\2\0\0\0\2\3\0\376\n\024\036\171\245\153\011\0\0\0\0\0\0\0\1' > output/binary/rgb.qoi
+printf 'P6\n2 2\n255\n\n\024\036\013\024\035\016\031\045\n\024\036' > output/binary/rgb_p6.ppm
+./bin/pipeline_sim output/binary/rgb_p6.ppm output/binary/rgb_p6_out.ppm --mode=conv > /dev/null 2>&1
+safe_run "QOI RGB ops decoded" "./bin/pipeline_sim output/binary/rgb.qoi output/binary/rgb_out.ppm --mode=conv && cmp -s output/binary/rgb_p6_out.ppm output/binary/rgb_out.ppm" 0 5
+safe_run "Truncated QOI rejected" "head -c 100 output/binary/gradient.qoi > output/binary/bad.qoi && ./bin/pipeline_sim output/binary/bad.qoi output/binary/bad_out.ppm" 1 5
+
+# Tiled out-of-core images (.tiles): 3x2 tiles of 512, frame mode runs them tile by tile
+{ printf 'P5\n1100 600\n255\n'; head -c 660000 /dev/urandom; } > output/binary/noise.pgm
+./bin/pipeline_sim output/binary/noise.pgm output/binary/noise.tiles --mode=conv --exec=stream > /dev/null 2>&1
+./bin/pipeline_sim output/binary/noise.pgm output/binary/noise_conv.pgm --mode=conv > /dev/null 2>&1
+safe_run "Tiled output" "head -c 8 output/binary/noise.tiles | grep -q HWTILES1" 0 2
+for b in copy mirror; do
+    ./bin/pipeline_sim output/binary/noise_conv.pgm output/binary/frame_$b.pgm --mode=conv --border=$b > /dev/null 2>&1
+    safe_run "Tiled run matches frame (--border=$b)" "./bin/pipeline_sim output/binary/noise.tiles output/binary/tiled_$b.pgm --mode=conv --border=$b && cmp -s output/binary/frame_$b.pgm output/binary/tiled_$b.pgm" 0 10
+done
+./bin/pipeline_sim output/binary/noise_conv.pgm output/binary/frame_unsharp.pgm --mode=unsharp --sigma=3 > /dev/null 2>&1
+safe_run "Tiled FFT unsharp matches frame" "./bin/pipeline_sim output/binary/noise.tiles output/binary/tiled_unsharp.pgm --mode=unsharp --sigma=3 && cmp -s output/binary/frame_unsharp.pgm output/binary/tiled_unsharp.pgm" 0 20
+safe_run "Tiled streaming matches frame" "./bin/pipeline_sim output/binary/noise.tiles output/binary/tiled_stream.pgm --mode=conv --exec=stream && cmp -s output/binary/frame_copy.pgm output/binary/tiled_stream.pgm" 0 10
+safe_run "Truncated tiled image rejected" "head -c 4096 output/binary/noise.tiles > output/binary/bad.tiles && ./bin/pipeline_sim output/binary/bad.tiles output/binary/bad_out.pgm" 1 5
+
+echo ""
+echo "Phase 4c: Execution Modes"
+echo "-------------------------"
+
+mkdir -p output/exec
+for m in basic conv; do
+    safe_run "--exec=stream ($m)" "./bin/pipeline_sim assets/gradient.ppm output/exec/stream_$m.ppm --mode=$m --exec=stream" 0 10
+    ./bin/pipeline_sim assets/gradient.ppm output/exec/frame_$m.ppm --mode=$m > /dev/null 2>&1
+    safe_run "Streaming matches frame ($m)" "cmp -s output/exec/frame_$m.ppm output/exec/stream_$m.ppm" 0 2
+    safe_run "--threads=4 ($m)" "./bin/pipeline_sim assets/gradient.ppm output/exec/threads_$m.ppm --mode=$m --threads=4" 0 10
+    safe_run "Threaded matches serial ($m)" "cmp -s output/exec/frame_$m.ppm output/exec/threads_$m.ppm" 0 2
+    safe_run "--fuse=off ($m)" "./bin/pipeline_sim assets/gradient.ppm output/exec/unfused_$m.ppm --mode=$m --fuse=off" 0 10
+    safe_run "Fused matches unfused ($m)" "cmp -s output/exec/frame_$m.ppm output/exec/unfused_$m.ppm" 0 2
+    safe_run "Lazy matches frame ($m)" "./bin/pipeline_sim assets/gradient.ppm output/exec/lazy_$m.ppm --mode=$m --exec=lazy && cmp -s output/exec/frame_$m.ppm output/exec/lazy_$m.ppm" 0 10
+done
+
+# Streaming decodes and encodes row by row: every encoding, and bad input
+for f in simple_p6.ppm simple_p5.pgm comment_p3.ppm; do
+    ./bin/pipeline_sim output/binary/$f output/exec/frame_$f --mode=conv > /dev/null 2>&1
+    safe_run "Streaming matches frame ($f)" "./bin/pipeline_sim output/binary/$f output/exec/stream_$f --mode=conv --exec=stream && cmp -s output/exec/frame_$f output/exec/stream_$f" 0 5
+done
+# A comment long enough to run past the streaming reader's first 64 KiB buffer
+for c in 0 1; do
+    awk -v comment=$c 'BEGIN { printf "P3\n200 200\n255\n"; n = 15
+        for (i = 0; i < 40000; i++) {
+            if (comment && n > 63000) { line = "#"; for (k = 0; k < 1500; k++) line = line " " k % 10; print line; n += length(line) + 1; comment = 0 }
+            line = sprintf("%d %d %d", i * 7 % 256, i * 13 % 256, i * 31 % 256); print line; n += length(line) + 1 } }' > output/exec/long_comment_$c.ppm
+done
+./bin/pipeline_sim output/exec/long_comment_0.ppm output/exec/long_comment_plain.ppm --mode=conv > /dev/null 2>&1
+./bin/pipeline_sim output/exec/long_comment_1.ppm output/exec/long_comment_frame.ppm --mode=conv > /dev/null 2>&1
+safe_run "Streaming skips a comment across buffer refills" "./bin/pipeline_sim output/exec/long_comment_1.ppm output/exec/long_comment_stream.ppm --mode=conv --exec=stream && cmp -s output/exec/long_comment_frame.ppm output/exec/long_comment_stream.ppm && cmp -s output/exec/long_comment_plain.ppm output/exec/long_comment_stream.ppm" 0 10
+safe_run "Truncated input rejected while streaming" "head -c 3000 assets/gradient.ppm > output/exec/truncated.ppm && ./bin/pipeline_sim output/exec/truncated.ppm output/exec/truncated_out.ppm --mode=conv --exec=stream || { test ! -e output/exec/truncated_out.ppm && false; }" 1 5
+
+for b in replicate mirror constant:40; do
+    ./bin/pipeline_sim assets/gradient.ppm output/exec/border_frame.ppm --mode=conv --border=$b > /dev/null 2>&1
+    safe_run "--border=$b streaming matches frame" "./bin/pipeline_sim assets/gradient.ppm output/exec/border_stream.ppm --mode=conv --border=$b --exec=stream && cmp -s output/exec/border_frame.ppm output/exec/border_stream.ppm" 0 10
+    safe_run "--border=$b threaded matches frame" "./bin/pipeline_sim assets/gradient.ppm output/exec/border_threads.ppm --mode=conv --border=$b --threads=4 && cmp -s output/exec/border_frame.ppm output/exec/border_threads.ppm" 0 10
+done
+./bin/pipeline_sim assets/test_pattern.ppm output/exec/box_frame.ppm --mode=box --radius=7 > /dev/null 2>&1
+safe_run "--mode=box streaming matches frame" "./bin/pipeline_sim assets/test_pattern.ppm output/exec/box_stream.ppm --mode=box --radius=7 --exec=stream && cmp -s output/exec/box_frame.ppm output/exec/box_stream.ppm" 0 10
+./bin/pipeline_sim assets/test_pattern.ppm output/exec/box_frame_mirror.ppm --mode=box --radius=7 --border=mirror > /dev/null 2>&1
+safe_run "--mode=box streaming matches frame (mirror border)" "./bin/pipeline_sim assets/test_pattern.ppm output/exec/box_stream_mirror.ppm --mode=box --radius=7 --border=mirror --exec=stream && cmp -s output/exec/box_frame_mirror.ppm output/exec/box_stream_mirror.ppm" 0 10
+./bin/pipeline_sim assets/test_pattern.ppm output/exec/threshold.ppm --mode=threshold --radius=3 --border=replicate > /dev/null 2>&1
+safe_run "--mode=threshold output is binary" "test -s output/exec/threshold.ppm && ! tail -n +4 output/exec/threshold.ppm | tr -s ' ' '\\n' | grep -qvxE '0|255'" 0 5
+safe_run "Option in place of the output path" "! ./bin/pipeline_sim assets/simple.ppm --mode=blur && test ! -e ./--mode=blur" 0 2
+safe_run "Invalid radius" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --mode=box --radius=500" 1 2
+./bin/pipeline_sim assets/test_pattern.ppm output/exec/blur_frame.ppm --mode=blur --sigma=8 > /dev/null 2>&1
+safe_run "Recursive blur streaming matches frame" "./bin/pipeline_sim assets/test_pattern.ppm output/exec/blur_stream.ppm --mode=blur --sigma=8 --exec=stream && cmp -s output/exec/blur_frame.ppm output/exec/blur_stream.ppm" 0 10
+safe_run "Recursive blur threaded matches frame" "./bin/pipeline_sim assets/test_pattern.ppm output/exec/blur_threads.ppm --mode=blur --sigma=8 --threads=3 && cmp -s output/exec/blur_frame.ppm output/exec/blur_threads.ppm" 0 10
+./bin/pipeline_sim assets/test_pattern.ppm output/exec/unsharp_frame.ppm --mode=unsharp --sigma=4 > /dev/null 2>&1
+safe_run "FFT unsharp streaming matches frame" "./bin/pipeline_sim assets/test_pattern.ppm output/exec/unsharp_stream.ppm --mode=unsharp --sigma=4 --exec=stream && cmp -s output/exec/unsharp_frame.ppm output/exec/unsharp_stream.ppm" 0 20
+safe_run "FFT unsharp threaded matches frame" "./bin/pipeline_sim assets/test_pattern.ppm output/exec/unsharp_threads.ppm --mode=unsharp --sigma=4 --threads=3 && cmp -s output/exec/unsharp_frame.ppm output/exec/unsharp_threads.ppm" 0 20
+./bin/pipeline_sim assets/gradient.ppm output/exec/unsharp_mirror.ppm --mode=unsharp --sigma=4 --border=mirror > /dev/null 2>&1
+safe_run "FFT unsharp --border=mirror streaming matches frame" "./bin/pipeline_sim assets/gradient.ppm output/exec/unsharp_mirror_stream.ppm --mode=unsharp --sigma=4 --border=mirror --exec=stream && cmp -s output/exec/unsharp_mirror.ppm output/exec/unsharp_mirror_stream.ppm" 0 20
+safe_run "Invalid sigma" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --mode=blur --sigma=100" 1 2
+safe_run "Invalid border mode" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --border=wrap" 1 2
+
+# Regions of interest: the output is the same rectangle of a whole-frame run
+crop_pgm() {
+    local width=$(head -n 2 "$1" | tail -n 1 | cut -d' ' -f1)
+    local header=$(head -n 3 "$1" | wc -c)
+    { printf 'P5\n%d %d\n255\n' $4 $5
+      for ((r = $3; r < $3 + $5; r++)); do tail -c +$((header + r * width + $2 + 1)) "$1" | head -c $4; done; } > "$6"
+}
+for b in copy mirror; do
+    ./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_full.pgm --mode=conv --border=$b > /dev/null 2>&1
+    crop_pgm output/exec/roi_full.pgm 300 200 120 40 output/exec/roi_expected.pgm
+    safe_run "--roi matches frame (--border=$b)" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi.pgm --mode=conv --border=$b --roi=300,200,120,40 && cmp -s output/exec/roi_expected.pgm output/exec/roi.pgm" 0 10
+    safe_run "--roi streaming matches frame (--border=$b)" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_stream.pgm --mode=conv --border=$b --roi=300,200,120,40 --exec=stream && cmp -s output/exec/roi_expected.pgm output/exec/roi_stream.pgm" 0 10
+    safe_run "--roi lazy matches frame (--border=$b)" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_lazy.pgm --mode=conv --border=$b --roi=300,200,120,40 --exec=lazy && cmp -s output/exec/roi_expected.pgm output/exec/roi_lazy.pgm" 0 10
+done
+safe_run "Lazy --roi computes only its tiles" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_lazy.pgm --mode=conv --roi=0,0,10,10 --exec=lazy | grep -q 'Lazy level 2 .*: 1 tile(s) computed'" 0 10
+crop_pgm output/exec/roi_full.pgm 1050 0 50 30 output/exec/roi_expected.pgm
+safe_run "--roi clipped to the frame" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_edge.pgm --mode=conv --border=mirror --roi=1050,0,80,30 --threads=3 && cmp -s output/exec/roi_expected.pgm output/exec/roi_edge.pgm" 0 10
+./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_unsharp_full.pgm --mode=unsharp --sigma=3 > /dev/null 2>&1
+crop_pgm output/exec/roi_unsharp_full.pgm 500 250 300 200 output/exec/roi_unsharp_expected.pgm
+safe_run "--roi FFT unsharp matches frame" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_unsharp.pgm --mode=unsharp --sigma=3 --roi=500,250,300,200 && cmp -s output/exec/roi_unsharp_expected.pgm output/exec/roi_unsharp.pgm" 0 20
+./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_blur_full.pgm --mode=blur --sigma=8 > /dev/null 2>&1
+crop_pgm output/exec/roi_blur_full.pgm 137 121 300 180 output/exec/roi_blur_expected.pgm
+safe_run "--roi recursive blur matches frame" "./bin/pipeline_sim output/binary/noise.pgm output/exec/roi_blur.pgm --mode=blur --sigma=8 --roi=137,121,300,180 && cmp -s output/exec/roi_blur_expected.pgm output/exec/roi_blur.pgm" 0 20
+safe_run "--roi outside the frame rejected" "./bin/pipeline_sim output/binary/noise.pgm output/exec/bad.pgm --roi=2000,0,10,10" 1 5
+safe_run "--roi on tiled image needs lazy mode" "./bin/pipeline_sim output/binary/noise.tiles output/exec/bad.pgm --roi=0,0,10,10" 1 5
+crop_pgm output/binary/frame_mirror.pgm 500 250 200 100 output/exec/roi_expected.pgm
+safe_run "--roi lazy on tiled image matches frame" "./bin/pipeline_sim output/binary/noise.tiles output/exec/roi_tiled.pgm --mode=conv --border=mirror --roi=500,250,200,100 --exec=lazy && cmp -s output/exec/roi_expected.pgm output/exec/roi_tiled.pgm" 0 10
+safe_run "Invalid region" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --roi=1,2,3" 1 2
+
+safe_run "--simd=scalar" "./bin/pipeline_sim assets/gradient.ppm output/exec/scalar_conv.ppm --mode=conv --simd=scalar" 0 10
+safe_run "SIMD matches scalar" "cmp -s output/exec/frame_conv.ppm output/exec/scalar_conv.ppm" 0 2
+
+# The default build is fixed point; the float kernels run in a release build
+if make release BUILD_DIR=build/release BIN_DIR=bin/release > /dev/null 2>&1; then
+    for m in basic conv unsharp; do
+        ./bin/release/pipeline_sim assets/gradient.ppm output/exec/float_$m.ppm --mode=$m > /dev/null 2>&1
+        safe_run "Float SIMD matches scalar ($m)" "./bin/release/pipeline_sim assets/gradient.ppm output/exec/float_scalar_$m.ppm --mode=$m --simd=scalar && cmp -s output/exec/float_$m.ppm output/exec/float_scalar_$m.ppm" 0 10
+        safe_run "Float streaming matches frame ($m)" "./bin/release/pipeline_sim assets/gradient.ppm output/exec/float_stream_$m.ppm --mode=$m --exec=stream && cmp -s output/exec/float_$m.ppm output/exec/float_stream_$m.ppm" 0 10
+    done
+else
+    safe_run "Float release build" "false" 0 2
+fi
+safe_run "Invalid SIMD level" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --simd=mmx" 1 2
+safe_run "Invalid thread count" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --threads=abc" 1 2
+safe_run "Invalid fusion setting" "./bin/pipeline_sim assets/simple.ppm output/exec/bad.ppm --fuse=maybe" 1 2
+safe_run "--profile reports every stage" "./bin/pipeline_sim assets/gradient.ppm output/exec/profile_conv.ppm --mode=conv --exec=stream --profile | grep -A6 'Profile:' | grep -c '^decode\\|^grayscale\\|^convolution\\|^static convolution\\|^encode' | grep -qx 5" 0 10
+safe_run "Profiled output unchanged" "cmp -s output/exec/stream_conv.ppm output/exec/profile_conv.ppm" 0 2
+safe_run "Hardware model report" "./bin/pipeline_sim assets/gradient.ppm output/exec/hw_model.ppm --mode=conv | grep -q '\\[HW\\]   frame .* fps'" 0 10
+
+echo ""
+echo "Phase 4d: Batch Mode"
+echo "--------------------"
+
+rm -rf output/batch
+mkdir -p output/batch/in
+cp assets/simple.ppm assets/gradient.ppm output/batch/in/
+cp output/binary/simple_p5.pgm output/batch/in/
+safe_run "Batch directory" "./bin/pipeline_sim output/batch/in output/batch/out --batch --io-threads=2 --queue-depth=1" 0 20
+./bin/pipeline_sim assets/gradient.ppm output/batch/single.ppm > /dev/null 2>&1
+safe_run "Batch matches single run" "cmp -s output/batch/single.ppm output/batch/out/gradient.ppm" 0 2
+safe_run "Batch keeps P5 encoding" "head -c 2 output/batch/out/simple_p5.pgm | grep -q P5" 0 2
+printf 'assets/simple.ppm\n# skipped\nassets/missing.ppm\n' > output/batch/list.txt
+safe_run "Batch list with missing file fails" "./bin/pipeline_sim output/batch/list.txt output/batch/list_out --batch" 1 10
+safe_run "Invalid I/O thread count" "./bin/pipeline_sim output/batch/in output/batch/bad --batch --io-threads=0" 1 2
+
+echo ""
+echo "Phase 4e: Library Checks"
+echo "------------------------"
+
+# Filter paths checked against each other in both arithmetic variants
+if make unit > /dev/null 2>&1; then
+    for v in float fixed; do
+        safe_run "Separable matches dense ($v)" "./bin/unit_checks_$v separable" 0 10
+        safe_run "Static kernels match ConvolutionFilter ($v)" "./bin/unit_checks_$v static" 0 10
+        safe_run "FFT convolution matches direct ($v)" "./bin/unit_checks_$v fft" 0 10
+        safe_run "Buffer pool stops allocating after warm-up ($v)" "./bin/unit_checks_$v pool" 0 20
+        safe_run "FIFO keeps order across threads ($v)" "./bin/unit_checks_$v fifo" 0 20
+    done
+    safe_run "Q7.8 known answers (fixed)" "./bin/unit_checks_fixed q78" 0 10
+    safe_run "Hardware model registers and resources (fixed)" "./bin/unit_checks_fixed hwmodel" 0 10
+else
+    safe_run "Library checks build" "false" 0 2
+fi
+
 echo ""
 echo "Phase 5: Output Validation"
 echo "-------------------------"
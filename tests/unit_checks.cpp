@@ -0,0 +1,705 @@
+// Library checks the command-line tests cannot reach: filter paths
+// against each other, known answers and internal counters. Built once per
+// arithmetic variant (float, USE_FIXED_POINT) by `make unit`; every
+// argument names a check, and the exit status is the number that failed.
+
+#include "pipeline.h"
+#include "convolution.h"
+#include "smoothing_filter.h"
+#include "edge_filter.h"
+#include "static_kernel.h"
+#include "fft_convolution.h"
+#include "simd_kernels.h"
+#include "config.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using hardware::pipeline::Pipeline;
+using hardware::pipeline::ExecutionMode;
+using hardware::filters::ConvolutionFilter;
+
+namespace {
+
+    // config.h declares an unrelated global BaseFilter; keep this one local
+    using hardware::filters::BaseFilter;
+
+    // Deterministic, non-constant test frame so no kernel sees a trivial input
+    void fillPattern(pixel* frame, int width, int height) {
+        uint32_t state = 0x12345678u;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                state = state * 1664525u + 1013904223u;
+                pixel& p = frame[static_cast<size_t>(y) * width + x];
+                p.r = static_cast<unsigned char>(state >> 24);
+                p.g = static_cast<unsigned char>((x * 7 + (state >> 28)) & 0xFF);
+                p.b = static_cast<unsigned char>((x ^ y) & 0xFF);
+            }
+        }
+    }
+
+    // Number of samples that differ by more than `tolerance`, reporting the first
+    int compareSamples(const char* what, const uint8_t* expected, const uint8_t* actual, size_t count,
+                       int tolerance = 0) {
+        int mismatches = 0;
+        for (size_t i = 0; i < count; i++) {
+            int difference = std::abs(int(expected[i]) - int(actual[i]));
+            if (difference > tolerance) {
+                if (mismatches == 0) {
+                    std::cerr << "  " << what << ": sample " << i << " is " << int(actual[i]) << ", expected "
+                              << int(expected[i]) << "\n";
+                }
+                mismatches++;
+            }
+        }
+        if (mismatches) {
+            std::cerr << "  " << what << ": " << mismatches << " of " << count << " samples differ\n";
+        }
+        return mismatches;
+    }
+
+    // Run two filters over the same RGB frame and gray plane
+    int compareFilters(const char* what, BaseFilter& expected, BaseFilter& actual, int tolerance = 0) {
+        const int width = 67;
+        const int height = 41;
+        size_t count = static_cast<size_t>(width) * height;
+        std::vector<pixel> input(count), first(count), second(count);
+        fillPattern(input.data(), width, height);
+        expected.apply(input.data(), first.data(), width, height);
+        actual.apply(input.data(), second.data(), width, height);
+        int mismatches = compareSamples(what, reinterpret_cast<const uint8_t*>(first.data()),
+                                        reinterpret_cast<const uint8_t*>(second.data()), count * sizeof(pixel),
+                                        tolerance);
+
+        std::vector<uint8_t> plane(count), firstGray(count), secondGray(count);
+        for (size_t i = 0; i < count; i++) {
+            plane[i] = input[i].r;
+        }
+        expected.applyGray(plane.data(), firstGray.data(), width, height);
+        actual.applyGray(plane.data(), secondGray.data(), width, height);
+        return mismatches + compareSamples(what, firstGray.data(), secondGray.data(), count, tolerance);
+    }
+
+    // A rank-1 kernel is filtered by the separable path; the dense path
+    // must agree. Binomial taps are exact in every build, so the two paths
+    // must match bit for bit. A Gaussian's are not: float sums round one
+    // level apart, and in fixed point the paths quantize different taps (49
+    // dense products against two vectors of 7), which puts them further apart.
+    bool checkSeparable() {
+        int failures = 0;
+        const std::vector<float> binomial3 = {0.25f, 0.5f, 0.25f};
+        const std::vector<float> binomial5 = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
+        for (const std::vector<float>* taps : {&binomial3, &binomial5}) {
+            int size = static_cast<int>(taps->size());
+            std::vector<float> kernel(size * size);
+            for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                    kernel[i * size + j] = (*taps)[i] * (*taps)[j];
+                }
+            }
+            ConvolutionFilter separable(kernel, size);
+            ConvolutionFilter dense(kernel, size);
+            dense.forceDense();
+            if (!separable.isSeparable()) {
+                std::cerr << "  binomial " << size << "x" << size << " kernel not detected as rank 1\n";
+                failures++;
+            }
+            failures += compareFilters(size == 3 ? "binomial 3x3" : "binomial 5x5", dense, separable) != 0;
+        }
+
+        ConvolutionFilter* gaussian = ConvolutionFilter::createGaussian(7, 1.5f);
+        ConvolutionFilter* denseGaussian = ConvolutionFilter::createGaussian(7, 1.5f);
+        denseGaussian->forceDense();
+#ifdef USE_FIXED_POINT
+        const int tolerance = 5;
+#else
+        const int tolerance = 1;
+#endif
+        failures += compareFilters("gaussian 7x7", *denseGaussian, *gaussian, tolerance) != 0;
+        delete gaussian;
+        delete denseGaussian;
+        return failures == 0;
+    }
+
+    // Each compile-time kernel against ConvolutionFilter on the same
+    // weights: they convert sums back alike in each build, so they must
+    // agree bit for bit
+    bool checkStaticKernels() {
+        namespace filters = hardware::filters;
+        std::vector<float> binomial3(9), binomial5(25);
+        const float taps3[] = {1, 2, 1};
+        const float taps5[] = {1, 4, 6, 4, 1};
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                binomial3[i * 3 + j] = taps3[i] * taps3[j] / 16.0f;
+            }
+        }
+        for (int i = 0; i < 5; i++) {
+            for (int j = 0; j < 5; j++) {
+                binomial5[i * 5 + j] = taps5[i] * taps5[j] / 256.0f;
+            }
+        }
+
+        struct Pair {
+            const char* name;
+            BaseFilter* compiled;
+            BaseFilter* runtime;
+        };
+        const Pair pairs[] = {
+            {"sharpen", new filters::SharpenFilter(), ConvolutionFilter::createSharpen()},
+            {"sobel x", new filters::SobelXFilter(), ConvolutionFilter::createSobelX()},
+            {"sobel y", new filters::SobelYFilter(), ConvolutionFilter::createSobelY()},
+            {"binomial 3x3", new filters::Binomial3Filter(), new ConvolutionFilter(binomial3, 3)},
+            {"binomial 5x5", new filters::Binomial5Filter(), new ConvolutionFilter(binomial5, 5)},
+        };
+
+        int failures = 0;
+        for (const Pair& pair : pairs) {
+            failures += compareFilters(pair.name, *pair.runtime, *pair.compiled) != 0;
+            delete pair.compiled;
+            delete pair.runtime;
+        }
+        return failures == 0;
+    }
+
+#ifdef USE_FIXED_POINT
+    // Known answers for the Q7.8 arithmetic: tap quantization, the final
+    // round-half-up-and-saturate, and a dense and a separable pass through
+    // every kernel table the CPU supports. Expected bytes were worked out
+    // by hand from the taps below, so any change of rounding shows up.
+    bool checkFixedPoint() {
+        namespace simd = hardware::filters::simd;
+        using hardware::fixed::Q7_8;
+        using hardware::fixed::roundToPixel;
+        int failures = 0;
+
+        struct Quantized {
+            float value;
+            int raw;
+        };
+        const Quantized quantized[] = {
+            {0.1f, 26}, {-0.1f, -26}, {-0.2f, -51}, {2.2f, 563}, {1.0f / 3, 85},
+            {-0.3f, -77}, {1.6f, 410}, {0.5f / 256, 1}, {200.0f, 32767}, {-200.0f, -32768},
+        };
+        for (const Quantized& q : quantized) {
+            if (Q7_8::fromFloat(q.value).raw != q.raw) {
+                std::cerr << "  " << q.value << " quantizes to " << Q7_8::fromFloat(q.value).raw << ", expected "
+                          << q.raw << "\n";
+                failures++;
+            }
+        }
+
+        struct Rounded {
+            int acc;
+            int frac;
+            int pixel;
+        };
+        const Rounded rounded[] = {
+            {127, 8, 0}, {128, 8, 1}, {383, 8, 1}, {384, 8, 2}, {-128, 8, 0}, {-129, 8, 0},
+            {65407, 8, 255}, {65408, 8, 255}, {-1000, 8, 0}, {32767, 16, 0}, {32768, 16, 1},
+            {16744447, 16, 255}, {16744448, 16, 255}, {16777216, 16, 255},
+        };
+        for (const Rounded& r : rounded) {
+            int pixel = r.frac == 8 ? roundToPixel<8>(r.acc) : roundToPixel<16>(r.acc);
+            if (pixel != r.pixel) {
+                std::cerr << "  " << r.acc << " with " << r.frac << " fraction bits gives " << pixel << ", expected "
+                          << r.pixel << "\n";
+                failures++;
+            }
+        }
+
+        // Three rows of smooth ramps with a few spikes, filtered at step 1
+        const int width = 40;
+        uint8_t input[3][width];
+        for (int k = 0; k < 3; k++) {
+            for (int j = 0; j < width; j++) {
+                if (j == 6 || j == 25)
+                    input[k][j] = k == 1 ? 250 : 240;
+                else if (j == 14 || j == 31)
+                    input[k][j] = 5;
+                else
+                    input[k][j] = static_cast<uint8_t>(96 + (j * 13 + k * 29) % 23 * 5);
+            }
+        }
+        const uint8_t* rows[3] = {input[0], input[1], input[2]};
+
+        const float sharpen[9] = {-0.1f, -0.2f, -0.1f, -0.2f, 2.2f, -0.2f, -0.1f, -0.2f, -0.1f};
+        const float taps[3] = {-0.3f, 1.6f, -0.3f};
+        KernelTap denseTaps[9], separableTaps[3];
+        for (int i = 0; i < 9; i++) {
+            denseTaps[i] = TO_TAP(sharpen[i]);
+        }
+        for (int i = 0; i < 3; i++) {
+            separableTaps[i] = TO_TAP(taps[i]);
+        }
+
+        // Samples 1..38
+        const uint8_t denseExpected[width - 2] = {
+            255, 118, 255, 155, 7,   255, 33,  243, 113, 255, 150, 31,  245, 0,   255, 108, 255, 145, 26,
+            183, 41,  210, 91,  218, 255, 233, 155, 36,  193, 124, 0,   174, 255, 150, 31,  188, 58,  238,
+        };
+        const uint8_t separableExpected[width - 2] = {
+            255, 86, 255, 156, 0,   255, 0,   255, 81, 255, 151, 11, 244, 0,   255, 76,  255, 146, 6,
+            216, 21, 221, 81,  246, 255, 255, 156, 16, 226, 85,  0,  145, 255, 151, 11,  221, 16,  255,
+        };
+
+        const simd::IsaLevel levels[] = {simd::IsaLevel::SCALAR, simd::IsaLevel::SSE41, simd::IsaLevel::AVX2};
+        for (simd::IsaLevel level : levels) {
+            if (level > simd::detectIsa())
+                continue;
+            simd::selectIsa(level);
+            const simd::KernelTable& table = simd::kernels();
+            std::string name = table.name;
+
+            uint8_t dense[width] = {};
+            table.denseRow(rows, denseTaps, 3, 1, dense, 1, width - 1);
+            failures += compareSamples((name + " dense row").c_str(), denseExpected, dense + 1, width - 2) != 0;
+
+            Fixed line[width];
+            uint8_t separable[width] = {};
+            table.verticalPass(rows, separableTaps, 3, line, 0, width);
+            table.horizontalPass(line, separableTaps, 3, 1, separable, 1, width - 1);
+            failures += compareSamples((name + " separable").c_str(), separableExpected, separable + 1,
+                                       width - 2) != 0;
+        }
+        simd::selectIsa(simd::detectIsa());
+        return failures == 0;
+    }
+#endif
+
+    // The FFT path against the direct path on the same kernel: both
+    // convert sums back alike (truncating in float, rounding half up in
+    // fixed point), so only transform round-off can move a sample, by at
+    // most 1 and rarely
+    bool checkFftConvolution() {
+        int failures = 0;
+        int unsharpSize = 0;
+        std::vector<float> unsharp = hardware::filters::unsharpMaskKernel(2.0f, 1.0f, unsharpSize);
+        struct Case {
+            const char* name;
+            std::vector<float> kernel;
+            int size;
+        };
+        std::vector<Case> cases = {{"unsharp", unsharp, unsharpSize}};
+        std::vector<float> box(81, 1.0f / 81);
+        cases.push_back({"box 9x9", box, 9});
+
+        for (const Case& c : cases) {
+            ConvolutionFilter direct(c.kernel, c.size);
+            direct.forceDense();
+            hardware::filters::FftConvolutionFilter fft(c.kernel, c.size, 32);
+
+            const int width = 67;
+            const int height = 41;
+            size_t count = static_cast<size_t>(width) * height;
+            std::vector<pixel> input(count), expected(count), actual(count);
+            fillPattern(input.data(), width, height);
+            direct.apply(input.data(), expected.data(), width, height);
+            fft.beginFrame();
+            fft.apply(input.data(), actual.data(), width, height);
+
+            const uint8_t* first = reinterpret_cast<const uint8_t*>(expected.data());
+            const uint8_t* second = reinterpret_cast<const uint8_t*>(actual.data());
+            size_t samples = count * sizeof(pixel);
+            std::string what = std::string("fft ") + c.name;
+            failures += compareSamples(what.c_str(), first, second, samples, 1) != 0;
+            size_t off = 0;
+            for (size_t i = 0; i < samples; i++) {
+                off += first[i] != second[i];
+            }
+            if (off * 100 > samples) {
+                std::cerr << "  " << what << ": " << off << " of " << samples << " samples off by one\n";
+                failures++;
+            }
+        }
+        return failures == 0;
+    }
+
+    // Scratch file in the system temp directory, removed when done
+    struct TempFile {
+        std::string path;
+
+        explicit TempFile(const std::string& name)
+            : path((std::filesystem::temp_directory_path() / ("unit_checks_" + name)).string()) {}
+        ~TempFile() { std::remove(path.c_str()); }
+    };
+
+    // ASCII P3, so decoding (not just mapping) leases its frame from the pool
+    bool writeP3(const std::string& path, int width, int height) {
+        std::vector<pixel> frame(static_cast<size_t>(width) * height);
+        fillPattern(frame.data(), width, height);
+        std::ofstream out(path);
+        out << "P3\n" << width << " " << height << "\n255\n";
+        for (const pixel& p : frame) {
+            out << int(p.r) << " " << int(p.g) << " " << int(p.b) << "\n";
+        }
+        return static_cast<bool>(out);
+    }
+
+    // After one run has warmed the buffer pool, further runs of the same
+    // frame lease every buffer from it: the allocation count stays put in
+    // every execution mode (streaming holds rows, not frames, and leases none)
+    bool checkPoolReuse() {
+        TempFile input("pool_in.ppm");
+        TempFile output("pool_out.ppm");
+        if (!writeP3(input.path, 96, 64)) {
+            std::cerr << "  could not write " << input.path << "\n";
+            return false;
+        }
+
+        struct Setup {
+            const char* name;
+            ExecutionMode mode;
+            int threads;
+            hardware::filters::BorderMode border;
+        };
+        const Setup setups[] = {
+            {"frame", ExecutionMode::FRAME, 1, hardware::filters::BorderMode::COPY},
+            {"frame, mirror border", ExecutionMode::FRAME, 1, hardware::filters::BorderMode::MIRROR},
+            {"threaded", ExecutionMode::FRAME, 3, hardware::filters::BorderMode::COPY},
+            {"streaming", ExecutionMode::STREAMING, 1, hardware::filters::BorderMode::COPY},
+        };
+
+        int failures = 0;
+        for (const Setup& setup : setups) {
+            Pipeline pipeline;
+            pipeline.addStage(new hardware::filters::SmoothingFilter());
+            pipeline.addStage(ConvolutionFilter::createGaussian(5, 1.0f));
+            pipeline.addStage(new hardware::filters::EdgeFilter());
+            pipeline.setExecutionMode(setup.mode);
+            pipeline.setThreadCount(setup.threads);
+            pipeline.setBorder(setup.border);
+
+            size_t warm = 0;
+            for (int run = 0; run < 4; run++) {
+                if (!pipeline.run(input.path.c_str(), output.path.c_str())) {
+                    std::cerr << "  " << setup.name << ": run " << run << " failed\n";
+                    failures++;
+                    break;
+                }
+                size_t allocations = pipeline.getBufferPool().getAllocationCount();
+                if (run == 0) {
+                    warm = allocations;
+                    if (setup.mode == ExecutionMode::FRAME && warm == 0) {
+                        std::cerr << "  " << setup.name << ": no frame was leased from the pool\n";
+                        failures++;
+                        break;
+                    }
+                } else if (allocations != warm) {
+                    std::cerr << "  " << setup.name << ": run " << run << " allocated "
+                              << allocations - warm << " more block(s) after warm-up\n";
+                    failures++;
+                    break;
+                }
+            }
+        }
+        return failures == 0;
+    }
+
+    // The SPSC FIFO: a short burst takes only what fits, spans wrap around
+    // the end of the ring, and a producer and a consumer thread trading
+    // mixed singles and bursts (longer than the ring, so many come up
+    // short) deliver every value once, in order
+    bool checkFifo() {
+        typedef hardware::memory::FIFO<uint32_t, 64> Ring;
+        int failures = 0;
+
+        // Deterministic wraparound: 8 queued from slot 40, then a burst
+        // of 60 of which the 56 free slots are taken, across the end
+        std::unique_ptr<Ring> ring(new Ring());
+        uint32_t values[128];
+        for (uint32_t i = 0; i < 128; i++) {
+            values[i] = i;
+        }
+        uint32_t drained[128];
+        size_t pushed = ring->push_burst(values, 48);
+        size_t popped = ring->pop_burst(drained, 40);
+        size_t accepted = ring->push_burst(values + 48, 60);
+        if (pushed != 48 || popped != 40 || accepted != 56 || !ring->isFull()) {
+            std::cerr << "  burst sizes: pushed " << pushed << ", popped " << popped << ", accepted " << accepted
+                      << " of 60 (expected 48, 40, 56 and a full ring)\n";
+            failures++;
+        }
+        uint32_t extra = 0;
+        if (ring->push(extra)) {
+            std::cerr << "  push into a full ring succeeded\n";
+            failures++;
+        }
+        size_t delivered = ring->pop_burst(drained, 100);
+        if (delivered != 64) {
+            std::cerr << "  drained " << delivered << " of 64 queued values\n";
+            failures++;
+        }
+        for (size_t i = 0; i < delivered; i++) {
+            if (drained[i] != 40 + i) {
+                std::cerr << "  value " << i << " after wraparound is " << drained[i] << ", expected " << 40 + i
+                          << "\n";
+                failures++;
+                break;
+            }
+        }
+        if (ring->pop(extra) || !ring->isEmpty()) {
+            std::cerr << "  pop from an empty ring succeeded\n";
+            failures++;
+        }
+
+        // Two threads: burst lengths cycle through 1..97 on both sides; a
+        // side that finds the ring full (empty) yields to the other
+        const uint32_t total = 1u << 18;
+        ring.reset(new Ring());
+        std::thread producer([&ring, total]() {
+            uint32_t next = 0;
+            uint32_t burst[97];
+            for (unsigned step = 0; next < total; step++) {
+                size_t wanted = std::min<size_t>(1 + step * 7 % 97, total - next);
+                size_t sent;
+                if (wanted == 1) {
+                    sent = ring->push(next) ? 1 : 0;
+                } else {
+                    for (size_t i = 0; i < wanted; i++) {
+                        burst[i] = next + static_cast<uint32_t>(i);
+                    }
+                    sent = ring->push_burst(burst, wanted);
+                }
+                next += static_cast<uint32_t>(sent);
+                if (sent == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        // Keep receiving after a mismatch so the producer can finish
+        uint32_t received = 0;
+        size_t shortBursts = 0;
+        bool ordered = true;
+        uint32_t burst[97];
+        for (unsigned step = 0; received < total; step++) {
+            size_t wanted = std::min<size_t>(1 + step * 5 % 97, total - received);
+            size_t got;
+            if (wanted == 1) {
+                got = ring->pop(burst[0]) ? 1 : 0;
+            } else {
+                got = ring->pop_burst(burst, wanted);
+                shortBursts += got < wanted;
+            }
+            if (got == 0) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < got; i++, received++) {
+                if (ordered && burst[i] != received) {
+                    std::cerr << "  received " << burst[i] << ", expected " << received << "\n";
+                    ordered = false;
+                }
+            }
+        }
+        producer.join();
+        if (!ordered) {
+            failures++;
+        } else if (!ring->isEmpty()) {
+            std::cerr << "  " << ring->size() << " value(s) left after the last one was received\n";
+            failures++;
+        }
+        if (ordered && shortBursts == 0) {
+            std::cerr << "  no burst came up short\n";
+            failures++;
+        }
+        return failures == 0;
+    }
+
+#ifdef HW_SIMULATION
+    // Everything written to std::cout while in scope
+    struct CapturedOutput {
+        std::ostringstream text;
+        std::streambuf* saved;
+
+        CapturedOutput() : saved(std::cout.rdbuf(text.rdbuf())) {}
+        ~CapturedOutput() { std::cout.rdbuf(saved); }
+    };
+
+    // A register's value from a dumpPipelineRegisters() listing, -1 if absent
+    long long registerValue(const std::string& dump, const std::string& name) {
+        std::istringstream lines(dump);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t at = line.find(" " + name + " ");
+            size_t hex = line.find("= 0x");
+            if (at != std::string::npos && hex != std::string::npos) {
+                return std::stoll(line.substr(hex + 4), nullptr, 16);
+            }
+        }
+        return -1;
+    }
+
+    // The hardware model after a run: the estimate describes the frame
+    // and stages that ran, its totals add up, and the register dump, the
+    // resource report and the simulated clock all agree with it
+    bool checkHardwareModel() {
+        TempFile input("hw_in.ppm");
+        TempFile output("hw_out.ppm");
+        if (!writeP3(input.path, 96, 64)) {
+            std::cerr << "  could not write " << input.path << "\n";
+            return false;
+        }
+
+        Pipeline pipeline;
+        pipeline.addStage(new hardware::filters::SmoothingFilter());
+        pipeline.addStage(ConvolutionFilter::createGaussian(5, 1.0f));
+        pipeline.addStage(new hardware::filters::EdgeFilter());
+        {
+            CapturedOutput quiet;
+            if (!pipeline.run(input.path.c_str(), output.path.c_str())) {
+                std::cerr << "  run failed\n";
+                return false;
+            }
+        }
+
+        int failures = 0;
+        hardware::simulation::FrameEstimate estimate = pipeline.estimateHardware();
+        int bram18 = 0;
+        int dsp = 0;
+        for (const hardware::simulation::StageEstimate& stage : estimate.stages) {
+            bram18 += stage.bram18;
+            dsp += stage.dsp;
+        }
+        std::string bottleneck = estimate.bottleneck ? estimate.bottleneck : "";
+        if (estimate.width != 96 || estimate.height != 64 || estimate.stages.size() != 4) {
+            std::cerr << "  estimate is for " << estimate.width << "x" << estimate.height << " and "
+                      << estimate.stages.size() << " stages, expected 96x64 and 4 (grayscale + 3)\n";
+            failures++;
+        }
+        if (bram18 != estimate.bram18 || dsp != estimate.dsp) {
+            std::cerr << "  totals " << estimate.bram18 << " BRAM18, " << estimate.dsp << " DSP; stages add up to "
+                      << bram18 << " and " << dsp << "\n";
+            failures++;
+        }
+        if (bottleneck != "datapath" && bottleneck != "memory") {
+            std::cerr << "  bottleneck '" << bottleneck << "' is neither datapath nor memory\n";
+            failures++;
+        }
+        if (estimate.frameCycles <= 0 || estimate.latencyCycles < estimate.fillCycles) {
+            std::cerr << "  frame " << estimate.frameCycles << ", fill " << estimate.fillCycles << ", latency "
+                      << estimate.latencyCycles << " cycles\n";
+            failures++;
+        }
+
+        std::string report;
+        int blocks;
+        {
+            CapturedOutput captured;
+            blocks = pipeline.estimateResourceUsage();
+            report = captured.text.str();
+        }
+        std::string total = "total: " + std::to_string(estimate.bram18) + " BRAM18, " +
+                            std::to_string(estimate.dsp) + " DSP";
+        if (blocks != estimate.bram18 || report.find(total) == std::string::npos) {
+            std::cerr << "  resource report returned " << blocks << " and printed:\n" << report;
+            failures++;
+        }
+
+        // One latency brings the first frame out, each frame interval another
+        std::string clock;
+        std::string dump;
+        {
+            CapturedOutput captured;
+            pipeline.simulateClockCycles(static_cast<int>(estimate.latencyCycles));
+            pipeline.simulateClockCycles(static_cast<int>(estimate.frameCycles));
+            clock = captured.text.str();
+            captured.text.str("");
+            pipeline.dumpPipelineRegisters();
+            dump = captured.text.str();
+        }
+        if (clock.find(": 1 frame(s) out, 0/64 rows") == std::string::npos ||
+            clock.find(": 2 frame(s) out, 0/64 rows") == std::string::npos) {
+            std::cerr << "  simulated clock printed:\n" << clock;
+            failures++;
+        }
+
+        struct Expected {
+            const char* name;
+            long long value;
+        };
+        const Expected registers[] = {
+            {"CYCLE_COUNT", estimate.latencyCycles + estimate.frameCycles},
+            {"STAGE_COUNT", 4},
+            {"FRAME_WIDTH", 96},
+            {"FRAME_HEIGHT", 64},
+            {"FRAME_CYCLES", estimate.frameCycles},
+            {"LATENCY_CYCLES", estimate.latencyCycles},
+            {"BRAM18_BLOCKS", estimate.bram18},
+            {"DSP_SLICES", estimate.dsp},
+            {"STAGE3_FIFO_ROWS", estimate.stages[3].fifoRows},
+        };
+        for (const Expected& expected : registers) {
+            long long value = registerValue(dump, expected.name);
+            if (value != expected.value) {
+                std::cerr << "  register " << expected.name << " = " << value << ", expected " << expected.value
+                          << "\n";
+                failures++;
+            }
+        }
+        return failures == 0;
+    }
+#endif
+
+    struct Check {
+        const char* name;
+        std::function<bool()> run;
+    };
+
+    std::vector<Check> checks() {
+        return {
+            {"separable", checkSeparable},
+            {"static", checkStaticKernels},
+            {"fft", checkFftConvolution},
+            {"pool", checkPoolReuse},
+#ifdef USE_FIXED_POINT
+            {"q78", checkFixedPoint},
+#endif
+#ifdef HW_SIMULATION
+            {"hwmodel", checkHardwareModel},
+#endif
+            {"fifo", checkFifo},
+        };
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<Check> all = checks();
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " CHECK...\nChecks:";
+        for (const Check& check : all) {
+            std::cout << " " << check.name;
+        }
+        std::cout << "\n";
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        const Check* found = nullptr;
+        for (const Check& check : all) {
+            if (check.name == std::string(argv[i]))
+                found = &check;
+        }
+        if (!found) {
+            std::cerr << "Unknown check '" << argv[i] << "'\n";
+            failed++;
+            continue;
+        }
+        bool passed = found->run();
+        std::cout << (passed ? "PASS " : "FAIL ") << found->name << "\n";
+        failed += !passed;
+    }
+    return failed;
+}